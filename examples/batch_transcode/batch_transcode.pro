@@ -0,0 +1,13 @@
+TEMPLATE = app
+TARGET = batch_transcode
+INCLUDEPATH += .
+
+INCLUDEPATH += . ../../src ../../src/QtAVPlayer
+include(../../src/QtAVPlayer/QtAVPlayer.pri)
+
+QT -= gui
+CONFIG += c++1z console
+SOURCES += main.cpp
+
+target.path = $$[QT_INSTALL_EXAMPLES]/$$TARGET
+INSTALLS += target
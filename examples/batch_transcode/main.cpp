@@ -0,0 +1,381 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include <QtAVPlayer/qavdemuxer_p.h>
+#include <QtAVPlayer/qavmuxer_p.h>
+#include <QtAVPlayer/qavfilters_p.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDir>
+#include <QMutex>
+#include <QTextStream>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+class Task : public QRunnable
+{
+public:
+    Task(std::function<void()> fn) : m_fn(std::move(fn)) { }
+    void run() override { m_fn(); }
+
+private:
+    std::function<void()> m_fn;
+};
+
+struct Job
+{
+    QString input;
+    QString output;
+    QAVDemuxer demuxer;
+    QAVFilters filters;
+    bool filtersCreated = false;
+    QAVMuxer muxer;
+
+    QMutex mutex;
+    // Decoded and filtered frames waiting to be encoded
+    QList<QAVFrame> frames;
+    bool decoding = false;
+    bool encoding = false;
+    bool decoded = false;
+    bool finished = false;
+    int error = 0;
+
+    qint64 videoFrames = 0;
+    QElapsedTimer timer;
+};
+
+class BatchTranscoder
+{
+public:
+    QStringList files;
+    QString outputDir;
+    QString extension;
+    QList<QString> filterDescs;
+    QString decoderThreads;
+    int threads = QThread::idealThreadCount();
+    qint64 memoryLimit = 0;
+
+    int run();
+
+private:
+    void start(size_t index);
+    void schedule(Job *job);
+    void scheduleAll();
+    void decodeStep(Job *job);
+    void encodeStep(Job *job);
+    void finish(Job *job);
+    int filter(Job *job, const QAVFrame &frame, QList<QAVFrame> &filteredFrames);
+    void print(const QString &str);
+
+    QThreadPool pool;
+    QMutex jobsMutex;
+    std::vector<std::unique_ptr<Job>> jobs;
+    size_t nextFile = 0;
+    QSemaphore done;
+    std::atomic<qint64> memory{0};
+    std::atomic<qint64> totalFrames{0};
+    std::atomic_int failed{0};
+    QMutex printMutex;
+};
+
+static qint64 frameBytes(const QAVFrame &frame)
+{
+    qint64 ret = 0;
+    for (auto buf : frame.frame()->buf)
+        ret += buf ? buf->size : 0;
+    return ret;
+}
+
+void BatchTranscoder::print(const QString &str)
+{
+    QMutexLocker locker(&printMutex);
+    QTextStream out(stdout);
+    out << str << '\n';
+    out.flush();
+}
+
+int BatchTranscoder::run()
+{
+    pool.setMaxThreadCount(threads);
+    QElapsedTimer timer;
+    timer.start();
+    {
+        QMutexLocker locker(&jobsMutex);
+        // Keeps a few files open per thread to not run out of decoded frames
+        const size_t active = std::min<size_t>(files.size(), threads * 2);
+        jobs.resize(files.size());
+        for (nextFile = 0; nextFile < active; ++nextFile)
+            start(nextFile);
+    }
+    done.acquire(files.size());
+    pool.waitForDone();
+
+    const double elapsed = timer.elapsed() / 1000.0;
+    print(QStringLiteral("Total: %1 files, %2 failed, %3 video frames in %4 s, %5 fps")
+          .arg(files.size()).arg(failed.load()).arg(totalFrames.load())
+          .arg(elapsed, 0, 'f', 2).arg(elapsed > 0 ? totalFrames.load() / elapsed : 0, 0, 'f', 1));
+    return failed ? 1 : 0;
+}
+
+// Called with jobsMutex locked, the file is opened on the pool
+void BatchTranscoder::start(size_t index)
+{
+    auto job = new Job;
+    jobs[index].reset(job);
+    job->input = files[int(index)];
+    QFileInfo info(job->input);
+    job->output = QDir(outputDir).filePath(info.completeBaseName() + QLatin1Char('.') + extension);
+    if (!decoderThreads.isEmpty())
+        job->demuxer.setVideoCodecOptions({{QStringLiteral("threads"), decoderThreads}});
+
+    pool.start(new Task([this, job] {
+        job->timer.start();
+        int ret = job->demuxer.load(job->input);
+        if (ret >= 0)
+            ret = job->muxer.load(job->demuxer.availableStreams(), job->output);
+        if (ret < 0) {
+            {
+                QMutexLocker locker(&job->mutex);
+                job->error = ret;
+                job->decoded = true;
+            }
+            finish(job);
+            return;
+        }
+        schedule(job);
+    }));
+}
+
+// Decoding is paused while decoded frames take more memory than allowed
+void BatchTranscoder::schedule(Job *job)
+{
+    QMutexLocker locker(&job->mutex);
+    if (job->finished)
+        return;
+    if (!job->decoding && !job->decoded && memory < memoryLimit) {
+        job->decoding = true;
+        pool.start(new Task([this, job] { decodeStep(job); }));
+    }
+    if (!job->encoding && !job->frames.isEmpty()) {
+        job->encoding = true;
+        pool.start(new Task([this, job] { encodeStep(job); }));
+    }
+}
+
+void BatchTranscoder::scheduleAll()
+{
+    QMutexLocker locker(&jobsMutex);
+    for (auto &job : jobs) {
+        if (job)
+            schedule(job.get());
+    }
+}
+
+int BatchTranscoder::filter(Job *job, const QAVFrame &frame, QList<QAVFrame> &filteredFrames)
+{
+    const auto type = frame.stream().stream()->codecpar->codec_type;
+    int ret = 0;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!job->filtersCreated) {
+            ret = job->filters.createFilters(filterDescs, frame, job->demuxer);
+            if (ret < 0)
+                return ret;
+            job->filtersCreated = true;
+        }
+        QList<QAVFrame> frames;
+        ret = job->filters.write(type, frame);
+        if (ret >= 0 || ret == AVERROR(EAGAIN))
+            ret = job->filters.read(type, frame, frames);
+        // Format of the frame is changed
+        if (ret == AVERROR(ENOTSUP)) {
+            job->filtersCreated = false;
+            continue;
+        }
+        filteredFrames += frames;
+        break;
+    }
+    return ret == AVERROR(EAGAIN) ? 0 : ret;
+}
+
+// Decodes and filters a chunk of packets, other files are scheduled in between
+void BatchTranscoder::decodeStep(Job *job)
+{
+    const int maxPackets = 32;
+    QList<QAVFrame> filteredFrames;
+    bool eof = false;
+    int ret = 0;
+    for (int i = 0; i < maxPackets && !eof && ret >= 0; ++i) {
+        QList<QAVPacket> packets;
+        auto pkt = job->demuxer.read();
+        if (pkt) {
+            packets.push_back(pkt);
+        } else {
+            // Flushes the decoders
+            eof = true;
+            for (const auto &stream : job->demuxer.currentVideoStreams() + job->demuxer.currentAudioStreams()) {
+                QAVPacket flush;
+                flush.setStream(stream);
+                packets.push_back(flush);
+            }
+        }
+
+        for (const auto &packet : packets) {
+            const auto type = job->demuxer.currentCodecType(packet.stream().index());
+            if (type != AVMEDIA_TYPE_VIDEO && type != AVMEDIA_TYPE_AUDIO)
+                continue;
+            QList<QAVFrame> frames;
+            job->demuxer.decode(packet, frames);
+            for (const auto &frame : frames) {
+                if ((ret = filter(job, frame, filteredFrames)) < 0)
+                    break;
+            }
+        }
+    }
+
+    qint64 bytes = 0;
+    for (const auto &frame : filteredFrames)
+        bytes += frameBytes(frame);
+    memory += bytes;
+
+    {
+        QMutexLocker locker(&job->mutex);
+        job->frames += filteredFrames;
+        job->decoding = false;
+        job->decoded = eof || ret < 0;
+        if (ret < 0)
+            job->error = ret;
+    }
+    schedule(job);
+    finish(job);
+}
+
+void BatchTranscoder::encodeStep(Job *job)
+{
+    QList<QAVFrame> frames;
+    {
+        QMutexLocker locker(&job->mutex);
+        frames.swap(job->frames);
+    }
+
+    int ret = 0;
+    qint64 bytes = 0;
+    qint64 videoFrames = 0;
+    for (const auto &frame : frames) {
+        bytes += frameBytes(frame);
+        if (ret >= 0)
+            ret = job->muxer.write(frame);
+        if (frame.stream().stream()->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+            ++videoFrames;
+    }
+    memory -= bytes;
+
+    {
+        QMutexLocker locker(&job->mutex);
+        job->encoding = false;
+        job->videoFrames += videoFrames;
+        if (ret < 0) {
+            job->error = ret;
+            job->decoded = true;
+        }
+    }
+    // Memory is released, paused files could continue
+    scheduleAll();
+    finish(job);
+}
+
+void BatchTranscoder::finish(Job *job)
+{
+    {
+        QMutexLocker locker(&job->mutex);
+        if (job->finished || !job->decoded || job->decoding || job->encoding || (!job->frames.isEmpty() && !job->error))
+            return;
+        job->finished = true;
+    }
+
+    if (!job->error) {
+        int ret = job->muxer.flush();
+        if (ret < 0)
+            job->error = ret;
+    }
+    job->muxer.unload();
+    job->demuxer.unload();
+    qint64 bytes = 0;
+    for (const auto &frame : job->frames)
+        bytes += frameBytes(frame);
+    memory -= bytes;
+    job->frames.clear();
+
+    const double elapsed = job->timer.elapsed() / 1000.0;
+    if (job->error < 0) {
+        ++failed;
+        print(QStringLiteral("%1: failed: %2").arg(job->input).arg(job->error));
+    } else {
+        totalFrames += job->videoFrames;
+        print(QStringLiteral("%1 -> %2: %3 video frames in %4 s, %5 fps")
+              .arg(job->input, job->output).arg(job->videoFrames)
+              .arg(elapsed, 0, 'f', 2).arg(elapsed > 0 ? job->videoFrames / elapsed : 0, 0, 'f', 1));
+    }
+
+    {
+        QMutexLocker locker(&jobsMutex);
+        if (nextFile < size_t(files.size()))
+            start(nextFile++);
+    }
+    done.release();
+    scheduleAll();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("batch_transcode"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Transcodes files in parallel on a shared thread pool"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("files"), QStringLiteral("Input files."), QStringLiteral("files..."));
+    QCommandLineOption outputOption({QStringLiteral("o"), QStringLiteral("output-dir")},
+                                    QStringLiteral("Output directory."), QStringLiteral("dir"), QStringLiteral("."));
+    QCommandLineOption extensionOption({QStringLiteral("e"), QStringLiteral("extension")},
+                                       QStringLiteral("Output container by file extension."), QStringLiteral("ext"), QStringLiteral("mkv"));
+    QCommandLineOption filterOption({QStringLiteral("f"), QStringLiteral("filter")},
+                                    QStringLiteral("Filter description, could be repeated."), QStringLiteral("desc"));
+    QCommandLineOption threadsOption({QStringLiteral("j"), QStringLiteral("threads")},
+                                     QStringLiteral("Threads in the pool."), QStringLiteral("n"),
+                                     QString::number(QThread::idealThreadCount()));
+    QCommandLineOption decoderThreadsOption(QStringLiteral("decoder-threads"),
+                                            QStringLiteral("Threads per decoder, 0 is auto."), QStringLiteral("n"), QStringLiteral("1"));
+    QCommandLineOption memoryOption({QStringLiteral("m"), QStringLiteral("memory")},
+                                    QStringLiteral("Max memory of decoded frames in MB."), QStringLiteral("mb"), QStringLiteral("1024"));
+    parser.addOptions({outputOption, extensionOption, filterOption, threadsOption, decoderThreadsOption, memoryOption});
+    parser.process(app);
+
+    BatchTranscoder transcoder;
+    transcoder.files = parser.positionalArguments();
+    if (transcoder.files.isEmpty())
+        parser.showHelp(1);
+    transcoder.outputDir = parser.value(outputOption);
+    transcoder.extension = parser.value(extensionOption);
+    transcoder.filterDescs = parser.values(filterOption);
+    transcoder.threads = qMax(1, parser.value(threadsOption).toInt());
+    transcoder.decoderThreads = parser.value(decoderThreadsOption);
+    transcoder.memoryLimit = qMax(1, parser.value(memoryOption).toInt()) * 1024ll * 1024ll;
+    QDir().mkpath(transcoder.outputDir);
+
+    return transcoder.run();
+}
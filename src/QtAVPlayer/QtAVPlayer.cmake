@@ -7,6 +7,8 @@ option(QT_AVPLAYER_VA_X11 "Enable libva-x11" OFF)
 option(QT_AVPLAYER_VA_DRM "Enable libva-drm" OFF)
 option(QT_AVPLAYER_VDPAU "Enable vdpau" OFF)
 option(QT_AVPLAYER_WIDGET_OPENGL "Enable widget opengl" OFF)
+option(QT_AVPLAYER_PROFILE_LOCKS "Report wait times of mutexes" OFF)
+option(QT_AVPLAYER_PROFILE_ALLOCS "Report allocations by subsystem" OFF)
 
 find_library(AVDEVICE_LIBRARY REQUIRED NAMES avdevice)
 find_library(AVCODEC_LIBRARY REQUIRED NAMES avcodec)
@@ -55,6 +57,15 @@ set(QtAVPlayer_PRIVATE_HEADERS
     ${QT_AVPLAYER_DIR}/qavvideooutputfilter_p.h
     ${QT_AVPLAYER_DIR}/qavaudiooutputfilter_p.h
     ${QT_AVPLAYER_DIR}/qavfilters_p.h
+    ${QT_AVPLAYER_DIR}/qavsegmentdecoder_p.h
+    ${QT_AVPLAYER_DIR}/qavthreadbudget_p.h
+    ${QT_AVPLAYER_DIR}/qavpool_p.h
+    ${QT_AVPLAYER_DIR}/qavvideoconverter_p.h
+    ${QT_AVPLAYER_DIR}/qavxxh64_p.h
+    ${QT_AVPLAYER_DIR}/qavbufferpool_p.h
+    ${QT_AVPLAYER_DIR}/qavmemorybudget_p.h
+    ${QT_AVPLAYER_DIR}/qavmutex_p.h
+    ${QT_AVPLAYER_DIR}/qavallocations_p.h
 )
 
 set(QtAVPlayer_PUBLIC_HEADERS
@@ -69,6 +80,11 @@ set(QtAVPlayer_PUBLIC_HEADERS
     ${QT_AVPLAYER_DIR}/qavstream.h
     ${QT_AVPLAYER_DIR}/qavplayer.h
     ${QT_AVPLAYER_DIR}/qavaudioconverter.h
+    ${QT_AVPLAYER_DIR}/qavvideoconverter.h
+    ${QT_AVPLAYER_DIR}/qavthumbnailer.h
+    ${QT_AVPLAYER_DIR}/qavwaveform.h
+    ${QT_AVPLAYER_DIR}/qavpacketanalyzer.h
+    ${QT_AVPLAYER_DIR}/qavframeverifier.h
 )
 
 set(QtAVPlayer_SOURCES
@@ -100,7 +116,19 @@ set(QtAVPlayer_SOURCES
     ${QT_AVPLAYER_DIR}/qaviodevice.cpp
     ${QT_AVPLAYER_DIR}/qavstream.cpp
     ${QT_AVPLAYER_DIR}/qavfilters.cpp
+    ${QT_AVPLAYER_DIR}/qavsegmentdecoder.cpp
+    ${QT_AVPLAYER_DIR}/qavthreadbudget.cpp
+    ${QT_AVPLAYER_DIR}/qavpool.cpp
+    ${QT_AVPLAYER_DIR}/qavbufferpool.cpp
+    ${QT_AVPLAYER_DIR}/qavmemorybudget.cpp
+    ${QT_AVPLAYER_DIR}/qavmutex.cpp
+    ${QT_AVPLAYER_DIR}/qavallocations.cpp
     ${QT_AVPLAYER_DIR}/qavaudioconverter.cpp
+    ${QT_AVPLAYER_DIR}/qavvideoconverter.cpp
+    ${QT_AVPLAYER_DIR}/qavthumbnailer.cpp
+    ${QT_AVPLAYER_DIR}/qavwaveform.cpp
+    ${QT_AVPLAYER_DIR}/qavpacketanalyzer.cpp
+    ${QT_AVPLAYER_DIR}/qavframeverifier.cpp
 )
 
 if(WIN32)
@@ -145,6 +173,16 @@ if(ANDROID)
     )
 endif()
 
+if(QT_AVPLAYER_PROFILE_LOCKS)
+    message(STATUS "QT_AVPLAYER_PROFILE_LOCKS is defined")
+    add_definitions(-DQT_AVPLAYER_PROFILE_LOCKS)
+endif()
+
+if(QT_AVPLAYER_PROFILE_ALLOCS)
+    message(STATUS "QT_AVPLAYER_PROFILE_ALLOCS is defined")
+    add_definitions(-DQT_AVPLAYER_PROFILE_ALLOCS)
+endif()
+
 if(QT_AVPLAYER_MULTIMEDIA)
     message(STATUS "QT_AVPLAYER_MULTIMEDIA is defined")
     add_definitions(-DQT_AVPLAYER_MULTIMEDIA)
@@ -30,7 +30,16 @@ PRIVATE_HEADERS += \
     $$PWD/qavaudioinputfilter_p.h \ 
     $$PWD/qavvideooutputfilter_p.h \
     $$PWD/qavaudiooutputfilter_p.h \
-    $$PWD/qavfilters_p.h
+    $$PWD/qavfilters_p.h \
+    $$PWD/qavsegmentdecoder_p.h \
+    $$PWD/qavpool_p.h \
+    $$PWD/qavvideoconverter_p.h \
+    $$PWD/qavxxh64_p.h \
+    $$PWD/qavbufferpool_p.h \
+    $$PWD/qavmemorybudget_p.h \
+    $$PWD/qavmutex_p.h \
+    $$PWD/qavallocations_p.h \
+    $$PWD/qavthreadbudget_p.h
 
 PUBLIC_HEADERS += \
     $$PWD/qaviodevice.h \
@@ -44,6 +53,11 @@ PUBLIC_HEADERS += \
     $$PWD/qavstream.h \
     $$PWD/qavplayer.h \
     $$PWD/qavaudioconverter.h \
+    $$PWD/qavvideoconverter.h \
+    $$PWD/qavthumbnailer.h \
+    $$PWD/qavwaveform.h \
+    $$PWD/qavpacketanalyzer.h \
+    $$PWD/qavframeverifier.h \
 
 SOURCES += \
     $$PWD/qavplayer.cpp \
@@ -74,7 +88,19 @@ SOURCES += \
     $$PWD/qaviodevice.cpp \
     $$PWD/qavstream.cpp \
     $$PWD/qavfilters.cpp \
+    $$PWD/qavsegmentdecoder.cpp \
+    $$PWD/qavthreadbudget.cpp \
+    $$PWD/qavpool.cpp \
+    $$PWD/qavbufferpool.cpp \
+    $$PWD/qavmemorybudget.cpp \
+    $$PWD/qavmutex.cpp \
+    $$PWD/qavallocations.cpp \
     $$PWD/qavaudioconverter.cpp \
+    $$PWD/qavvideoconverter.cpp \
+    $$PWD/qavthumbnailer.cpp \
+    $$PWD/qavwaveform.cpp \
+    $$PWD/qavpacketanalyzer.cpp \
+    $$PWD/qavframeverifier.cpp \
 
 contains(DEFINES, QT_AVPLAYER_MULTIMEDIA) {
     QT += multimedia
@@ -0,0 +1,222 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavallocations_p.h"
+#include <QDebug>
+#include <algorithm>
+
+#ifdef QT_AVPLAYER_PROFILE_ALLOCS
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+}
+#endif
+
+QT_BEGIN_NAMESPACE
+
+QAVAllocations::QAVAllocations()
+{
+#ifdef QT_AVPLAYER_PROFILE_ALLOCS
+    m_interval = qMax<qint64>(0, qgetenv("QT_AVPLAYER_ALLOCS_INTERVAL").toLongLong());
+    m_timer.start();
+#endif
+}
+
+QAVAllocations &QAVAllocations::instance()
+{
+    // Never destroyed, buffers could be released after static destructors
+    static QAVAllocations *allocations = new QAVAllocations;
+    return *allocations;
+}
+
+bool QAVAllocations::enabled()
+{
+#ifdef QT_AVPLAYER_PROFILE_ALLOCS
+    return true;
+#else
+    return false;
+#endif
+}
+
+QString QAVAllocations::name(Subsystem s)
+{
+    switch (s) {
+    case Demuxer:
+        return QLatin1String("demuxer");
+    case Decoder:
+        return QLatin1String("decoder");
+    case Filters:
+        return QLatin1String("filters");
+    case Converters:
+        return QLatin1String("converters");
+    case Muxer:
+        return QLatin1String("muxer");
+    case AudioOutput:
+        return QLatin1String("audio output");
+    case Wrappers:
+        return QLatin1String("wrappers");
+    default:
+        return {};
+    }
+}
+
+#ifdef QT_AVPLAYER_PROFILE_ALLOCS
+
+struct QAVTrackedBuffer
+{
+    AVBufferRef *buf = nullptr;
+    QAVAllocations::Subsystem subsystem = QAVAllocations::Demuxer;
+    int stream = -1;
+    qint64 size = 0;
+};
+
+static qint64 entryKey(QAVAllocations::Subsystem s, int stream)
+{
+    return (qint64(s) << 32) | quint32(stream);
+}
+
+void QAVAllocations::track(Subsystem s, int stream, AVFrame *frame)
+{
+    if (!frame)
+        return;
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; ++i)
+        wrap(&frame->buf[i], s, stream);
+    for (int i = 0; i < frame->nb_extended_buf; ++i)
+        wrap(&frame->extended_buf[i], s, stream);
+}
+
+void QAVAllocations::track(Subsystem s, int stream, AVPacket *packet)
+{
+    if (packet)
+        wrap(&packet->buf, s, stream);
+}
+
+void QAVAllocations::wrap(AVBufferRef **ref, Subsystem s, int stream)
+{
+    auto buf = *ref;
+    if (!buf || !buf->data)
+        return;
+    {
+        // Attributed to the subsystem that has seen it first
+        QMutexLocker locker(&m_mutex);
+        if (m_tracked.contains(buf->data))
+            return;
+        m_tracked.insert(buf->data);
+    }
+
+    auto t = new QAVTrackedBuffer;
+    t->buf = buf;
+    t->subsystem = s;
+    t->stream = stream;
+    t->size = qint64(buf->size);
+    // The wrapper must not be writable if the data is shared with other refs
+    const int flags = av_buffer_is_writable(buf) ? 0 : AV_BUFFER_FLAG_READONLY;
+    auto wrapper = av_buffer_create(buf->data, buf->size, &QAVAllocations::freeTracked, t, flags);
+    if (!wrapper) {
+        delete t;
+        QMutexLocker locker(&m_mutex);
+        m_tracked.remove(buf->data);
+        return;
+    }
+    *ref = wrapper;
+    add(s, stream, t->size);
+}
+
+void QAVAllocations::freeTracked(void *opaque, uint8_t *data)
+{
+    auto t = static_cast<QAVTrackedBuffer *>(opaque);
+    auto &allocations = instance();
+    {
+        QMutexLocker locker(&allocations.m_mutex);
+        allocations.m_tracked.remove(data);
+    }
+    allocations.release(t->subsystem, t->stream, t->size);
+    av_buffer_unref(&t->buf);
+    delete t;
+}
+
+void QAVAllocations::add(Subsystem s, int stream, qint64 bytes)
+{
+    bool dumpNow = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto &e = m_entries[entryKey(s, stream)];
+        e.subsystem = s;
+        e.stream = stream;
+        e.bytes += bytes;
+        ++e.count;
+        ++e.allocations;
+        e.peakBytes = qMax(e.peakBytes, e.bytes);
+        if (m_interval > 0 && m_timer.elapsed() >= m_interval) {
+            m_timer.restart();
+            dumpNow = true;
+        }
+    }
+    if (dumpNow)
+        dump();
+}
+
+void QAVAllocations::release(Subsystem s, int stream, qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    auto &e = m_entries[entryKey(s, stream)];
+    e.subsystem = s;
+    e.stream = stream;
+    e.bytes -= bytes;
+    --e.count;
+}
+
+QList<QAVAllocations::Entry> QAVAllocations::snapshot() const
+{
+    QList<Entry> ret;
+    {
+        QMutexLocker locker(&m_mutex);
+        ret = m_entries.values();
+    }
+    std::sort(ret.begin(), ret.end(), [](const Entry &a, const Entry &b) {
+        return a.bytes > b.bytes;
+    });
+    return ret;
+}
+
+void QAVAllocations::dump()
+{
+    qInfo().noquote() << "Allocations:\n" << report();
+}
+
+static void printReport()
+{
+    qInfo().noquote() << "Allocations on exit:\n" << QAVAllocations::instance().report();
+}
+Q_DESTRUCTOR_FUNCTION(printReport)
+
+#else
+
+QList<QAVAllocations::Entry> QAVAllocations::snapshot() const
+{
+    return {};
+}
+
+#endif
+
+QString QAVAllocations::report() const
+{
+    QString ret;
+    for (const auto &e : snapshot()) {
+        ret += QString(QLatin1String("%1%2: %3 bytes in %4, peak %5 bytes, allocations %6\n"))
+            .arg(name(e.subsystem))
+            .arg(e.stream >= 0 ? QString(QLatin1String(":%1")).arg(e.stream) : QString())
+            .arg(e.bytes)
+            .arg(e.count)
+            .arg(e.peakBytes)
+            .arg(e.allocations);
+    }
+    return ret;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,112 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVALLOCATIONS_P_H
+#define QAVALLOCATIONS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QList>
+#include <QString>
+#ifdef QT_AVPLAYER_PROFILE_ALLOCS
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QElapsedTimer>
+#include <cstdint>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+struct AVFrame;
+struct AVPacket;
+struct AVBufferRef;
+
+// Attributes live allocations to subsystems of the pipeline.
+// If built with QT_AVPLAYER_PROFILE_ALLOCS, buffers of packets and frames are wrapped
+// by own AVBufferRef and released from its free callback, otherwise all calls are no-op.
+class QAVAllocations
+{
+public:
+    enum Subsystem
+    {
+        Demuxer,
+        Decoder,
+        Filters,
+        Converters,
+        Muxer,
+        AudioOutput,
+        Wrappers,
+        SubsystemCount
+    };
+
+    struct Entry
+    {
+        Subsystem subsystem = Demuxer;
+        // -1 if not related to a stream
+        int stream = -1;
+        // Not released yet
+        qint64 bytes = 0;
+        qint64 count = 0;
+        qint64 peakBytes = 0;
+        // Since start
+        qint64 allocations = 0;
+    };
+
+    static QAVAllocations &instance();
+    static bool enabled();
+    static QString name(Subsystem s);
+
+#ifdef QT_AVPLAYER_PROFILE_ALLOCS
+    // Buffers already tracked by another subsystem are skipped
+    void track(Subsystem s, int stream, AVFrame *frame);
+    void track(Subsystem s, int stream, AVPacket *packet);
+    // Memory not owned by AVBufferRef
+    void add(Subsystem s, int stream, qint64 bytes);
+    void release(Subsystem s, int stream, qint64 bytes);
+#else
+    void track(Subsystem, int, AVFrame *) { }
+    void track(Subsystem, int, AVPacket *) { }
+    void add(Subsystem, int, qint64) { }
+    void release(Subsystem, int, qint64) { }
+#endif
+
+    // Sorted by live bytes
+    QList<Entry> snapshot() const;
+    QString report() const;
+
+private:
+    QAVAllocations();
+    Q_DISABLE_COPY(QAVAllocations)
+
+#ifdef QT_AVPLAYER_PROFILE_ALLOCS
+    void wrap(AVBufferRef **ref, Subsystem s, int stream);
+    void dump();
+    static void freeTracked(void *opaque, uint8_t *data);
+
+    mutable QMutex m_mutex;
+    QHash<qint64, Entry> m_entries;
+    QSet<const uint8_t *> m_tracked;
+    // Periodic dump, QT_AVPLAYER_ALLOCS_INTERVAL in msecs
+    qint64 m_interval = 0;
+    QElapsedTimer m_timer;
+#endif
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -6,6 +6,7 @@
  *********************************************************/
 
 #include "qavaudioconverter.h"
+#include "qavallocations_p.h"
 #include <QDebug>
 
 extern "C" {
@@ -27,6 +28,15 @@ public:
     int outSampleRate = 0;
 
     uint8_t *audioBuf = nullptr;
+    unsigned audioBufSize = 0;
+
+    void freeAudioBuf()
+    {
+        if (audioBuf)
+            QAVAllocations::instance().release(QAVAllocations::Converters, -1, audioBufSize);
+        av_freep(&audioBuf);
+        audioBufSize = 0;
+    }
 };
 
 QAVAudioConverter::QAVAudioConverter()
@@ -38,7 +48,7 @@ QAVAudioConverter::~QAVAudioConverter()
 {
     Q_D(QAVAudioConverter);
     swr_free(&d->swr_ctx);
-    av_freep(&d->audioBuf);
+    d->freeAudioBuf();
 }
 
 QByteArray QAVAudioConverter::data(const QAVAudioFrame &audioFrame)
@@ -123,10 +133,11 @@ QByteArray QAVAudioConverter::data(const QAVAudioFrame &audioFrame)
         int outCount = (int64_t)frame->nb_samples * outSampleRate / frame->sample_rate + 256;
         int outSize = av_samples_get_buffer_size(nullptr, fmt.channelCount(), outCount, outFormat, 0);
 
-        av_freep(&d->audioBuf);
+        d->freeAudioBuf();
         uint8_t **out = &d->audioBuf;
-        unsigned bufSize = 0;
-        av_fast_malloc(&d->audioBuf, &bufSize, outSize);
+        av_fast_malloc(&d->audioBuf, &d->audioBufSize, outSize);
+        if (d->audioBuf)
+            QAVAllocations::instance().add(QAVAllocations::Converters, -1, d->audioBufSize);
 
         int samples = swr_convert(d->swr_ctx, out, outCount, in, frame->nb_samples);
         if (samples < 0) {
@@ -9,6 +9,7 @@
 #include "qavfilter_p_p.h"
 #include "qavcodec_p.h"
 #include "qavstream.h"
+#include "qavallocations_p.h"
 #include <QDebug>
 
 extern "C" {
@@ -86,7 +87,7 @@ int QAVAudioFilter::read(QAVFrame &frame)
     if (d->outputs.isEmpty() || d->isEmpty) {
         int ret = AVERROR(EAGAIN);
         if (d->sourceFrame && d->outputs.isEmpty()) {
-            frame = d->sourceFrame;
+            frame = std::move(d->sourceFrame);
             ret = 0;
         }
         d->sourceFrame = {};
@@ -124,7 +125,8 @@ int QAVAudioFilter::read(QAVFrame &frame)
                     : QString(QLatin1String("%1:%2")).arg(d->name).arg(QString::number(i)));
                 if (!out.stream())
                     out.setStream(d->stream);
-                d->outputFrames.push_back(out);
+                QAVAllocations::instance().track(QAVAllocations::Filters, out.stream().index(), out.frame());
+                d->outputFrames.push_back(std::move(out));
             }
         }
     }
@@ -11,6 +11,11 @@
 #include "qavaudiocodec_p.h"
 #include <QDebug>
 
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/channel_layout.h>
+}
+
 QT_BEGIN_NAMESPACE
 
 class QAVAudioFramePrivate : public QAVFramePrivate
@@ -37,6 +42,12 @@ QAVAudioFrame::QAVAudioFrame(const QAVAudioFrame &other)
     operator=(other);
 }
 
+QAVAudioFrame::QAVAudioFrame(QAVAudioFrame &&other) noexcept
+    : QAVAudioFrame()
+{
+    *this = std::move(other);
+}
+
 QAVAudioFrame::QAVAudioFrame(const QAVAudioFormat &format, const QByteArray &data)
     : QAVAudioFrame()
 {
@@ -47,6 +58,8 @@ QAVAudioFrame::QAVAudioFrame(const QAVAudioFormat &format, const QByteArray &dat
 
 QAVAudioFrame &QAVAudioFrame::operator=(const QAVFrame &other)
 {
+    if (this == &other)
+        return *this;
     Q_D(QAVAudioFrame);
     QAVFrame::operator=(other);
     d->data.clear();
@@ -56,6 +69,8 @@ QAVAudioFrame &QAVAudioFrame::operator=(const QAVFrame &other)
 
 QAVAudioFrame &QAVAudioFrame::operator=(const QAVAudioFrame &other)
 {
+    if (this == &other)
+        return *this;
     Q_D(QAVAudioFrame);
     QAVFrame::operator=(other);
     auto rhs = reinterpret_cast<QAVAudioFramePrivate *>(other.d_ptr.get());
@@ -65,6 +80,20 @@ QAVAudioFrame &QAVAudioFrame::operator=(const QAVAudioFrame &other)
     return *this;
 }
 
+QAVAudioFrame &QAVAudioFrame::operator=(QAVAudioFrame &&other) noexcept
+{
+    if (this == &other)
+        return *this;
+    Q_D(QAVAudioFrame);
+    QAVFrame::operator=(std::move(other));
+    auto rhs = reinterpret_cast<QAVAudioFramePrivate *>(other.d_ptr.get());
+    d->outAudioFormat = rhs->outAudioFormat;
+    d->data = std::move(rhs->data);
+    rhs->data.clear();
+
+    return *this;
+}
+
 QAVAudioFrame::operator bool() const
 {
     Q_D(const QAVAudioFrame);
@@ -106,4 +135,88 @@ QByteArray QAVAudioFrame::data() const
     return d->data;
 }
 
+QAVAudioFrame QAVAudioFrame::convertTo(const QAVAudioFormat &format) const
+{
+    QAVAudioFrame result = *this;
+    auto d = reinterpret_cast<QAVAudioFramePrivate *>(result.d_ptr.get());
+    d->outAudioFormat = format;
+    d->data.clear();
+    return result;
+}
+
+AVSampleFormat QAVAudioFrame::sampleFormat() const
+{
+    auto f = frame();
+    return f ? AVSampleFormat(f->format) : AV_SAMPLE_FMT_NONE;
+}
+
+bool QAVAudioFrame::isPlanar() const
+{
+    const auto fmt = sampleFormat();
+    return fmt != AV_SAMPLE_FMT_NONE && av_sample_fmt_is_planar(fmt);
+}
+
+int QAVAudioFrame::bytesPerSample() const
+{
+    const auto fmt = sampleFormat();
+    return fmt != AV_SAMPLE_FMT_NONE ? av_get_bytes_per_sample(fmt) : 0;
+}
+
+int QAVAudioFrame::sampleRate() const
+{
+    auto f = frame();
+    return f ? f->sample_rate : 0;
+}
+
+int QAVAudioFrame::channelCount() const
+{
+    auto f = frame();
+    if (!f)
+        return 0;
+#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
+    return f->channels;
+#else
+    return f->ch_layout.nb_channels;
+#endif
+}
+
+QString QAVAudioFrame::channelLayout() const
+{
+    auto f = frame();
+    if (!f)
+        return {};
+    char buf[64] = {0};
+#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
+    av_get_channel_layout_string(buf, sizeof(buf), f->channels, f->channel_layout);
+#else
+    if (av_channel_layout_describe(&f->ch_layout, buf, sizeof(buf)) < 0)
+        return {};
+#endif
+    return QString::fromUtf8(buf);
+}
+
+int QAVAudioFrame::sampleCount() const
+{
+    auto f = frame();
+    return f ? f->nb_samples : 0;
+}
+
+int QAVAudioFrame::planeCount() const
+{
+    if (sampleFormat() == AV_SAMPLE_FMT_NONE)
+        return 0;
+    return isPlanar() ? channelCount() : 1;
+}
+
+QAVAudioFrame::Plane QAVAudioFrame::plane(int index) const
+{
+    auto f = frame();
+    if (!f || !f->extended_data || index < 0 || index >= planeCount())
+        return {};
+
+    // Linesize could be padded
+    const int samples = isPlanar() ? f->nb_samples : f->nb_samples * channelCount();
+    return { f->extended_data[index], samples * bytesPerSample() };
+}
+
 QT_END_NAMESPACE
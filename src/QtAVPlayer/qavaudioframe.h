@@ -10,6 +10,12 @@
 
 #include <QtAVPlayer/qavframe.h>
 #include <QtAVPlayer/qavaudioformat.h>
+#include <type_traits>
+#include <cstdint>
+
+extern "C" {
+#include <libavutil/samplefmt.h>
+}
 
 QT_BEGIN_NAMESPACE
 
@@ -21,13 +27,76 @@ public:
     QAVAudioFrame();
     QAVAudioFrame(const QAVFrame &other);
     QAVAudioFrame(const QAVAudioFrame &other);
+    QAVAudioFrame(QAVAudioFrame &&other) noexcept;
     QAVAudioFrame(const QAVAudioFormat &format, const QByteArray &data);
     QAVAudioFrame &operator=(const QAVFrame &other);
     QAVAudioFrame &operator=(const QAVAudioFrame &other);
+    QAVAudioFrame &operator=(QAVAudioFrame &&other) noexcept;
     operator bool() const;
 
+    // Output format of data(), samples are converted to Int32 by default
     QAVAudioFormat format() const;
+    // Interleaved samples converted to format()
     QByteArray data() const;
+    // Frame which converts the samples to the format on data()
+    QAVAudioFrame convertTo(const QAVAudioFormat &format) const;
+
+    // Native format of the decoded frame, no conversion
+    AVSampleFormat sampleFormat() const;
+    bool isPlanar() const;
+    int bytesPerSample() const;
+    int sampleRate() const;
+    int channelCount() const;
+    // Description of the channel layout, e.g. "stereo" or "5.1"
+    QString channelLayout() const;
+    // Samples per channel
+    int sampleCount() const;
+
+    // Native samples, refer to the frame and valid while it is alive.
+    // Planar formats contain a plane per channel, packed formats one interleaved plane.
+    struct Plane
+    {
+        const uchar *data = nullptr;
+        int size = 0;
+    };
+    int planeCount() const;
+    Plane plane(int index) const;
+
+    template <typename T>
+    struct Samples
+    {
+        const T *data = nullptr;
+        int size = 0;
+
+        const T *begin() const { return data; }
+        const T *end() const { return data + size; }
+        const T &operator[](int i) const { return data[i]; }
+    };
+    // Typed samples of the plane, empty if T does not match the sample format,
+    // e.g. samples<float>(ch) for AV_SAMPLE_FMT_FLTP or samples<int16_t>() for AV_SAMPLE_FMT_S16
+    template <typename T>
+    Samples<T> samples(int index = 0) const
+    {
+        const auto p = plane(index);
+        if (!p.data || av_get_packed_sample_fmt(sampleFormat()) != packedSampleFormat<T>())
+            return {};
+        return { reinterpret_cast<const T *>(p.data), p.size / int(sizeof(T)) };
+    }
+
+    // Packed sample format of the type, AV_SAMPLE_FMT_NONE if not supported
+    template <typename T>
+    static AVSampleFormat packedSampleFormat()
+    {
+        return std::is_same<T, uint8_t>::value ? AV_SAMPLE_FMT_U8
+            : std::is_same<T, int16_t>::value ? AV_SAMPLE_FMT_S16
+            : std::is_same<T, int32_t>::value ? AV_SAMPLE_FMT_S32
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(55, 31, 100)
+            : std::is_same<T, int64_t>::value ? AV_SAMPLE_FMT_S64
+#endif
+            : std::is_same<T, float>::value ? AV_SAMPLE_FMT_FLT
+            : std::is_same<T, double>::value ? AV_SAMPLE_FMT_DBL
+            : AV_SAMPLE_FMT_NONE;
+    }
 
 private:
     Q_DECLARE_PRIVATE(QAVAudioFrame)
@@ -7,6 +7,8 @@
 
 #include "qavaudiooutputdevice.h"
 #include "qavaudioconverter.h"
+#include "qavmemorybudget_p.h"
+#include "qavallocations_p.h"
 #include <QDebug>
 #include <QMutex>
 #include <QWaitCondition>
@@ -23,7 +25,19 @@ public:
     QAVAudioConverter conv;
     mutable QMutex mutex;
     QWaitCondition cond;
+    QWaitCondition drained;
     bool quit = false;
+
+    // Audio buffers are accounted by the process-wide budget
+    void removeAt(int i)
+    {
+        const qint64 size = frames[i].size();
+        bytes -= size;
+        frames.removeAt(i);
+        QAVMemoryBudget::process().release(QAVMemoryBudget::AudioBuffers, size);
+        QAVAllocations::instance().release(QAVAllocations::AudioOutput, -1, size);
+        drained.wakeAll();
+    }
 };
 
 QAVAudioOutputDevice::QAVAudioOutputDevice(QObject *parent)
@@ -35,6 +49,9 @@ QAVAudioOutputDevice::QAVAudioOutputDevice(QObject *parent)
 QAVAudioOutputDevice::~QAVAudioOutputDevice()
 {
     stop();
+    QAVMemoryBudget::process().release(QAVMemoryBudget::AudioBuffers, d_ptr->bytes);
+    for (const auto &data : d_ptr->frames)
+        QAVAllocations::instance().release(QAVAllocations::AudioOutput, -1, data.size());
 }
 
 qint64 QAVAudioOutputDevice::readData(char *data, qint64 len)
@@ -62,8 +79,7 @@ qint64 QAVAudioOutputDevice::readData(char *data, qint64 len)
 
         if (d->offset >= sampleData.size()) {
             d->offset = 0;
-            d->bytes -= sampleData.size();
-            d->frames.removeFirst();
+            d->removeAt(0);
         }
     }
     if (d->quit) {
@@ -78,8 +94,24 @@ void QAVAudioOutputDevice::play(const QAVAudioFrame &frame)
     Q_D(QAVAudioOutputDevice);
     {
         QMutexLocker locker(&d->mutex);
+        auto &budget = QAVMemoryBudget::process();
+        switch (budget.policy()) {
+        case QAVMemoryBudget::BlockProducers:
+            while (!d->quit && !d->frames.isEmpty() && budget.exceeded())
+                d->drained.wait(&d->mutex, 10);
+            break;
+        case QAVMemoryBudget::DropFrames:
+            // The front buffer could be partially sent
+            while (d->frames.size() > 1 && budget.exceeded())
+                d->removeAt(1);
+            break;
+        default:
+            break;
+        }
         auto data = d->conv.data(frame);
         d->bytes += data.size();
+        budget.add(QAVMemoryBudget::AudioBuffers, data.size());
+        QAVAllocations::instance().add(QAVAllocations::AudioOutput, -1, data.size());
         d->frames.push_back(std::move(data));
     }
     d->cond.wakeAll();
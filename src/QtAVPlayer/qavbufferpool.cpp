@@ -0,0 +1,315 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavbufferpool_p.h"
+#include <QDebug>
+#include <cstdlib>
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#endif
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/samplefmt.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+// Padding of each plane as FFmpeg does for SIMD overreads
+static const int planePadding = 16 + 64 - 1;
+// Large frames are aligned to transparent huge pages
+static const qint64 hugePageSize = 2 * 1024 * 1024;
+// Free blocks kept per size class without the cap
+static const size_t maxFreeBlocks = 64;
+
+QAVBufferPool::QAVBufferPool()
+    : m_cap(qMax<qint64>(0, qgetenv("QT_AVPLAYER_FRAME_BUFFER_CAP").toLongLong()))
+{
+}
+
+QAVBufferPool &QAVBufferPool::instance()
+{
+    // Never destroyed, frames could be released after static destructors
+    static QAVBufferPool *pool = new QAVBufferPool;
+    return *pool;
+}
+
+// Small buffers are rounded to powers of two, large ones to pages,
+// so frames of the same stream share the size class
+static qint64 sizeClass(qint64 size)
+{
+    const qint64 page = 64 * 1024;
+    if (size > page)
+        return (size + page - 1) / page * page;
+    qint64 ret = 256;
+    while (ret < size)
+        ret *= 2;
+    return ret;
+}
+
+static uint8_t *allocate(qint64 size, bool &huge)
+{
+    huge = false;
+#ifdef Q_OS_LINUX
+    if (size >= hugePageSize) {
+        void *p = nullptr;
+        const qint64 aligned = (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+        if (posix_memalign(&p, hugePageSize, aligned) == 0) {
+#ifdef MADV_HUGEPAGE
+            madvise(p, aligned, MADV_HUGEPAGE);
+#endif
+            huge = true;
+            return static_cast<uint8_t *>(p);
+        }
+    }
+#endif
+    return static_cast<uint8_t *>(av_malloc(size));
+}
+
+void QAVBufferPool::freeBlock(Block *block)
+{
+    if (block->huge)
+        free(block->data);
+    else
+        av_free(block->data);
+    delete block;
+}
+
+bool QAVBufferPool::evict(qint64 bytes)
+{
+    for (auto it = m_blocks.begin(); it != m_blocks.end() && bytes > 0; ++it) {
+        auto &blocks = it.value();
+        while (!blocks.empty() && bytes > 0) {
+            auto block = blocks.back();
+            blocks.pop_back();
+            bytes -= block->size;
+            m_stats.allocatedBytes -= block->size;
+            freeBlock(block);
+        }
+    }
+    return bytes <= 0;
+}
+
+AVBufferRef *QAVBufferPool::get(qint64 size)
+{
+    const qint64 cls = sizeClass(size);
+    QMutexLocker locker(&m_mutex);
+    m_nextSize = cls;
+    Block *block = nullptr;
+    auto &blocks = m_blocks[cls];
+    if (!blocks.empty()) {
+        block = blocks.back();
+        blocks.pop_back();
+        ++m_stats.hits;
+    } else {
+        // The decoders are not fed while exhausted, so it is the last resort
+        const qint64 over = m_cap > 0 ? m_stats.allocatedBytes + cls - m_cap : 0;
+        if (over <= 0 || evict(over)) {
+            bool huge = false;
+            auto data = allocate(cls, huge);
+            if (data) {
+                block = new Block{data, cls, huge};
+                m_stats.allocatedBytes += cls;
+                ++m_stats.misses;
+            }
+        }
+    }
+
+    if (!block) {
+        ++m_stats.failures;
+        return nullptr;
+    }
+
+    m_stats.usedBytes += block->size;
+    locker.unlock();
+    auto buf = av_buffer_create(block->data, int(block->size), release, block, 0);
+    if (!buf)
+        release(block, block->data);
+    return buf;
+}
+
+void QAVBufferPool::release(void *opaque, uint8_t *)
+{
+    auto &pool = instance();
+    auto block = static_cast<Block *>(opaque);
+    QMutexLocker locker(&pool.m_mutex);
+    pool.m_stats.usedBytes -= block->size;
+    auto &blocks = pool.m_blocks[block->size];
+    if (pool.m_cap > 0 || blocks.size() < maxFreeBlocks) {
+        blocks.push_back(block);
+    } else {
+        pool.m_stats.allocatedBytes -= block->size;
+        pool.freeBlock(block);
+    }
+    pool.m_released.wakeAll();
+}
+
+bool QAVBufferPool::isExhausted() const
+{
+    return m_cap > 0 && m_stats.usedBytes + m_nextSize > m_cap;
+}
+
+bool QAVBufferPool::exhausted() const
+{
+    QMutexLocker locker(&m_mutex);
+    return isExhausted();
+}
+
+bool QAVBufferPool::waitForRelease(int msecs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!isExhausted())
+        return true;
+    ++m_stats.waits;
+    m_released.wait(&m_mutex, msecs);
+    return !isExhausted();
+}
+
+qint64 QAVBufferPool::cap() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cap;
+}
+
+void QAVBufferPool::setCap(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cap = qMax<qint64>(0, bytes);
+    if (m_cap > 0 && m_stats.allocatedBytes > m_cap)
+        evict(m_stats.allocatedBytes - m_cap);
+    m_released.wakeAll();
+}
+
+QAVBufferPool::Stats QAVBufferPool::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+void QAVBufferPool::trim()
+{
+    QMutexLocker locker(&m_mutex);
+    evict(m_stats.allocatedBytes);
+}
+
+static int get_video_buffer(AVCodecContext *avctx, AVFrame *frame)
+{
+    const auto fmt = AVPixelFormat(frame->format);
+    const auto desc = av_pix_fmt_desc_get(fmt);
+    int unsupported = AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL;
+#ifdef AV_PIX_FMT_FLAG_PSEUDOPAL
+    unsupported |= AV_PIX_FMT_FLAG_PSEUDOPAL;
+#endif
+    if (!desc || (desc->flags & unsupported) || avctx->hw_frames_ctx)
+        return AVERROR(ENOTSUP);
+
+    // Same layout as avcodec_default_get_buffer2()
+    int w = frame->width;
+    int h = frame->height;
+    int strideAlign[AV_NUM_DATA_POINTERS] = {};
+    avcodec_align_dimensions2(avctx, &w, &h, strideAlign);
+    int linesize[4] = {};
+    int unaligned = 0;
+    do {
+        int ret = av_image_fill_linesizes(linesize, fmt, w);
+        if (ret < 0)
+            return ret;
+        w += w & ~(w - 1);
+        unaligned = 0;
+        for (int i = 0; i < 4; ++i)
+            unaligned |= strideAlign[i] ? linesize[i] % strideAlign[i] : 0;
+    } while (unaligned);
+
+    qint64 sizes[4] = {};
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 56, 100)
+    ptrdiff_t linesizes[4] = {};
+    size_t planeSizes[4] = {};
+    for (int i = 0; i < 4; ++i)
+        linesizes[i] = linesize[i];
+    int ret = av_image_fill_plane_sizes(planeSizes, fmt, h, linesizes);
+    if (ret < 0)
+        return ret;
+    for (int i = 0; i < 4; ++i)
+        sizes[i] = qint64(planeSizes[i]);
+#else
+    uint8_t *data[4] = {};
+    const int size = av_image_fill_pointers(data, fmt, h, nullptr, linesize);
+    if (size < 0)
+        return size;
+    int plane = 0;
+    for (; plane < 3 && data[plane + 1]; ++plane)
+        sizes[plane] = data[plane + 1] - data[plane];
+    sizes[plane] = size - (data[plane] - data[0]);
+#endif
+
+    for (int i = 0; i < 4 && sizes[i] > 0; ++i) {
+        frame->buf[i] = QAVBufferPool::instance().get(sizes[i] + planePadding);
+        if (!frame->buf[i])
+            return AVERROR(ENOMEM);
+        frame->data[i] = frame->buf[i]->data;
+        frame->linesize[i] = linesize[i];
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+static int get_audio_buffer(AVCodecContext *, AVFrame *frame)
+{
+    const auto fmt = AVSampleFormat(frame->format);
+#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
+    const int channels = frame->channels;
+#else
+    const int channels = frame->ch_layout.nb_channels;
+#endif
+    const int planes = av_sample_fmt_is_planar(fmt) ? channels : 1;
+    if (planes <= 0 || planes > AV_NUM_DATA_POINTERS)
+        return AVERROR(ENOTSUP);
+
+    int linesize = 0;
+    int ret = av_samples_get_buffer_size(&linesize, channels, frame->nb_samples, fmt, 0);
+    if (ret < 0)
+        return ret;
+
+    for (int i = 0; i < planes; ++i) {
+        frame->buf[i] = QAVBufferPool::instance().get(linesize);
+        if (!frame->buf[i])
+            return AVERROR(ENOMEM);
+        frame->data[i] = frame->buf[i]->data;
+    }
+    frame->linesize[0] = linesize;
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+int QAVBufferPool::getBuffer(AVCodecContext *avctx, AVFrame *frame, int flags)
+{
+    int ret = AVERROR(ENOTSUP);
+    switch (avctx->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+        ret = get_video_buffer(avctx, frame);
+        break;
+    case AVMEDIA_TYPE_AUDIO:
+        ret = get_audio_buffer(avctx, frame);
+        break;
+    default:
+        break;
+    }
+
+    if (ret == AVERROR(ENOTSUP))
+        return avcodec_default_get_buffer2(avctx, frame, flags);
+    if (ret < 0) {
+        for (auto &buf : frame->buf)
+            av_buffer_unref(&buf);
+        qWarning() << "Could not get frame buffer:" << ret;
+    }
+    return ret;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,99 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVBUFFERPOOL_P_H
+#define QAVBUFFERPOOL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QMap>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+struct AVBufferRef;
+struct AVCodecContext;
+struct AVFrame;
+
+// Process-wide pools of the frame buffers of software decoders, split by size classes
+class QAVBufferPool
+{
+public:
+    static QAVBufferPool &instance();
+
+    // Used as AVCodecContext::get_buffer2, falls back to the default one
+    // for hardware and palette formats
+    static int getBuffer(AVCodecContext *avctx, AVFrame *frame, int flags);
+
+    // Returns nullptr if the cap is reached, the decoders wait for released buffers before
+    AVBufferRef *get(qint64 size);
+
+    // If the next buffer would not fit to the cap
+    bool exhausted() const;
+    // Waits up to msecs for released buffers, returns false if still exhausted
+    bool waitForRelease(int msecs);
+
+    // Max bytes allocated by all pools, 0 means unlimited
+    qint64 cap() const;
+    void setCap(qint64 bytes);
+
+    struct Stats
+    {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        // Decoders waited for released buffers due to the cap
+        qint64 waits = 0;
+        qint64 failures = 0;
+        qint64 allocatedBytes = 0;
+        qint64 usedBytes = 0;
+    };
+    Stats stats() const;
+
+    // Frees the buffers not used by frames
+    void trim();
+
+private:
+    QAVBufferPool();
+    Q_DISABLE_COPY(QAVBufferPool)
+
+    struct Block
+    {
+        uint8_t *data = nullptr;
+        qint64 size = 0;
+        bool huge = false;
+    };
+
+    static void release(void *opaque, uint8_t *data);
+    void freeBlock(Block *block);
+    bool evict(qint64 bytes);
+    bool isExhausted() const;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_released;
+    // Free blocks by size class
+    QMap<qint64, std::vector<Block *>> m_blocks;
+    qint64 m_cap = 0;
+    // Size class of the last requested buffer
+    qint64 m_nextSize = 0;
+    Stats m_stats;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -7,6 +7,8 @@
 
 #include "qavcodec_p.h"
 #include "qavcodec_p_p.h"
+#include "qavthreadbudget_p.h"
+#include "qavbufferpool_p.h"
 
 #include <QDebug>
 
@@ -35,6 +37,8 @@ QAVCodec::~QAVCodec()
     Q_D(QAVCodec);
     if (d->avctx)
         avcodec_free_context(&d->avctx);
+    av_dict_free(&d->options);
+    QAVThreadBudget::instance().release(d->budgetId);
 }
 
 void QAVCodec::setCodec(const AVCodec *c)
@@ -65,15 +69,106 @@ bool QAVCodec::open(AVStream *stream, AVDictionary** opts)
     }
 
     d->avctx->codec_id = d->codec->id;
+    // Software video decoders share the process-wide threads, unless the threads are set in the options
+    if (d->budgetId < 0 && d->avctx->codec_type == AVMEDIA_TYPE_VIDEO && av_codec_is_decoder(d->codec)
+        && !d->avctx->hw_device_ctx && !(opts && av_dict_get(*opts, "threads", nullptr, 0))) {
+        auto &budget = QAVThreadBudget::instance();
+        const qint64 pixels = qMax(1, d->avctx->width * d->avctx->height);
+        d->budgetId = budget.acquire(qMax(1, d->threadPriority) * pixels);
+        const int threads = budget.threads(d->budgetId);
+        if (threads > 0) {
+            d->avctx->thread_count = threads;
+            if (d->lowDelay)
+                d->avctx->thread_type = FF_THREAD_SLICE;
+            av_dict_free(&d->options);
+            if (opts)
+                av_dict_copy(&d->options, *opts, 0);
+        }
+    }
+
+    // Frame buffers of software decoders are recycled by the process-wide pools
+    if (av_codec_is_decoder(d->codec) && (d->codec->capabilities & AV_CODEC_CAP_DR1)
+        && (d->avctx->codec_type == AVMEDIA_TYPE_VIDEO || d->avctx->codec_type == AVMEDIA_TYPE_AUDIO))
+    {
+        d->avctx->get_buffer2 = QAVBufferPool::getBuffer;
+#if LIBAVCODEC_VERSION_MAJOR < 59
+        d->avctx->thread_safe_callbacks = 1;
+#endif
+    }
+
     ret = avcodec_open2(d->avctx, d->codec, opts);
     if (ret < 0) {
         qWarning() << "Could not open the codec:" << d->codec->name << d->codec->id << ret;
+        QAVThreadBudget::instance().release(d->budgetId);
+        d->budgetId = -1;
         return false;
     }
 
     stream->discard = AVDISCARD_DEFAULT;
     d->stream = stream;
+    d->threadCount = d->avctx->thread_count;
+    d->frameThreading = d->avctx->active_thread_type & FF_THREAD_FRAME;
+
+    return true;
+}
+
+// Threads of the new share, if the decoder should be reopened now
+int QAVCodecPrivate::rebalancedThreads() const
+{
+    if (budgetId < 0 || !avctx)
+        return 0;
+    return QAVThreadBudget::instance().rebalanced(budgetId);
+}
+
+// Opens new context with the same settings, the frames of the old one must be drained
+bool QAVCodecPrivate::reopen(int threads)
+{
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    if (!ctx)
+        return false;
+    int ret = avcodec_parameters_to_context(ctx, stream->codecpar);
+    if (ret < 0) {
+        avcodec_free_context(&ctx);
+        return false;
+    }
+
+    ctx->codec_id = avctx->codec_id;
+    ctx->pkt_timebase = avctx->pkt_timebase;
+    ctx->framerate = avctx->framerate;
+    ctx->opaque = avctx->opaque;
+    ctx->get_format = avctx->get_format;
+    ctx->get_buffer2 = avctx->get_buffer2;
+#if LIBAVCODEC_VERSION_MAJOR < 59
+    ctx->thread_safe_callbacks = avctx->thread_safe_callbacks;
+#endif
+    ctx->thread_type = avctx->thread_type;
+    ctx->thread_count = threads;
+    ctx->flags = avctx->flags;
+    ctx->flags2 = avctx->flags2;
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 93, 100)
+    ctx->export_side_data = avctx->export_side_data;
+#endif
+    ctx->skip_loop_filter = avctx->skip_loop_filter;
+    ctx->skip_frame = avctx->skip_frame;
+
+    AVDictionary *opts = nullptr;
+    av_dict_copy(&opts, options, 0);
+    ret = avcodec_open2(ctx, codec, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        qWarning() << "Could not reopen the codec:" << codec->name << "threads:" << threads << ret;
+        avcodec_free_context(&ctx);
+        // Keeps the threads and is not rebalanced anymore
+        QAVThreadBudget::instance().release(budgetId);
+        budgetId = -1;
+        return false;
+    }
 
+    avcodec_free_context(&avctx);
+    avctx = ctx;
+    threadCount = avctx->thread_count;
+    frameThreading = avctx->active_thread_type & FF_THREAD_FRAME;
+    QAVThreadBudget::instance().setThreads(budgetId, avctx->thread_count);
     return true;
 }
 
@@ -87,11 +182,42 @@ const AVCodec *QAVCodec::codec() const
     return d_func()->codec;
 }
 
+int QAVCodec::threadPriority() const
+{
+    return d_func()->threadPriority;
+}
+
+void QAVCodec::setThreadPriority(int priority)
+{
+    d_func()->threadPriority = priority;
+}
+
+bool QAVCodec::lowDelay() const
+{
+    return d_func()->lowDelay;
+}
+
+void QAVCodec::setLowDelay(bool enabled)
+{
+    d_func()->lowDelay = enabled;
+}
+
+int QAVCodec::threadCount() const
+{
+    return d_func()->threadCount;
+}
+
+bool QAVCodec::isFrameThreading() const
+{
+    return d_func()->frameThreading;
+}
+
 void QAVCodec::flushBuffers()
 {
      Q_D(QAVCodec);
      if (!d->avctx)
         return;
+    d->draining = false;
     avcodec_flush_buffers(d->avctx);
 }
 QT_END_NAMESPACE
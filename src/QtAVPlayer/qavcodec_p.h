@@ -44,6 +44,16 @@ public:
     void setCodec(const AVCodec *c);
     const AVCodec *codec() const;
 
+    // Weight of the decoder in the thread budget, applied on open
+    int threadPriority() const;
+    void setThreadPriority(int priority);
+    // Prefers slice threading which does not delay the frames
+    bool lowDelay() const;
+    void setLowDelay(bool enabled);
+    // Threads of the opened codec, changed when the decoder is rebalanced
+    int threadCount() const;
+    bool isFrameThreading() const;
+
     void flushBuffers();
 
     // Sends a packet
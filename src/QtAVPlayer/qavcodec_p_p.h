@@ -20,6 +20,7 @@
 //
 
 #include "qavcodec_p.h"
+#include <atomic>
 
 QT_BEGIN_NAMESPACE
 
@@ -31,9 +32,21 @@ class QAVCodecPrivate
 public:
     virtual ~QAVCodecPrivate() = default;
 
+    int rebalancedThreads() const;
+    bool reopen(int threads);
+
     AVCodecContext *avctx = nullptr;
     const AVCodec *codec = nullptr;
     AVStream *stream = nullptr;
+    int threadPriority = 1;
+    bool lowDelay = false;
+    // Allocation in QAVThreadBudget
+    int budgetId = -1;
+    // The decoder is reopened with the same options when its share of the budget changes
+    AVDictionary *options = nullptr;
+    bool draining = false;
+    std::atomic_int threadCount {0};
+    std::atomic_bool frameThreading {false};
 };
 
 QT_END_NAMESPACE
@@ -11,6 +11,8 @@
 #include "qavsubtitlecodec_p.h"
 #include "qavhwdevice_p.h"
 #include "qaviodevice.h"
+#include "qavmutex_p.h"
+#include "qavallocations_p.h"
 #include <QtAVPlayer/qtavplayerglobal.h>
 
 #if defined(QT_AVPLAYER_VA_X11) && QT_CONFIG(opengl)
@@ -43,14 +45,20 @@ extern "C" {
 
 #include <QDir>
 #include <QSharedPointer>
-#include <QMutexLocker>
+#include <QThreadPool>
+#include <QtConcurrent/qtconcurrentrun.h>
+#include <QSettings>
+#include <QSysInfo>
 #include <atomic>
+#include <vector>
+#include <algorithm>
 #include <QDebug>
 
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavdevice/avdevice.h>
 #include <libavcodec/avcodec.h>
+#include <libavutil/time.h>
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(59, 0, 0)
 #include <libavcodec/bsf.h>
 #endif
@@ -92,22 +100,46 @@ public:
     AVBSFContext *bsf_ctx = nullptr;
 
     std::atomic_bool abortRequest = false;
-    mutable QMutex mutex;
+    mutable QAVMutex mutex {"QAVDemuxer"};
 
     bool seekable = false;
     QList<QAVStream> availableStreams;
     QList<QAVStream> currentVideoStreams;
     QList<QAVStream> currentAudioStreams;
     QList<QAVStream> currentSubtitleStreams;
+    // Updated per sent frame, not guarded by the mutex
     QList<QAVStream::Progress> progress;
+    mutable QAVMutex progressMutex {"QAVDemuxer::progress"};
+    // Read without the mutex, replaced when the selected streams are changed
+    std::shared_ptr<const QAVDemuxer::Routing> routing;
     QString inputFormat;
     QString inputVideoCodec;
     QMap<QString, QString> inputOptions;
     QMap<QString, QString> videoCodecOptions;
-
-    bool eof = false;
+    int intraOnlyDecoders = 0;
+    int decoderPriority = 1;
+    bool autoSelectVideoCodec = false;
+    bool codecsEnabled = true;
+    std::atomic_bool videoSideDataOnly {false};
+    QList<QAVDemuxer::Variant> variants;
+    int currentVariant = -1;
+    qint64 maxBandwidth = 0;
+    QSize maxResolution;
+    // Fastest decoder found for the best video stream
+    const AVCodec *autoVideoCodec = nullptr;
+    // Additional decoders of intra-only video streams by stream index
+    QMap<int, QList<QSharedPointer<QAVVideoCodec>>> intraDecoders;
+    mutable QThreadPool intraDecodersPool;
+
+    std::atomic_bool eof {false};
     QList<QAVPacket> packets;
     QString bsfs;
+    QAVDemuxer::Timings timings;
+
+    void resetCurrentStreams(int related);
+    void applyVariant(int index);
+    void selectVariant(const QList<QAVStream> &streams);
+    void updateRouting();
 };
 
 static void log_callback(void *ptr, int level, const char *fmt, va_list vl)
@@ -182,7 +214,7 @@ void QAVDemuxer::abort(bool stop)
     d->abortRequest = stop;
 }
 
-static int setup_video_codec(const QString &inputVideoCodec, AVStream *stream, QAVVideoCodec &codec, AVDictionary **codecOpts)
+static int setup_video_codec(const QString &inputVideoCodec, AVStream *stream, QAVVideoCodec &codec, AVDictionary **codecOpts, QAVDemuxer::Timings &timings, bool software)
 {
     const AVCodec *videoCodec = nullptr;
     if (!inputVideoCodec.isEmpty()) {
@@ -200,7 +232,8 @@ static int setup_video_codec(const QString &inputVideoCodec, AVStream *stream, Q
     QList<QSharedPointer<QAVHWDevice>> devices;
     QAVDictionaryHolder opts;
     Q_UNUSED(opts);
-    static const bool ignoreHW = qEnvironmentVariableIsSet("QT_AVPLAYER_NO_HWDEVICE");
+    static const bool noHWDevice = qEnvironmentVariableIsSet("QT_AVPLAYER_NO_HWDEVICE");
+    const bool ignoreHW = noHWDevice || software;
 
 #if defined(QT_AVPLAYER_VA_X11) && QT_CONFIG(opengl)
     devices.append(QSharedPointer<QAVHWDevice>(new QAVHWDevice_VAAPI_X11_GLX));
@@ -226,7 +259,8 @@ static int setup_video_codec(const QString &inputVideoCodec, AVStream *stream, Q
     av_jni_set_java_vm(vm, NULL);
 #endif
 
-    if (!ignoreHW) {
+    if (!ignoreHW && !devices.isEmpty()) {
+        const qint64 start = av_gettime_relative();
         AVBufferRef *hw_device_ctx = nullptr;
         for (auto &device : devices) {
             auto deviceName = av_hwdevice_get_type_name(device->type());
@@ -241,10 +275,14 @@ static int setup_video_codec(const QString &inputVideoCodec, AVStream *stream, Q
             }
             av_buffer_unref(&hw_device_ctx);
         }
+        timings.hwDeviceCreate[stream->index] = av_gettime_relative() - start;
     }
 
     // Open codec after hwdevices
-    if (!codec.open(stream, codecOpts)) {
+    const qint64 start = av_gettime_relative();
+    const bool opened = codec.open(stream, codecOpts);
+    timings.codecOpen[stream->index] = av_gettime_relative() - start;
+    if (!opened) {
         qWarning() << "Could not open video codec for stream";
         return AVERROR(EINVAL);
     }
@@ -351,10 +389,219 @@ static int apply_bsf(const QString &bsf, AVFormatContext *ctx, AVBSFContext *&bs
     return ret;
 }
 
+void QAVDemuxerPrivate::resetCurrentStreams(int related)
+{
+    currentVideoStreams.clear();
+    currentAudioStreams.clear();
+    currentSubtitleStreams.clear();
+
+    const int videoStreamIndex = av_find_best_stream(
+        ctx,
+        AVMEDIA_TYPE_VIDEO,
+        -1,
+        related,
+        nullptr,
+        0);
+    if (videoStreamIndex >= 0)
+        currentVideoStreams.push_back(availableStreams[videoStreamIndex]);
+
+    const int audioStreamIndex = av_find_best_stream(
+        ctx,
+        AVMEDIA_TYPE_AUDIO,
+        -1,
+        videoStreamIndex >= 0 ? videoStreamIndex : related,
+        nullptr,
+        0);
+    if (audioStreamIndex >= 0)
+        currentAudioStreams.push_back(availableStreams[audioStreamIndex]);
+
+    const int subtitleStreamIndex = av_find_best_stream(
+        ctx,
+        AVMEDIA_TYPE_SUBTITLE,
+        -1,
+        audioStreamIndex >= 0 ? audioStreamIndex : videoStreamIndex >= 0 ? videoStreamIndex : related,
+        nullptr,
+        0);
+    if (subtitleStreamIndex >= 0)
+        currentSubtitleStreams.push_back(availableStreams[subtitleStreamIndex]);
+    updateRouting();
+}
+
+static void routeStreams(
+    const QList<QAVStream> &streams,
+    AVMediaType type,
+    QVector<AVMediaType> &types,
+    int &first)
+{
+    for (const auto &stream : streams) {
+        if (stream.index() >= 0 && stream.index() < types.size())
+            types[stream.index()] = type;
+    }
+    first = !streams.isEmpty() ? streams.first().index() : -1;
+}
+
+void QAVDemuxerPrivate::updateRouting()
+{
+    auto r = std::make_shared<QAVDemuxer::Routing>();
+    r->types.fill(AVMEDIA_TYPE_UNKNOWN, availableStreams.size());
+    routeStreams(currentVideoStreams, AVMEDIA_TYPE_VIDEO, r->types, r->firstVideo);
+    routeStreams(currentAudioStreams, AVMEDIA_TYPE_AUDIO, r->types, r->firstAudio);
+    routeStreams(currentSubtitleStreams, AVMEDIA_TYPE_SUBTITLE, r->types, r->firstSubtitle);
+    // Only the first selected stream is master, others are synced against it
+    for (const auto &vs : currentVideoStreams) {
+        if (vs.stream()->disposition != AV_DISPOSITION_ATTACHED_PIC) {
+            r->masterVideo = vs.index();
+            break;
+        }
+    }
+    if (r->masterVideo < 0)
+        r->masterAudio = r->firstAudio;
+    std::atomic_store(&routing, std::shared_ptr<const QAVDemuxer::Routing>(std::move(r)));
+}
+
+// DASH exports all representations in one program, each video representation is a variant
+// and the other representations are shared between them
+static QList<QAVDemuxer::Variant> find_representations(const AVFormatContext *ctx)
+{
+    QList<QAVDemuxer::Variant> ret;
+    QList<int> shared;
+    for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+        const AVStream *stream = ctx->streams[i];
+        auto bitrate = av_dict_get(stream->metadata, "variant_bitrate", nullptr, 0);
+        if (!bitrate)
+            continue;
+        if (stream->codecpar->codec_type != AVMEDIA_TYPE_VIDEO) {
+            shared.push_back(int(i));
+            continue;
+        }
+        QAVDemuxer::Variant v;
+        // The program is never discarded
+        v.id = ctx->nb_programs ? ctx->programs[0]->id : -1;
+        v.bandwidth = QByteArray(bitrate->value).toLongLong();
+        v.size = QSize(stream->codecpar->width, stream->codecpar->height);
+        v.streams.push_back(int(i));
+        ret.push_back(v);
+    }
+    if (ret.size() < 2)
+        return {};
+    for (auto &v : ret)
+        v.streams += shared;
+    return ret;
+}
+
+static QList<QAVDemuxer::Variant> find_variants(const AVFormatContext *ctx)
+{
+    QList<QAVDemuxer::Variant> ret;
+    if (ctx->nb_programs < 2)
+        return find_representations(ctx);
+
+    for (unsigned i = 0; i < ctx->nb_programs; ++i) {
+        const AVProgram *p = ctx->programs[i];
+        QAVDemuxer::Variant v;
+        v.id = p->id;
+        auto bitrate = av_dict_get(p->metadata, "variant_bitrate", nullptr, 0);
+        if (bitrate)
+            v.bandwidth = QByteArray(bitrate->value).toLongLong();
+        qint64 bitrates = 0;
+        for (unsigned j = 0; j < p->nb_stream_indexes; ++j) {
+            const int index = int(p->stream_index[j]);
+            const auto codecpar = ctx->streams[index]->codecpar;
+            v.streams.push_back(index);
+            bitrates += codecpar->bit_rate;
+            if (codecpar->codec_type == AVMEDIA_TYPE_VIDEO && v.size.isEmpty())
+                v.size = QSize(codecpar->width, codecpar->height);
+        }
+        if (!v.bandwidth)
+            v.bandwidth = bitrates;
+        if (!v.streams.isEmpty())
+            ret.push_back(v);
+    }
+    return ret.size() > 1 ? ret : QList<QAVDemuxer::Variant>{};
+}
+
+// Highest bandwidth within the limits, or the lowest one
+static int select_variant(const QList<QAVDemuxer::Variant> &variants, qint64 maxBandwidth, const QSize &maxResolution)
+{
+    int best = -1;
+    int lowest = -1;
+    for (int i = 0; i < variants.size(); ++i) {
+        const auto &v = variants[i];
+        if (lowest < 0 || v.bandwidth < variants[lowest].bandwidth)
+            lowest = i;
+        if (maxBandwidth > 0 && v.bandwidth > maxBandwidth)
+            continue;
+        if (maxResolution.isValid() && !v.size.isEmpty()
+            && (v.size.width() > maxResolution.width() || v.size.height() > maxResolution.height()))
+        {
+            continue;
+        }
+        if (best < 0 || v.bandwidth > variants[best].bandwidth)
+            best = i;
+    }
+    return best >= 0 ? best : lowest;
+}
+
+void QAVDemuxerPrivate::applyVariant(int index)
+{
+    currentVariant = index;
+    const auto &selected = variants[index];
+    for (unsigned i = 0; i < ctx->nb_programs; ++i)
+        ctx->programs[i]->discard = ctx->programs[i]->id == selected.id ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+    // Streams could be shared between the variants, e.g. audio renditions
+    for (const auto &v : variants) {
+        for (int i : v.streams) {
+            if (!selected.streams.contains(i))
+                ctx->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+    for (int i : selected.streams)
+        ctx->streams[i]->discard = AVDISCARD_DEFAULT;
+
+    resetCurrentStreams(selected.streams.first());
+}
+
+// Discarded streams are not read, so the variant is switched to the one of the selected stream
+void QAVDemuxerPrivate::selectVariant(const QList<QAVStream> &streams)
+{
+    if (currentVariant < 0)
+        return;
+
+    for (const auto &stream : streams) {
+        const int index = stream.index();
+        if (index < 0 || index >= int(ctx->nb_streams) || variants[currentVariant].streams.contains(index))
+            continue;
+        for (int i = 0; i < variants.size(); ++i) {
+            if (variants[i].streams.contains(index)) {
+                applyVariant(i);
+                break;
+            }
+        }
+        break;
+    }
+
+    // Streams of several variants are selected
+    for (const auto &stream : streams) {
+        const int index = stream.index();
+        if (index < 0 || index >= int(ctx->nb_streams) || ctx->streams[index]->discard != AVDISCARD_ALL)
+            continue;
+        ctx->streams[index]->discard = AVDISCARD_DEFAULT;
+        for (unsigned i = 0; i < ctx->nb_programs; ++i) {
+            AVProgram *p = ctx->programs[i];
+            for (unsigned j = 0; j < p->nb_stream_indexes; ++j) {
+                if (int(p->stream_index[j]) == index)
+                    p->discard = AVDISCARD_DEFAULT;
+            }
+        }
+    }
+}
+
+static const AVCodec *fastest_decoder(const AVStream *stream, const QList<QAVPacket> &packets);
+
 int QAVDemuxer::load(const QString &url, QAVIODevice *dev)
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
 
     if (!d->ctx)
         d->ctx = avformat_alloc_context();
@@ -384,11 +631,15 @@ int QAVDemuxer::load(const QString &url, QAVIODevice *dev)
     for (const auto & key: d->inputOptions.keys())
         av_dict_set(&opts.dict, key.toUtf8().constData(), d->inputOptions[key].toUtf8().constData(),
                     0);
+    qint64 start = av_gettime_relative();
     int ret = avformat_open_input(&d->ctx, url.toUtf8().constData(), inputFormat, &opts.dict);
+    d->timings.openInput = av_gettime_relative() - start;
     if (ret < 0)
         return ret;
 
+    start = av_gettime_relative();
     ret = avformat_find_stream_info(d->ctx, NULL);
+    d->timings.findStreamInfo = av_gettime_relative() - start;
     if (ret < 0)
         return ret;
 
@@ -401,39 +652,43 @@ int QAVDemuxer::load(const QString &url, QAVIODevice *dev)
     d->seekable = true;
 #endif
 
+    // Packets used to select the decoder are returned by read() again
+    QList<QAVPacket> trialPackets;
+    d->autoVideoCodec = nullptr;
+    const int bestVideoIndex = d->codecsEnabled && d->autoSelectVideoCodec && d->inputVideoCodec.isEmpty() && d->bsfs.isEmpty()
+        ? av_find_best_stream(d->ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0) : -1;
+    if (bestVideoIndex >= 0) {
+        const int maxPackets = 60;
+        const int maxTotalPackets = 1024;
+        QList<QAVPacket> videoPackets;
+        while (videoPackets.size() < maxPackets && trialPackets.size() < maxTotalPackets && !d->abortRequest) {
+            QAVPacket pkt;
+            if (av_read_frame(d->ctx, pkt.packet()) < 0)
+                break;
+            trialPackets.append(pkt);
+            if (pkt.packet()->stream_index == bestVideoIndex)
+                videoPackets.append(pkt);
+        }
+        d->autoVideoCodec = fastest_decoder(d->ctx->streams[bestVideoIndex], videoPackets);
+        if (d->autoVideoCodec)
+            qDebug() << "Selected decoder:" << d->autoVideoCodec->name;
+    }
+
     ret = resetCodecs();
     if (ret < 0)
         return ret;
 
-    const int videoStreamIndex = av_find_best_stream(
-        d->ctx,
-        AVMEDIA_TYPE_VIDEO,
-        -1,
-        -1,
-        nullptr,
-        0);
-    if (videoStreamIndex >= 0)
-        d->currentVideoStreams.push_back(d->availableStreams[videoStreamIndex]);
-
-    const int audioStreamIndex = av_find_best_stream(
-        d->ctx,
-        AVMEDIA_TYPE_AUDIO,
-        -1,
-        videoStreamIndex,
-        nullptr,
-        0);
-    if (audioStreamIndex >= 0)
-        d->currentAudioStreams.push_back(d->availableStreams[audioStreamIndex]);
+    for (auto &pkt : trialPackets) {
+        if (pkt.packet()->stream_index < d->availableStreams.size())
+            pkt.setStream(d->availableStreams[pkt.packet()->stream_index]);
+    }
+    d->packets = trialPackets + d->packets;
 
-    const int subtitleStreamIndex = av_find_best_stream(
-        d->ctx,
-        AVMEDIA_TYPE_SUBTITLE,
-        -1,
-        audioStreamIndex >= 0 ? audioStreamIndex : videoStreamIndex,
-        nullptr,
-        0);
-    if (subtitleStreamIndex >= 0)
-        d->currentSubtitleStreams.push_back(d->availableStreams[subtitleStreamIndex]);
+    d->variants = find_variants(d->ctx);
+    if (!d->variants.isEmpty())
+        d->applyVariant(select_variant(d->variants, d->maxBandwidth, d->maxResolution));
+    else
+        d->resetCurrentStreams(-1);
 
     if (ret < 0)
         return ret;
@@ -444,17 +699,121 @@ int QAVDemuxer::load(const QString &url, QAVIODevice *dev)
     return 0;
 }
 
+// Returns decoded frames per second, 0 if the decoder failed
+static double measure_decoder(const AVCodec *codec, const AVStream *stream, const QList<QAVPacket> &packets, int &frames)
+{
+    frames = 0;
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    if (!avctx)
+        return 0;
+
+    double fps = 0;
+    avctx->pkt_timebase = stream->time_base;
+    // Compared on one thread, the threads are shared by all decoders anyway
+    avctx->thread_count = 1;
+    if (avcodec_parameters_to_context(avctx, stream->codecpar) >= 0 && avcodec_open2(avctx, codec, nullptr) >= 0) {
+        AVFrame *frame = av_frame_alloc();
+        bool failed = false;
+        const qint64 start = av_gettime_relative();
+        for (int i = 0; i <= packets.size() && !failed; ++i) {
+            int sent = 0;
+            do {
+                sent = avcodec_send_packet(avctx, i < packets.size() ? packets[i].packet() : nullptr);
+                int ret = 0;
+                while ((ret = avcodec_receive_frame(avctx, frame)) >= 0) {
+                    ++frames;
+                    av_frame_unref(frame);
+                }
+                if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+                    failed = true;
+            } while (sent == AVERROR(EAGAIN) && !failed);
+            if (sent < 0 && sent != AVERROR(EAGAIN))
+                failed = true;
+        }
+        const qint64 elapsed = av_gettime_relative() - start;
+        if (!failed && frames > 0)
+            fps = frames * 1000000.0 / qMax<qint64>(1, elapsed);
+        av_frame_free(&frame);
+    }
+    avcodec_free_context(&avctx);
+    return fps;
+}
+
+// Trial-decodes the packets with each software decoder of the stream, results are cached per machine
+static const AVCodec *fastest_decoder(const AVStream *stream, const QList<QAVPacket> &packets)
+{
+    auto codecpar = stream->codecpar;
+    QList<const AVCodec *> candidates;
+    for (const auto &name : QAVDemuxer::supportedVideoCodecs()) {
+        auto c = avcodec_find_decoder_by_name(name.toLatin1().constData());
+        if (c && c->id == codecpar->codec_id
+            && !(c->capabilities & (AV_CODEC_CAP_HARDWARE | AV_CODEC_CAP_EXPERIMENTAL)))
+        {
+            candidates.push_back(c);
+        }
+    }
+    if (candidates.size() < 2)
+        return nullptr;
+
+    const char *profile = avcodec_profile_name(codecpar->codec_id, codecpar->profile);
+    QString machine = QString::fromLatin1(QSysInfo::machineUniqueId().toHex());
+    if (machine.isEmpty())
+        machine = QSysInfo::machineHostName();
+    const QString key = QString(QLatin1String("%1/%2_%3_%4_%5p/%6"))
+        .arg(machine)
+        .arg(QLatin1String(avcodec_get_name(codecpar->codec_id)))
+        .arg(profile ? QLatin1String(profile) : QString::number(codecpar->profile))
+        .arg(codecpar->format)
+        .arg(codecpar->height)
+        .arg(avcodec_version());
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, QLatin1String("QtAVPlayer"), QLatin1String("decoders"));
+    const QString cached = settings.value(key).toString();
+    for (auto c : candidates) {
+        if (cached == QLatin1String(c->name))
+            return c;
+    }
+
+    // Decoders which return less frames are skipped
+    const AVCodec *result = nullptr;
+    double fastest = 0;
+    int maxFrames = 0;
+    for (auto c : candidates) {
+        int frames = 0;
+        const double fps = measure_decoder(c, stream, packets, frames);
+        qDebug() << "Decoder" << c->name << "fps:" << fps << "frames:" << frames;
+        if (fps <= 0 || frames < maxFrames)
+            continue;
+        if (frames > maxFrames || fps > fastest) {
+            result = c;
+            fastest = fps;
+            maxFrames = frames;
+        }
+    }
+
+    if (result)
+        settings.setValue(key, QLatin1String(result->name));
+    return result;
+}
+
+static bool is_intra_only(const AVStream *stream)
+{
+    auto desc = avcodec_descriptor_get(stream->codecpar->codec_id);
+    return desc && (desc->props & AV_CODEC_PROP_INTRA_ONLY);
+}
+
 int QAVDemuxer::resetCodecs()
 {
     Q_D(QAVDemuxer);
     int ret = 0;
+    // Frame threading delays the frames of live sources
+    const bool live = d->ctx->duration <= 0 || !d->seekable;
     for (std::size_t i = 0; i < d->ctx->nb_streams && ret >= 0; ++i) {
         if (!d->ctx->streams[i]->codecpar) {
             qWarning() << "Could not find codecpar";
             return AVERROR(EINVAL);
         }
 
-        const AVMediaType type = d->ctx->streams[i]->codecpar->codec_type;
+        const AVMediaType type = d->codecsEnabled ? d->ctx->streams[i]->codecpar->codec_type : AVMEDIA_TYPE_UNKNOWN;
         switch (type) {
             case AVMEDIA_TYPE_VIDEO:
             {
@@ -462,55 +821,116 @@ int QAVDemuxer::resetCodecs()
                 for (const auto & key: d->videoCodecOptions.keys())
                     av_dict_set(&opts.dict, key.toUtf8().constData(), d->videoCodecOptions[key].toUtf8().constData(), 0);
 
-                QSharedPointer<QAVCodec> codec(new QAVVideoCodec);
+                auto stream = d->ctx->streams[i];
+                const bool intraOnly = d->intraOnlyDecoders > 1 && is_intra_only(stream);
+                QSharedPointer<QAVVideoCodec> codec(new QAVVideoCodec);
+                // Frame threading delays the output, so the frames could not be merged in order
+                if (intraOnly)
+                    codec->avctx()->thread_type = FF_THREAD_SLICE;
+                codec->setThreadPriority(d->decoderPriority);
+                codec->setLowDelay(live);
                 d->availableStreams.push_back({ int(i), d->ctx, codec });
-                ret = setup_video_codec(d->inputVideoCodec, d->ctx->streams[i], *static_cast<QAVVideoCodec *>(codec.data()), &opts.dict);
+                QString codecName = d->inputVideoCodec;
+                if (codecName.isEmpty() && d->autoVideoCodec && d->autoVideoCodec->id == stream->codecpar->codec_id)
+                    codecName = QLatin1String(d->autoVideoCodec->name);
+                // Side data is exported by software decoders, pixels are not needed
+                if (d->videoSideDataOnly) {
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 93, 100)
+                    codec->avctx()->export_side_data |= AV_CODEC_EXPORT_DATA_MVS | AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS;
+#else
+                    codec->avctx()->flags2 |= AV_CODEC_FLAG2_EXPORT_MVS;
+#endif
+                    codec->avctx()->skip_loop_filter = AVDISCARD_ALL;
+                }
+                ret = setup_video_codec(codecName, stream, *codec, &opts.dict, d->timings, d->videoSideDataOnly);
+                if (ret >= 0 && intraOnly && !codec->device()) {
+                    const qint64 start = av_gettime_relative();
+                    auto &decoders = d->intraDecoders[int(i)];
+                    for (int n = 1; n < d->intraOnlyDecoders; ++n) {
+                        QAVDictionaryHolder decoderOpts;
+                        for (const auto & key: d->videoCodecOptions.keys())
+                            av_dict_set(&decoderOpts.dict, key.toUtf8().constData(), d->videoCodecOptions[key].toUtf8().constData(), 0);
+                        QSharedPointer<QAVVideoCodec> decoder(new QAVVideoCodec(codec->codec()));
+                        decoder->avctx()->thread_type = FF_THREAD_SLICE;
+                        decoder->setThreadPriority(d->decoderPriority);
+                        if (!decoder->open(stream, &decoderOpts.dict)) {
+                            qWarning() << "Could not open intra-only decoder for stream:" << i;
+                            break;
+                        }
+                        decoders.push_back(decoder);
+                    }
+                    d->timings.codecOpen[int(i)] += av_gettime_relative() - start;
+                    qDebug() << "Using" << decoders.size() + 1 << "intra-only decoders for stream:" << i;
+                }
             } break;
-            case AVMEDIA_TYPE_AUDIO:
+            case AVMEDIA_TYPE_AUDIO: {
                 d->availableStreams.push_back({ int(i), d->ctx, QSharedPointer<QAVCodec>(new QAVAudioCodec) });
+                const qint64 start = av_gettime_relative();
                 if (!d->availableStreams.last().codec()->open(d->ctx->streams[i]))
                     qWarning() << "Could not open audio codec for stream:" << i;
-                break;
-            case AVMEDIA_TYPE_SUBTITLE:
+                d->timings.codecOpen[int(i)] = av_gettime_relative() - start;
+            } break;
+            case AVMEDIA_TYPE_SUBTITLE: {
                 d->availableStreams.push_back({ int(i), d->ctx, QSharedPointer<QAVCodec>(new QAVSubtitleCodec) });
+                const qint64 start = av_gettime_relative();
                 if (!d->availableStreams.last().codec()->open(d->ctx->streams[i]))
                     qWarning() << "Could not open subtitle codec for stream:" << i;
-                break;
+                d->timings.codecOpen[int(i)] = av_gettime_relative() - start;
+            } break;
             default:
                 // Adding default stream
                 d->availableStreams.push_back({ int(i), d->ctx, nullptr });
                 break;
         }
         auto &s = d->availableStreams[int(i)];
+        QAVMutexLocker progressLocker(&d->progressMutex);
         d->progress.push_back({ s.duration(), s.framesCount(), s.frameRate() });
+        auto avctx = s.codec() ? s.codec()->avctx() : nullptr;
+        if (avctx && avcodec_is_open(avctx))
+            d->progress.last().setDecoderThreads(avctx->thread_count, avctx->active_thread_type & FF_THREAD_FRAME);
     }
 
+    int threads = 0;
+    for (const auto &decoders : d->intraDecoders)
+        threads += decoders.size();
+    d->intraDecodersPool.setMaxThreadCount(qMax(1, threads));
+
     return ret;
 }
 
-static bool findStream(
-    const QList<QAVStream> &streams,
-    int index)
+std::shared_ptr<const QAVDemuxer::Routing> QAVDemuxer::routing() const
 {
-    for (const auto &stream: streams) {
-        if (index == stream.index())
-            return true;
+    Q_D(const QAVDemuxer);
+    auto r = std::atomic_load(&d->routing);
+    if (!r) {
+        static const auto empty = std::make_shared<const Routing>();
+        return empty;
     }
-    return false;
+    return r;
 }
 
-AVMediaType QAVDemuxer::currentCodecType(int index) const
+AVMediaType QAVDemuxer::Routing::type(int index, bool *first) const
 {
-    Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
-    // TODO:
-    if (findStream(d->currentVideoStreams, index))
-        return AVMEDIA_TYPE_VIDEO;
-    if (findStream(d->currentAudioStreams, index))
-        return AVMEDIA_TYPE_AUDIO;
-    if (findStream(d->currentSubtitleStreams, index))
-        return AVMEDIA_TYPE_SUBTITLE;
-    return AVMEDIA_TYPE_UNKNOWN;
+    const auto t = index >= 0 && index < types.size() ? types[index] : AVMEDIA_TYPE_UNKNOWN;
+    if (first) {
+        switch (t) {
+            case AVMEDIA_TYPE_VIDEO: *first = index == firstVideo; break;
+            case AVMEDIA_TYPE_AUDIO: *first = index == firstAudio; break;
+            case AVMEDIA_TYPE_SUBTITLE: *first = index == firstSubtitle; break;
+            default: break;
+        }
+    }
+    return t;
+}
+
+bool QAVDemuxer::Routing::isMaster(int index) const
+{
+    return index >= 0 && (index == masterVideo || index == masterAudio);
+}
+
+AVMediaType QAVDemuxer::currentCodecType(int index, bool *first) const
+{
+    return routing()->type(index, first);
 }
 
 static QList<QAVStream> availableStreamsByType(
@@ -529,21 +949,21 @@ static QList<QAVStream> availableStreamsByType(
 QList<QAVStream> QAVDemuxer::availableStreams() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return d->availableStreams;
 }
 
 QList<QAVStream> QAVDemuxer::availableVideoStreams() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return availableStreamsByType(d->availableStreams, AVMEDIA_TYPE_VIDEO);
 }
 
 QList<QAVStream> QAVDemuxer::currentVideoStreams() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return d->currentVideoStreams;
 }
 
@@ -573,18 +993,24 @@ static bool setCurrentStreams(
 bool QAVDemuxer::setVideoStreams(const QList<QAVStream> &streams)
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
-    return setCurrentStreams(
-        streams,
-        d->availableStreams,
-        AVMEDIA_TYPE_VIDEO,
-        d->currentVideoStreams);
+    QAVMutexLocker locker(&d->mutex);
+    d->selectVariant(streams);
+    if (!setCurrentStreams(
+            streams,
+            d->availableStreams,
+            AVMEDIA_TYPE_VIDEO,
+            d->currentVideoStreams))
+    {
+        return false;
+    }
+    d->updateRouting();
+    return true;
 }
 
 QList<QAVStream> QAVDemuxer::availableAudioStreams() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return availableStreamsByType(
         d->availableStreams,
         AVMEDIA_TYPE_AUDIO);
@@ -593,25 +1019,31 @@ QList<QAVStream> QAVDemuxer::availableAudioStreams() const
 QList<QAVStream> QAVDemuxer::currentAudioStreams() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return d->currentAudioStreams;
 }
 
 bool QAVDemuxer::setAudioStreams(const QList<QAVStream> &streams)
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
-    return setCurrentStreams(
-        streams,
-        d->availableStreams,
-        AVMEDIA_TYPE_AUDIO,
-        d->currentAudioStreams);
+    QAVMutexLocker locker(&d->mutex);
+    d->selectVariant(streams);
+    if (!setCurrentStreams(
+            streams,
+            d->availableStreams,
+            AVMEDIA_TYPE_AUDIO,
+            d->currentAudioStreams))
+    {
+        return false;
+    }
+    d->updateRouting();
+    return true;
 }
 
 QList<QAVStream> QAVDemuxer::availableSubtitleStreams() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return availableStreamsByType(
         d->availableStreams,
         AVMEDIA_TYPE_SUBTITLE);
@@ -620,32 +1052,38 @@ QList<QAVStream> QAVDemuxer::availableSubtitleStreams() const
 QList<QAVStream> QAVDemuxer::currentSubtitleStreams() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return d->currentSubtitleStreams;
 }
 
 bool QAVDemuxer::setSubtitleStreams(const QList<QAVStream> &streams)
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
-    return setCurrentStreams(
-        streams,
-        d->availableStreams,
-        AVMEDIA_TYPE_SUBTITLE,
-        d->currentSubtitleStreams);
+    QAVMutexLocker locker(&d->mutex);
+    d->selectVariant(streams);
+    if (!setCurrentStreams(
+            streams,
+            d->availableStreams,
+            AVMEDIA_TYPE_SUBTITLE,
+            d->currentSubtitleStreams))
+    {
+        return false;
+    }
+    d->updateRouting();
+    return true;
 }
 
 AVFormatContext *QAVDemuxer::avctx() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return d->ctx;
 }
 
 void QAVDemuxer::unload()
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     if (d->ctx) {
         avformat_close_input(&d->ctx);
         avformat_free_context(d->ctx);
@@ -657,7 +1095,16 @@ void QAVDemuxer::unload()
     d->currentAudioStreams.clear();
     d->currentSubtitleStreams.clear();
     d->availableStreams.clear();
-    d->progress.clear();
+    d->updateRouting();
+    {
+        QAVMutexLocker progressLocker(&d->progressMutex);
+        d->progress.clear();
+    }
+    d->timings = {};
+    d->intraDecoders.clear();
+    d->packets.clear();
+    d->variants.clear();
+    d->currentVariant = -1;
     av_bsf_free(&d->bsf_ctx);
     d->bsf_ctx = nullptr;
 }
@@ -665,7 +1112,6 @@ void QAVDemuxer::unload()
 bool QAVDemuxer::eof() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
     return d->eof;
 }
 
@@ -673,7 +1119,7 @@ QAVPacket QAVDemuxer::read()
 {
     Q_D(QAVDemuxer);
     {
-        QMutexLocker locker(&d->mutex);
+        QAVMutexLocker locker(&d->mutex);
         if (!d->packets.isEmpty())
             return d->packets.takeFirst();
 
@@ -693,15 +1139,19 @@ QAVPacket QAVDemuxer::read()
         }
     }
     {
-        QMutexLocker locker(&d->mutex);
+        QAVMutexLocker locker(&d->mutex);
         d->eof = eof;
         if (pkt.packet()->stream_index < d->availableStreams.size())
             pkt.setStream(d->availableStreams[pkt.packet()->stream_index]);
+        auto &allocations = QAVAllocations::instance();
+        allocations.track(QAVAllocations::Demuxer, pkt.packet()->stream_index, pkt.packet());
         if (d->bsf_ctx) {
             ret = av_bsf_send_packet(d->bsf_ctx, d->eof ? NULL : pkt.packet());
             if (ret >= 0) {
-                while ((ret = av_bsf_receive_packet(d->bsf_ctx, pkt.packet())) >= 0)
+                while ((ret = av_bsf_receive_packet(d->bsf_ctx, pkt.packet())) >= 0) {
+                    allocations.track(QAVAllocations::Demuxer, pkt.packet()->stream_index, pkt.packet());
                     d->packets.append(pkt);
+                }
             }
             if (ret < 0 && ret != AVERROR_EOF && ret != AVERROR(EAGAIN)) {
                 qWarning() << "Error applying bitstream filters to an output:" << ret;
@@ -713,13 +1163,55 @@ QAVPacket QAVDemuxer::read()
     return pkt;
 }
 
-void QAVDemuxer::decode(const QAVPacket &pkt, QList<QAVFrame> &frames) const
+QAVFrame QAVDemuxer::posterFrame(qint64 *firstPacketTime)
+{
+    Q_D(QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    if (!d->ctx || d->currentVideoStreams.isEmpty())
+        return {};
+    const QAVStream stream = d->currentVideoStreams.first();
+    locker.unlock();
+
+    QList<QAVFrame> frames;
+    AVStream *s = stream.stream();
+    if (s->disposition & AV_DISPOSITION_ATTACHED_PIC) {
+        // Cover art is already read during avformat_open_input()
+        QAVPacket pkt;
+        if (av_packet_ref(pkt.packet(), &s->attached_pic) >= 0) {
+            if (firstPacketTime)
+                *firstPacketTime = av_gettime_relative();
+            pkt.setStream(stream);
+            decode(pkt, frames);
+        }
+    } else {
+        // Read packets until the first frame is decoded,
+        // and keep them to be returned by read() again
+        const int maxPackets = 256;
+        QList<QAVPacket> packets;
+        while (frames.isEmpty() && packets.size() < maxPackets && !d->abortRequest) {
+            auto pkt = read();
+            if (!pkt.stream())
+                break;
+            if (firstPacketTime && packets.isEmpty())
+                *firstPacketTime = av_gettime_relative();
+            packets.append(pkt);
+            if (pkt.packet()->stream_index == stream.index())
+                decode(pkt, frames);
+        }
+        locker.relock();
+        d->packets = packets + d->packets;
+        locker.unlock();
+    }
+
+    flushCodecBuffers();
+    return !frames.isEmpty() ? frames.first() : QAVFrame{};
+}
+
+static void decode_packet(QAVCodec &codec, const QAVPacket &pkt, QList<QAVFrame> &frames)
 {
-    if (!pkt.stream())
-        return;
     int sent = 0;
     do {
-        sent = pkt.send();
+        sent = codec.write(pkt);
         // AVERROR(EAGAIN): input is not accepted in the current state - user must read output with avcodec_receive_frame()
         // (once all output is read, the packet should be resent, and the call will not fail with EAGAIN)
         if (sent < 0 && sent != AVERROR(EAGAIN))
@@ -729,14 +1221,22 @@ void QAVDemuxer::decode(const QAVPacket &pkt, QList<QAVFrame> &frames) const
             QAVFrame frame;
             frame.setStream(pkt.stream());
             // AVERROR(EAGAIN): output is not available in this state - user must try to send new input
-            int received = frame.receive();
+            int received = codec.read(frame);
             if (received < 0)
                 break;
+            QAVAllocations::instance().track(QAVAllocations::Decoder, pkt.stream().index(), frame.frame());
             frames.push_back(frame);
         }
     } while (sent == AVERROR(EAGAIN));
 }
 
+void QAVDemuxer::decode(const QAVPacket &pkt, QList<QAVFrame> &frames) const
+{
+    if (!pkt.stream())
+        return;
+    decode_packet(*pkt.stream().codec(), pkt, frames);
+}
+
 void QAVDemuxer::decode(const QAVPacket &pkt, QList<QAVSubtitleFrame> &frames) const
 {
     if (!pkt.stream())
@@ -751,15 +1251,83 @@ void QAVDemuxer::decode(const QAVPacket &pkt, QList<QAVSubtitleFrame> &frames) c
         frames.push_back(frame);
 }
 
+void QAVDemuxer::decode(const QList<QAVPacket> &pkts, QList<QAVFrame> &frames) const
+{
+    Q_D(const QAVDemuxer);
+    if (pkts.isEmpty() || !pkts.first().stream())
+        return;
+    if (pkts.size() == 1) {
+        decode(pkts.first(), frames);
+        return;
+    }
+
+    QList<QSharedPointer<QAVVideoCodec>> decoders;
+    {
+        QAVMutexLocker locker(&d->mutex);
+        decoders = d->intraDecoders.value(pkts.first().stream().index());
+    }
+
+    // Every packet of intra-only stream is decoded independently by own decoder,
+    // the first one is decoded by the stream's codec on the current thread
+    std::vector<QList<QAVFrame>> decoded(pkts.size());
+    const int count = decoders.size() + 1;
+    for (int i = 0; i < pkts.size(); i += count) {
+        QList<QFuture<void>> futures;
+        for (int j = 1; j < count && i + j < pkts.size(); ++j) {
+            const int n = i + j;
+            auto decoder = decoders[j - 1];
+            futures.push_back(QtConcurrent::run(&d->intraDecodersPool, [&pkts, &decoded, decoder, n] {
+                decode_packet(*decoder, pkts[n], decoded[n]);
+            }));
+        }
+        decode(pkts[i], decoded[i]);
+        for (auto &future : futures)
+            future.waitForFinished();
+    }
+
+    QList<QAVFrame> result;
+    bool hasPts = true;
+    for (const auto &list : decoded) {
+        for (const auto &frame : list) {
+            hasPts &= frame.frame()->best_effort_timestamp != AV_NOPTS_VALUE;
+            result.push_back(frame);
+        }
+    }
+    if (hasPts) {
+        std::stable_sort(result.begin(), result.end(), [](const QAVFrame &a, const QAVFrame &b) {
+            return a.frame()->best_effort_timestamp < b.frame()->best_effort_timestamp;
+        });
+    }
+    frames += result;
+}
+
+void QAVDemuxer::decode(const QList<QAVPacket> &pkts, QList<QAVSubtitleFrame> &frames) const
+{
+    for (const auto &pkt : pkts)
+        decode(pkt, frames);
+}
+
+int QAVDemuxer::decoders(const QAVStream &stream) const
+{
+    Q_D(const QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    auto it = d->intraDecoders.constFind(stream.index());
+    return it != d->intraDecoders.constEnd() ? it->size() + 1 : 1;
+}
+
 void QAVDemuxer::flushCodecBuffers()
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     for (auto &s: d->availableStreams) {
         auto c = s.codec();
         if (c)
             c->flushBuffers();
     }
+    for (const auto &decoders : d->intraDecoders) {
+        for (const auto &decoder : decoders)
+            decoder->flushBuffers();
+    }
 }
 
 bool QAVDemuxer::seekable() const
@@ -770,11 +1338,12 @@ bool QAVDemuxer::seekable() const
 int QAVDemuxer::seek(double sec)
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     if (!d->ctx || !d->seekable)
         return AVERROR(EINVAL);
 
     d->eof = false;
+    d->packets.clear();
     locker.unlock();
 
     int flags = AVSEEK_FLAG_BACKWARD;
@@ -796,7 +1365,7 @@ double QAVDemuxer::duration() const
 double QAVDemuxer::videoFrameRate() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     if (d->currentVideoStreams.isEmpty())
         return 0.0;
     // TODO:
@@ -828,14 +1397,14 @@ QMap<QString, QString> QAVDemuxer::metadata() const
 QString QAVDemuxer::bitstreamFilter() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return d->bsfs;
 }
 
 int QAVDemuxer::applyBitstreamFilter(const QString &bsfs)
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     d->bsfs = bsfs;
     int ret = 0;
     if (d->ctx) {
@@ -849,63 +1418,185 @@ int QAVDemuxer::applyBitstreamFilter(const QString &bsfs)
 QString QAVDemuxer::inputFormat() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return d->inputFormat;
 }
 
 void QAVDemuxer::setInputFormat(const QString &format)
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     d->inputFormat = format;
 }
 
 QString QAVDemuxer::inputVideoCodec() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return d->inputVideoCodec;
 }
 
 void QAVDemuxer::setInputVideoCodec(const QString &codec)
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     d->inputVideoCodec = codec;
 }
 
+int QAVDemuxer::intraOnlyDecoders() const
+{
+    Q_D(const QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    return d->intraOnlyDecoders;
+}
+
+void QAVDemuxer::setIntraOnlyDecoders(int count)
+{
+    Q_D(QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    d->intraOnlyDecoders = count;
+}
+
+int QAVDemuxer::decoderPriority() const
+{
+    Q_D(const QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    return d->decoderPriority;
+}
+
+void QAVDemuxer::setDecoderPriority(int priority)
+{
+    Q_D(QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    d->decoderPriority = priority;
+}
+
+bool QAVDemuxer::autoSelectVideoCodec() const
+{
+    Q_D(const QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    return d->autoSelectVideoCodec;
+}
+
+void QAVDemuxer::setAutoSelectVideoCodec(bool enabled)
+{
+    Q_D(QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    d->autoSelectVideoCodec = enabled;
+}
+
+bool QAVDemuxer::codecsEnabled() const
+{
+    Q_D(const QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    return d->codecsEnabled;
+}
+
+void QAVDemuxer::setCodecsEnabled(bool enabled)
+{
+    Q_D(QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    d->codecsEnabled = enabled;
+}
+
+bool QAVDemuxer::videoSideDataOnly() const
+{
+    Q_D(const QAVDemuxer);
+    // Checked per sent frame
+    return d->videoSideDataOnly;
+}
+
+void QAVDemuxer::setVideoSideDataOnly(bool enabled)
+{
+    Q_D(QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    d->videoSideDataOnly = enabled;
+}
+
+QList<QAVDemuxer::Variant> QAVDemuxer::variants() const
+{
+    Q_D(const QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    return d->variants;
+}
+
+int QAVDemuxer::currentVariant() const
+{
+    Q_D(const QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    return d->currentVariant;
+}
+
+bool QAVDemuxer::setVariant(int index)
+{
+    Q_D(QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    if (index < 0 || index >= d->variants.size())
+        return false;
+    d->applyVariant(index);
+    return true;
+}
+
+qint64 QAVDemuxer::maxBandwidth() const
+{
+    Q_D(const QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    return d->maxBandwidth;
+}
+
+void QAVDemuxer::setMaxBandwidth(qint64 bandwidth)
+{
+    Q_D(QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    d->maxBandwidth = bandwidth;
+}
+
+QSize QAVDemuxer::maxResolution() const
+{
+    Q_D(const QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    return d->maxResolution;
+}
+
+void QAVDemuxer::setMaxResolution(const QSize &size)
+{
+    Q_D(QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    d->maxResolution = size;
+}
+
 QMap<QString, QString> QAVDemuxer::inputOptions() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return d->inputOptions;
 }
 
 void QAVDemuxer::setInputOptions(const QMap<QString, QString> &opts)
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     d->inputOptions = opts;
 }
 
 QMap<QString, QString> QAVDemuxer::videoCodecOptions() const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     return d->videoCodecOptions;
 }
 
 void QAVDemuxer::setVideoCodecOptions(const QMap<QString, QString> &opts)
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->mutex);
     d->videoCodecOptions = opts;
 }
 
 void QAVDemuxer::onFrameSent(const QAVStreamFrame &frame)
 {
     Q_D(QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->progressMutex);
     int index = frame.stream().index();
     if (index >= 0 && index < d->progress.size())
         d->progress[index].onFrameSent(frame.pts());
@@ -913,31 +1604,29 @@ void QAVDemuxer::onFrameSent(const QAVStreamFrame &frame)
 
 bool QAVDemuxer::isMasterStream(const QAVStream &stream) const
 {
-    auto s = stream.stream();
-    switch (s->codecpar->codec_type) {
-        case AVMEDIA_TYPE_VIDEO:
-            return s->disposition != AV_DISPOSITION_ATTACHED_PIC;
-        case AVMEDIA_TYPE_AUDIO:
-            // Check if there are any video streams available
-            for (const auto &vs: currentVideoStreams()) {
-                if (vs.stream()->disposition != AV_DISPOSITION_ATTACHED_PIC)
-                    return false;
-            }
-            return true;
-        default:
-            Q_ASSERT(false);
-            return false;
-    }
+    return routing()->isMaster(stream.index());
+}
+
+QAVDemuxer::Timings QAVDemuxer::timings() const
+{
+    Q_D(const QAVDemuxer);
+    QAVMutexLocker locker(&d->mutex);
+    return d->timings;
 }
 
 QAVStream::Progress QAVDemuxer::progress(const QAVStream &s) const
 {
     Q_D(const QAVDemuxer);
-    QMutexLocker locker(&d->mutex);
+    QAVMutexLocker locker(&d->progressMutex);
     int index = s.index();
-    if (index >= 0 && index < d->progress.size())
-        return d->progress[index];
-    return {};
+    if (index < 0 || index >= d->progress.size())
+        return {};
+    auto progress = d->progress[index];
+    // Decoders are reopened when the thread budget is rebalanced
+    auto codec = s.codec();
+    if (codec && codec->threadCount() > 0)
+        progress.setDecoderThreads(codec->threadCount(), codec->isFrameThreading());
+    return progress;
 }
 
 QStringList QAVDemuxer::supportedBitstreamFilters()
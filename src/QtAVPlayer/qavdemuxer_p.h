@@ -24,6 +24,8 @@
 #include "qavframe.h"
 #include "qavsubtitleframe.h"
 #include <QMap>
+#include <QSize>
+#include <QVector>
 #include <memory>
 
 QT_BEGIN_NAMESPACE
@@ -48,7 +50,26 @@ public:
     int load(const QString &url, QAVIODevice *dev = nullptr);
     void unload();
 
-    AVMediaType currentCodecType(int index) const;
+    // Immutable snapshot of the selected streams, replaced when the selection is changed
+    struct Routing
+    {
+        // Media types by stream index, AVMEDIA_TYPE_UNKNOWN if not selected
+        QVector<AVMediaType> types;
+        // First selected stream of each type, -1 if none
+        int firstVideo = -1;
+        int firstAudio = -1;
+        int firstSubtitle = -1;
+        // Streams the playback is synced against
+        int masterVideo = -1;
+        int masterAudio = -1;
+
+        AVMediaType type(int index, bool *first = nullptr) const;
+        bool isMaster(int index) const;
+    };
+    // Lock-free, could be kept by readers while the selection is changed
+    std::shared_ptr<const Routing> routing() const;
+
+    AVMediaType currentCodecType(int index, bool *first = nullptr) const;
 
     QList<QAVStream> availableStreams() const;
 
@@ -67,9 +88,16 @@ public:
     AVFormatContext *avctx() const;
 
     QAVPacket read();
+    // Returns av_gettime_relative() of the first packet read in firstPacketTime
+    QAVFrame posterFrame(qint64 *firstPacketTime = nullptr);
 
     void decode(const QAVPacket &pkt, QList<QAVFrame> &frames) const;
     void decode(const QAVPacket &pkt, QList<QAVSubtitleFrame> &frames) const;
+    // Decodes packets of the same stream at once, see decoders()
+    void decode(const QList<QAVPacket> &pkts, QList<QAVFrame> &frames) const;
+    void decode(const QList<QAVPacket> &pkts, QList<QAVSubtitleFrame> &frames) const;
+    // How many packets of the stream could be decoded in parallel
+    int decoders(const QAVStream &stream) const;
     void flushCodecBuffers();
 
     double duration() const;
@@ -95,11 +123,62 @@ public:
     QMap<QString, QString> videoCodecOptions() const;
     void setVideoCodecOptions(const QMap<QString, QString> &opts);
 
+    int intraOnlyDecoders() const;
+    void setIntraOnlyDecoders(int count);
+
+    // Weight of the video decoders in the process-wide thread budget
+    int decoderPriority() const;
+    void setDecoderPriority(int priority);
+
+    // Picks the fastest software decoder of the video stream on load
+    bool autoSelectVideoCodec() const;
+    void setAutoSelectVideoCodec(bool enabled);
+
+    // Streams are loaded without codecs, only packets could be read
+    bool codecsEnabled() const;
+    void setCodecsEnabled(bool enabled);
+
+    // Video decoders export motion vectors and quantizers, hardware decoding is disabled
+    bool videoSideDataOnly() const;
+    void setVideoSideDataOnly(bool enabled);
+
+    // Programs of adaptive streams, e.g. HLS variants,
+    // or video representations of DASH
+    struct Variant
+    {
+        int id = -1;
+        qint64 bandwidth = 0;
+        QSize size;
+        // Indexes of the streams
+        QList<int> streams;
+    };
+    QList<Variant> variants() const;
+    int currentVariant() const;
+    // Streams of other variants are discarded and not downloaded,
+    // the demuxer switches to the new streams at segment boundaries.
+    // Selecting a stream of another variant switches to that variant.
+    bool setVariant(int index);
+    // Limits to select the variant on load, the one with max bandwidth is used
+    qint64 maxBandwidth() const;
+    void setMaxBandwidth(qint64 bandwidth);
+    QSize maxResolution() const;
+    void setMaxResolution(const QSize &size);
+
     void onFrameSent(const QAVStreamFrame &frame);
     QAVStream::Progress progress(const QAVStream &s) const;
 
     bool isMasterStream(const QAVStream &stream) const;
 
+    // Durations of loading steps in microseconds, -1 if not measured
+    struct Timings
+    {
+        qint64 openInput = -1;
+        qint64 findStreamInfo = -1;
+        QMap<int, qint64> codecOpen;
+        QMap<int, qint64> hwDeviceCreate;
+    };
+    Timings timings() const;
+
     static QStringList supportedFormats();
     static QStringList supportedVideoCodecs();
     static QStringList supportedProtocols();
@@ -140,7 +140,6 @@ static int readFrames(
     const std::vector<std::unique_ptr<QAVFilter>> &filters,
     QList<QAVFrame> &filteredFrames)
 {
-    QAVFrame frame;
     if (filters.empty()) {
         if (decodedFrame)
             filteredFrames.append(decodedFrame);
@@ -150,9 +149,10 @@ static int readFrames(
     // Read all frames from all filters at once
     for (size_t i = 0; i < filters.size(); ++i) {
         do {
+            QAVFrame frame;
             int ret = filters[i]->read(frame);
             if (ret >= 0 && (!frame.filterName().isEmpty() || i == 0))
-                filteredFrames.append(frame);
+                filteredFrames.append(std::move(frame));
         } while (!filters[i]->isEmpty());
     }
     return 0;
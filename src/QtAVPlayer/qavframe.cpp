@@ -8,6 +8,7 @@
 #include "qavframe.h"
 #include "qavstream.h"
 #include "qavframe_p.h"
+#include "qavpool_p.h"
 #include <QDebug>
 
 extern "C" {
@@ -27,14 +28,23 @@ QAVFrame::QAVFrame(const QAVFrame &other)
     *this = other;
 }
 
+// The private of the moved-from frame is kept, only its data is moved
+QAVFrame::QAVFrame(QAVFrame &&other) noexcept
+    : QAVFrame()
+{
+    *this = std::move(other);
+}
+
 QAVFrame::QAVFrame(QAVFramePrivate &d)
     : QAVStreamFrame(d)
 {
-    d.frame = av_frame_alloc();
+    d.frame = QAVPool::instance().frame();
 }
 
 QAVFrame &QAVFrame::operator=(const QAVFrame &other)
 {
+    if (this == &other)
+        return *this;
     Q_D(QAVFrame);
     QAVStreamFrame::operator=(other);
 
@@ -52,6 +62,29 @@ QAVFrame &QAVFrame::operator=(const QAVFrame &other)
     return *this;
 }
 
+QAVFrame &QAVFrame::operator=(QAVFrame &&other) noexcept
+{
+    if (this == &other)
+        return *this;
+    Q_D(QAVFrame);
+    QAVStreamFrame::operator=(std::move(other));
+
+    // Takes the buffers without new references
+    auto other_priv = static_cast<QAVFramePrivate *>(other.d_ptr.get());
+    int64_t pts = d->frame->pts;
+    av_frame_unref(d->frame);
+    av_frame_move_ref(d->frame, other_priv->frame);
+
+    if (d->frame->pts < 0)
+        d->frame->pts = pts;
+
+    d->frameRate = other_priv->frameRate;
+    d->timeBase = other_priv->timeBase;
+    d->filterName = std::move(other_priv->filterName);
+    other_priv->filterName.clear();
+    return *this;
+}
+
 QAVFrame::operator bool() const
 {
     Q_D(const QAVFrame);
@@ -61,7 +94,8 @@ QAVFrame::operator bool() const
 QAVFrame::~QAVFrame()
 {
     Q_D(QAVFrame);
-    av_frame_free(&d->frame);
+    if (d)
+        QAVPool::instance().release(d->frame);
 }
 
 AVFrame *QAVFrame::frame() const
@@ -22,7 +22,9 @@ public:
     QAVFrame();
     ~QAVFrame();
     QAVFrame(const QAVFrame &other);
+    QAVFrame(QAVFrame &&other) noexcept;
     QAVFrame &operator=(const QAVFrame &other);
+    QAVFrame &operator=(QAVFrame &&other) noexcept;
     operator bool() const;
     AVFrame *frame() const;
 
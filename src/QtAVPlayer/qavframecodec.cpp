@@ -31,6 +31,16 @@ int QAVFrameCodec::write(const QAVPacket &pkt)
     Q_D(QAVCodec);
     if (!d->avctx)
         return AVERROR(EINVAL);
+    // The frames must be read before the decoder is reopened
+    if (d->draining)
+        return AVERROR(EAGAIN);
+    // Rebalanced decoder is reopened at a keyframe, the delayed frames are drained first
+    if (pkt && (pkt.packet()->flags & AV_PKT_FLAG_KEY) && d->rebalancedThreads() > 0
+        && avcodec_send_packet(d->avctx, nullptr) >= 0)
+    {
+        d->draining = true;
+        return AVERROR(EAGAIN);
+    }
     return avcodec_send_packet(d->avctx, pkt ? pkt.packet() : nullptr);
 }
 
@@ -49,7 +59,16 @@ int QAVFrameCodec::read(QAVStreamFrame &frame)
     if (!d->avctx)
         return AVERROR(EINVAL);
     auto f = static_cast<QAVFrame *>(&frame);
-    return avcodec_receive_frame(d->avctx, f->frame());
+    int ret = avcodec_receive_frame(d->avctx, f->frame());
+    if (ret == AVERROR_EOF && d->draining) {
+        d->draining = false;
+        const int threads = d->rebalancedThreads();
+        if (threads <= 0 || !d->reopen(threads))
+            avcodec_flush_buffers(d->avctx);
+        // The packet is sent again
+        return AVERROR(EAGAIN);
+    }
+    return ret;
 }
 
 int QAVFrameCodec::read(QAVPacket &pkt)
@@ -0,0 +1,416 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavframeverifier.h"
+#include "qavdemuxer_p.h"
+#include "qavframe.h"
+#include "qavxxh64_p.h"
+#include <QIODevice>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/qtconcurrentrun.h>
+#include <QQueue>
+#include <QVector>
+#include <stdio.h>
+#include <string.h>
+#include <QDebug>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/md5.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/hwcontext.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+class QAVFrameHasher
+{
+public:
+    QAVFrameHasher(QAVFrameVerifier::Hash hash)
+        : m_hash(hash)
+    {
+        if (m_hash == QAVFrameVerifier::MD5) {
+            m_md5 = av_md5_alloc();
+            av_md5_init(m_md5);
+        }
+    }
+
+    ~QAVFrameHasher()
+    {
+        av_free(m_md5);
+    }
+
+    void update(const uint8_t *data, int len)
+    {
+        m_size += len;
+        if (m_md5)
+            av_md5_update(m_md5, data, len);
+        else
+            m_xxh.update(data, size_t(len));
+    }
+
+    int size() const { return m_size; }
+
+    QByteArray result()
+    {
+        if (m_md5) {
+            uint8_t md5[16];
+            av_md5_final(m_md5, md5);
+            return QByteArray(reinterpret_cast<const char *>(md5), sizeof(md5)).toHex();
+        }
+        return QByteArray::number(m_xxh.digest(), 16).rightJustified(16, '0');
+    }
+
+private:
+    QAVFrameVerifier::Hash m_hash;
+    AVMD5 *m_md5 = nullptr;
+    QAVXXH64 m_xxh;
+    int m_size = 0;
+};
+
+struct QAVFrameHash
+{
+    QByteArray hash;
+    int size = 0;
+};
+
+// Hashes planes row by row without padding, as rawvideo or pcm audio would be stored
+QAVFrameHash hash_frame(const QAVFrame &f, QAVFrameVerifier::Hash hash)
+{
+    QAVFrameHasher hasher(hash);
+    const AVFrame *frame = f.frame();
+    AVFrame *sw = nullptr;
+    if (frame->hw_frames_ctx) {
+        sw = av_frame_alloc();
+        if (av_hwframe_transfer_data(sw, frame, 0) < 0) {
+            qWarning() << "Could not av_hwframe_transfer_data";
+            av_frame_free(&sw);
+            return {};
+        }
+        frame = sw;
+    }
+
+    const auto type = f.stream().stream()->codecpar->codec_type;
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        const auto format = AVPixelFormat(frame->format);
+        const auto desc = av_pix_fmt_desc_get(format);
+        const int planes = av_pix_fmt_count_planes(format);
+        for (int i = 0; desc && i < planes; ++i) {
+            const int bytes = av_image_get_linesize(format, frame->width, i);
+            const bool chroma = (i == 1 || i == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+            const int height = chroma ? AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) : frame->height;
+            for (int y = 0; y < height; ++y)
+                hasher.update(frame->data[i] + y * frame->linesize[i], bytes);
+        }
+        if (desc && (desc->flags & AV_PIX_FMT_FLAG_PAL))
+            hasher.update(frame->data[1], 256 * 4);
+    } else {
+        const auto format = AVSampleFormat(frame->format);
+#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
+        const int channels = frame->channels;
+#else
+        const int channels = frame->ch_layout.nb_channels;
+#endif
+        const int size = av_get_bytes_per_sample(format);
+        const int bytes = size * frame->nb_samples * channels;
+        if (av_sample_fmt_is_planar(format) && channels > 1) {
+            // Interleaved as pcm_* codecs store the samples
+            QByteArray packed(bytes, Qt::Uninitialized);
+            auto out = reinterpret_cast<uint8_t *>(packed.data());
+            for (int i = 0; i < frame->nb_samples; ++i) {
+                for (int c = 0; c < channels; ++c, out += size)
+                    memcpy(out, frame->extended_data[c] + i * size, size);
+            }
+            hasher.update(reinterpret_cast<const uint8_t *>(packed.constData()), bytes);
+        } else if (bytes > 0) {
+            hasher.update(frame->extended_data[0], bytes);
+        }
+    }
+
+    av_frame_free(&sw);
+    return { hasher.result(), hasher.size() };
+}
+
+struct QAVFrameVerifierItem
+{
+    int index = 0;
+    QAVFrame frame;
+    QFuture<QAVFrameHash> future;
+};
+
+// Decodes the first video and audio streams
+class QAVFrameVerifierSource
+{
+public:
+    int load(const QString &url)
+    {
+        int ret = demuxer.load(url);
+        if (ret < 0)
+            return ret;
+        streams = demuxer.currentVideoStreams().mid(0, 1) + demuxer.currentAudioStreams().mid(0, 1);
+        if (streams.isEmpty())
+            return AVERROR_STREAM_NOT_FOUND;
+        auto ctx = demuxer.avctx();
+        for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+            if (indexOf(int(i)) < 0)
+                ctx->streams[i]->discard = AVDISCARD_ALL;
+        }
+        return 0;
+    }
+
+    int indexOf(int streamIndex) const
+    {
+        for (int i = 0; i < streams.size(); ++i) {
+            if (streams[i].index() == streamIndex)
+                return i;
+        }
+        return -1;
+    }
+
+    // Decodes next packet, false when all frames are returned
+    bool step(QList<QPair<int, QAVFrame>> &out)
+    {
+        if (eof)
+            return false;
+
+        auto pkt = demuxer.read();
+        if (!pkt) {
+            // Flushing the decoders
+            for (int i = 0; i < streams.size(); ++i) {
+                QAVPacket flush;
+                flush.setStream(streams[i]);
+                QList<QAVFrame> frames;
+                demuxer.decode(flush, frames);
+                for (const auto &frame : frames)
+                    out.push_back({ i, frame });
+            }
+            eof = true;
+            return true;
+        }
+
+        const int index = indexOf(pkt.packet()->stream_index);
+        if (index >= 0) {
+            QList<QAVFrame> frames;
+            demuxer.decode(pkt, frames);
+            for (const auto &frame : frames)
+                out.push_back({ index, frame });
+        }
+        return true;
+    }
+
+    QAVDemuxer demuxer;
+    QList<QAVStream> streams;
+    bool eof = false;
+};
+
+} // namespace
+
+class QAVFrameVerifierPrivate
+{
+public:
+    QAVFrameVerifier::Hash hash = QAVFrameVerifier::MD5;
+    QThreadPool threadPool;
+
+    void enqueue(const QList<QPair<int, QAVFrame>> &frames, QQueue<QAVFrameVerifierItem> &queue)
+    {
+        const auto h = hash;
+        for (const auto &f : frames) {
+            const QAVFrame frame = f.second;
+            queue.enqueue({ f.first, frame, QtConcurrent::run(&threadPool, [frame, h] { return hash_frame(frame, h); }) });
+        }
+    }
+};
+
+QAVFrameVerifier::QAVFrameVerifier()
+    : d_ptr(new QAVFrameVerifierPrivate)
+{
+}
+
+QAVFrameVerifier::~QAVFrameVerifier()
+{
+    d_func()->threadPool.waitForDone();
+}
+
+QAVFrameVerifier::Hash QAVFrameVerifier::hash() const
+{
+    return d_func()->hash;
+}
+
+void QAVFrameVerifier::setHash(Hash hash)
+{
+    d_func()->hash = hash;
+}
+
+int QAVFrameVerifier::threadCount() const
+{
+    return d_func()->threadPool.maxThreadCount();
+}
+
+void QAVFrameVerifier::setThreadCount(int count)
+{
+    d_func()->threadPool.setMaxThreadCount(qMax(1, count));
+}
+
+static int64_t frame_duration(const AVFrame *frame)
+{
+#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 30, 0)
+    return frame->pkt_duration;
+#else
+    return frame->duration;
+#endif
+}
+
+int QAVFrameVerifier::write(const QString &url, QIODevice *out)
+{
+    Q_D(QAVFrameVerifier);
+    QAVFrameVerifierSource source;
+    int ret = source.load(url);
+    if (ret < 0)
+        return ret;
+
+    QByteArray header = "#format: frame checksums\n#version: 2\n#hash: ";
+    header += d->hash == MD5 ? "MD5\n" : "XXH64\n";
+    for (int i = 0; i < source.streams.size(); ++i) {
+        auto s = source.streams[i].stream();
+        auto codecpar = s->codecpar;
+        const QByteArray n = QByteArray::number(i);
+        header += "#tb " + n + ": " + QByteArray::number(s->time_base.num) + '/' + QByteArray::number(s->time_base.den) + '\n';
+        header += "#media_type " + n + ": " + av_get_media_type_string(codecpar->codec_type) + '\n';
+        if (codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            header += "#codec_id " + n + ": rawvideo\n";
+            header += "#dimensions " + n + ": " + QByteArray::number(codecpar->width) + 'x' + QByteArray::number(codecpar->height) + '\n';
+            const AVRational sar = codecpar->sample_aspect_ratio.num ? codecpar->sample_aspect_ratio : AVRational{ 1, 1 };
+            header += "#sar " + n + ": " + QByteArray::number(sar.num) + '/' + QByteArray::number(sar.den) + '\n';
+        } else {
+            // Decoded samples are hashed as interleaved pcm of the same format
+            const auto format = av_get_packed_sample_fmt(AVSampleFormat(codecpar->format));
+            const auto codecId = av_get_pcm_codec(format, Q_BYTE_ORDER == Q_BIG_ENDIAN);
+            char layout[64] = {0};
+#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
+            av_get_channel_layout_string(layout, sizeof(layout), codecpar->channels, codecpar->channel_layout);
+#else
+            av_channel_layout_describe(&codecpar->ch_layout, layout, sizeof(layout));
+#endif
+            header += "#codec_id " + n + ": " + avcodec_get_name(codecId) + '\n';
+            header += "#sample_rate " + n + ": " + QByteArray::number(codecpar->sample_rate) + '\n';
+            header += "#channel_layout_name " + n + ": " + layout + '\n';
+        }
+    }
+    header += "#stream#, dts,        pts, duration,     size, hash\n";
+    out->write(header);
+
+    // Frames are written in decoding order, while hashed in parallel
+    const int maxPending = d->threadPool.maxThreadCount() * 4;
+    QQueue<QAVFrameVerifierItem> queue;
+    auto writeFront = [&] {
+        auto item = queue.dequeue();
+        const auto result = item.future.result();
+        const AVFrame *frame = item.frame.frame();
+        const int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+        char line[256];
+        snprintf(line, sizeof(line), "%d, %10lld, %10lld, %8lld, %8d, ",
+                 item.index, (long long)pts, (long long)pts, (long long)frame_duration(frame), result.size);
+        out->write(line);
+        out->write(result.hash);
+        out->write("\n");
+    };
+
+    QList<QPair<int, QAVFrame>> frames;
+    while (source.step(frames)) {
+        d->enqueue(frames, queue);
+        frames.clear();
+        while (queue.size() > maxPending)
+            writeFront();
+    }
+    while (!queue.isEmpty())
+        writeFront();
+
+    return 0;
+}
+
+int QAVFrameVerifier::compare(const QString &first, const QString &second, Mismatch *mismatch)
+{
+    Q_D(QAVFrameVerifier);
+    QAVFrameVerifierSource sources[2];
+    int ret = sources[0].load(first);
+    if (ret < 0)
+        return ret;
+    ret = sources[1].load(second);
+    if (ret < 0)
+        return ret;
+    if (sources[0].streams.size() != sources[1].streams.size()) {
+        if (mismatch)
+            *mismatch = {};
+        return 1;
+    }
+
+    // Frames of each stream by source, the sources are decoded in turns
+    const int streams = sources[0].streams.size();
+    QVector<QQueue<QAVFrameVerifierItem>> queues[2] = { QVector<QQueue<QAVFrameVerifierItem>>(streams), QVector<QQueue<QAVFrameVerifierItem>>(streams) };
+    QVector<qint64> compared(streams);
+    const int maxPending = d->threadPool.maxThreadCount() * 4;
+    auto pending = [&](int s) {
+        int ret = 0;
+        for (const auto &q : queues[s])
+            ret += q.size();
+        return ret;
+    };
+
+    bool more[2] = { true, true };
+    while (true) {
+        const int pendingFrames[2] = { pending(0), pending(1) };
+        for (int s = 0; s < 2; ++s) {
+            // The source ahead waits for another one,
+            // both are read if the streams are interleaved differently
+            if (!more[s] || (more[!s] && pendingFrames[s] > maxPending && pendingFrames[!s] <= maxPending))
+                continue;
+            QList<QPair<int, QAVFrame>> frames;
+            QQueue<QAVFrameVerifierItem> items;
+            more[s] = sources[s].step(frames);
+            d->enqueue(frames, items);
+            for (const auto &item : items)
+                queues[s][item.index].enqueue(item);
+        }
+
+        for (int i = 0; i < streams; ++i) {
+            auto &a = queues[0][i];
+            auto &b = queues[1][i];
+            while (!a.isEmpty() && !b.isEmpty()) {
+                auto x = a.dequeue();
+                auto y = b.dequeue();
+                const auto hx = x.future.result();
+                const auto hy = y.future.result();
+                if (hx.hash != hy.hash || hx.size != hy.size) {
+                    if (mismatch)
+                        *mismatch = { i, compared[i], x.frame.pts(), hx.hash, hy.hash };
+                    return 1;
+                }
+                ++compared[i];
+            }
+        }
+
+        if (!more[0] && !more[1])
+            break;
+    }
+
+    // Frames left in one of the sources
+    for (int i = 0; i < streams; ++i) {
+        if (!queues[0][i].isEmpty() || !queues[1][i].isEmpty()) {
+            if (mismatch)
+                *mismatch = { -1, compared[i], 0, {}, {} };
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+QT_END_NAMESPACE
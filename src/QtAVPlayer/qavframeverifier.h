@@ -0,0 +1,69 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVFRAMEVERIFIER_H
+#define QAVFRAMEVERIFIER_H
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QString>
+#include <QByteArray>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+class QIODevice;
+class QAVFrameVerifierPrivate;
+/**
+ * Decodes the first video and audio streams as fast as possible
+ * and hashes the data of each frame on worker threads.
+ * Video frames are hashed as rawvideo and audio frames as interleaved pcm of the decoded
+ * sample format, so MD5 matches framemd5 output of FFmpeg with the same codecs,
+ * e.g. -c:a pcm_f32le for float audio, since pcm_s16le is used by default.
+ */
+class QAVFrameVerifier
+{
+public:
+    enum Hash
+    {
+        MD5,
+        XXH64
+    };
+
+    QAVFrameVerifier();
+    ~QAVFrameVerifier();
+
+    Hash hash() const;
+    void setHash(Hash hash);
+
+    int threadCount() const;
+    void setThreadCount(int count);
+
+    // Writes framemd5 compatible report
+    int write(const QString &url, QIODevice *out);
+
+    struct Mismatch
+    {
+        // Index of the stream in the report, -1 if frames count differ
+        int stream = -1;
+        qint64 frame = -1;
+        double pts = 0;
+        QByteArray first;
+        QByteArray second;
+    };
+
+    // Decodes both sources in lockstep, returns 1 and stops on the first mismatch, 0 if equal
+    int compare(const QString &first, const QString &second, Mismatch *mismatch = nullptr);
+
+private:
+    Q_DISABLE_COPY(QAVFrameVerifier)
+    Q_DECLARE_PRIVATE(QAVFrameVerifier)
+    std::unique_ptr<QAVFrameVerifierPrivate> d_ptr;
+};
+
+QT_END_NAMESPACE
+
+#endif
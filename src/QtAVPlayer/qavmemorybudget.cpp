@@ -0,0 +1,135 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavmemorybudget_p.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+QAVMemoryBudget::QAVMemoryBudget(QAVMemoryBudget *parent)
+    : m_parent(parent)
+{
+    for (auto &usage : m_usage)
+        usage = 0;
+}
+
+QAVMemoryBudget::~QAVMemoryBudget()
+{
+    // Memory still held by queues must not be accounted in the parent
+    if (m_parent) {
+        for (int i = 0; i < ComponentCount; ++i)
+            m_parent->release(Component(i), m_usage[i]);
+    }
+}
+
+QAVMemoryBudget &QAVMemoryBudget::process()
+{
+    // Never destroyed, frames could be released after static destructors
+    static QAVMemoryBudget *budget = [] {
+        auto b = new QAVMemoryBudget;
+        b->setLimit(qMax<qint64>(0, qgetenv("QT_AVPLAYER_MEMORY_BUDGET").toLongLong()));
+        return b;
+    }();
+    return *budget;
+}
+
+qint64 QAVMemoryBudget::limit() const
+{
+    return m_limit;
+}
+
+void QAVMemoryBudget::setLimit(qint64 bytes)
+{
+    m_limit = qMax<qint64>(0, bytes);
+    m_released.wakeAll();
+}
+
+QAVMemoryBudget::Policy QAVMemoryBudget::policy() const
+{
+    return Policy(m_policy.load());
+}
+
+void QAVMemoryBudget::setPolicy(Policy policy)
+{
+    m_policy = policy;
+    m_released.wakeAll();
+}
+
+void QAVMemoryBudget::add(Component c, qint64 bytes)
+{
+    if (bytes <= 0)
+        return;
+    m_usage[c] += bytes;
+    m_total += bytes;
+    if (m_parent)
+        m_parent->add(c, bytes);
+}
+
+void QAVMemoryBudget::release(Component c, qint64 bytes)
+{
+    if (bytes <= 0)
+        return;
+    m_usage[c] -= bytes;
+    m_total -= bytes;
+    if (m_parent)
+        m_parent->release(c, bytes);
+    m_released.wakeAll();
+}
+
+qint64 QAVMemoryBudget::usage(Component c) const
+{
+    return m_usage[c];
+}
+
+qint64 QAVMemoryBudget::total() const
+{
+    return m_total;
+}
+
+bool QAVMemoryBudget::exceeded() const
+{
+    const qint64 max = m_limit;
+    if (max > 0 && m_total >= max)
+        return true;
+    return m_parent && m_parent->exceeded();
+}
+
+void QAVMemoryBudget::wait(int msecs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (exceeded())
+        m_released.wait(&m_mutex, msecs);
+}
+
+qint64 QAVMemoryBudget::bytes(const QAVPacket &packet)
+{
+    return (packet ? packet.packet()->size : 0) + sizeof(packet);
+}
+
+qint64 QAVMemoryBudget::bytes(const QAVFrame &frame)
+{
+    if (!frame)
+        return 0;
+    const auto f = frame.frame();
+    qint64 ret = 0;
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && f->buf[i]; ++i)
+        ret += f->buf[i]->size;
+    for (int i = 0; i < f->nb_extended_buf; ++i)
+        ret += f->extended_buf[i]->size;
+    return ret;
+}
+
+qint64 QAVMemoryBudget::bytes(const QAVSubtitleFrame &frame)
+{
+    return sizeof(frame);
+}
+
+QT_END_NAMESPACE
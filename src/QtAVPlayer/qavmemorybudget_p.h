@@ -0,0 +1,98 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVMEMORYBUDGET_P_H
+#define QAVMEMORYBUDGET_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qavpacket_p.h"
+#include "qavframe.h"
+#include "qavsubtitleframe.h"
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+
+QT_BEGIN_NAMESPACE
+
+// Accounts bytes held by the queues of the pipeline.
+// Each player owns a budget, the process-wide one is the parent of all of them.
+class QAVMemoryBudget
+{
+public:
+    enum Component
+    {
+        Packets,
+        DecodedFrames,
+        FilteredFrames,
+        MuxerFrames,
+        AudioBuffers,
+        ComponentCount
+    };
+
+    // What is throttled when the limit is reached
+    enum Policy
+    {
+        // Reading of packets is paused, other queues are drained by their consumers
+        PauseDemuxer,
+        // Producers of the muxer and audio queues additionally wait until the queues are drained
+        BlockProducers,
+        // The oldest frames of the muxer and audio queues are dropped
+        DropFrames
+    };
+
+    explicit QAVMemoryBudget(QAVMemoryBudget *parent = nullptr);
+    ~QAVMemoryBudget();
+
+    static QAVMemoryBudget &process();
+
+    // Max bytes of all components, 0 means unlimited
+    qint64 limit() const;
+    void setLimit(qint64 bytes);
+
+    Policy policy() const;
+    void setPolicy(Policy policy);
+
+    void add(Component c, qint64 bytes);
+    void release(Component c, qint64 bytes);
+
+    qint64 usage(Component c) const;
+    qint64 total() const;
+
+    // Checks if this or the parent budget is over the limit
+    bool exceeded() const;
+    // Waits for released memory up to msecs
+    void wait(int msecs);
+
+    static qint64 bytes(const QAVPacket &packet);
+    static qint64 bytes(const QAVFrame &frame);
+    static qint64 bytes(const QAVSubtitleFrame &frame);
+
+private:
+    Q_DISABLE_COPY(QAVMemoryBudget)
+
+    QAVMemoryBudget *m_parent = nullptr;
+    std::atomic<qint64> m_limit {0};
+    std::atomic<int> m_policy {PauseDemuxer};
+    std::atomic<qint64> m_usage[ComponentCount];
+    std::atomic<qint64> m_total {0};
+    QMutex m_mutex;
+    QWaitCondition m_released;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,112 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavmutex_p.h"
+#ifdef QT_AVPLAYER_PROFILE_LOCKS
+#include <QElapsedTimer>
+#include <QMap>
+#include <QDebug>
+#include <atomic>
+#include <algorithm>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+#ifdef QT_AVPLAYER_PROFILE_LOCKS
+
+struct QAVMutexStats
+{
+    QByteArray name;
+    std::atomic<qint64> locks {0};
+    std::atomic<qint64> contended {0};
+    std::atomic<qint64> waitNs {0};
+    std::atomic<qint64> maxWaitNs {0};
+};
+
+static QMutex &registryMutex()
+{
+    // Never destroyed, mutexes could be locked after static destructors
+    static QMutex *mutex = new QMutex;
+    return *mutex;
+}
+
+static QMap<QByteArray, QAVMutexStats *> &registry()
+{
+    static auto stats = new QMap<QByteArray, QAVMutexStats *>;
+    return *stats;
+}
+
+QAVMutex::QAVMutex(const char *name)
+{
+    QMutexLocker locker(&registryMutex());
+    auto &stats = registry()[name];
+    if (!stats) {
+        stats = new QAVMutexStats;
+        stats->name = name;
+    }
+    m_stats = stats;
+}
+
+void QAVMutex::lock()
+{
+    ++m_stats->locks;
+    if (m_mutex.tryLock())
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    m_mutex.lock();
+    const qint64 ns = timer.nsecsElapsed();
+    ++m_stats->contended;
+    m_stats->waitNs += ns;
+    qint64 max = m_stats->maxWaitNs;
+    while (ns > max && !m_stats->maxWaitNs.compare_exchange_weak(max, ns)) { }
+}
+
+QString QAVMutex::report()
+{
+    QList<QAVMutexStats *> stats;
+    {
+        QMutexLocker locker(&registryMutex());
+        stats = registry().values();
+    }
+    std::sort(stats.begin(), stats.end(), [](const QAVMutexStats *a, const QAVMutexStats *b) {
+        return a->waitNs > b->waitNs;
+    });
+
+    QString ret;
+    for (const auto s : stats) {
+        ret += QString(QLatin1String("%1: locks %2, contended %3, wait %4 us, max %5 us\n"))
+            .arg(QLatin1String(s->name))
+            .arg(s->locks.load())
+            .arg(s->contended.load())
+            .arg(s->waitNs / 1000)
+            .arg(s->maxWaitNs / 1000);
+    }
+    return ret;
+}
+
+static void printReport()
+{
+    qInfo().noquote() << "Mutex wait times:\n" << QAVMutex::report();
+}
+Q_DESTRUCTOR_FUNCTION(printReport)
+
+#else
+
+QAVMutex::QAVMutex(const char *)
+{
+}
+
+QString QAVMutex::report()
+{
+    return {};
+}
+
+#endif
+
+QT_END_NAMESPACE
@@ -0,0 +1,97 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVMUTEX_P_H
+#define QAVMUTEX_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QMutex>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+
+struct QAVMutexStats;
+// Mutex of the playback pipeline.
+// If built with QT_AVPLAYER_PROFILE_LOCKS, time spent waiting for the lock
+// is accounted by the name and reported on exit.
+class QAVMutex
+{
+public:
+    explicit QAVMutex(const char *name = "unnamed");
+
+#ifdef QT_AVPLAYER_PROFILE_LOCKS
+    void lock();
+#else
+    void lock() { m_mutex.lock(); }
+#endif
+    bool tryLock() { return m_mutex.tryLock(); }
+    void unlock() { m_mutex.unlock(); }
+
+    // Used by QWaitCondition
+    QMutex *native() { return &m_mutex; }
+
+    // Wait times of all mutexes by name, empty if not profiled
+    static QString report();
+
+private:
+    Q_DISABLE_COPY(QAVMutex)
+    QMutex m_mutex;
+#ifdef QT_AVPLAYER_PROFILE_LOCKS
+    QAVMutexStats *m_stats = nullptr;
+#endif
+};
+
+class QAVMutexLocker
+{
+public:
+    explicit QAVMutexLocker(QAVMutex *mutex)
+        : m_mutex(mutex)
+    {
+        relock();
+    }
+
+    ~QAVMutexLocker()
+    {
+        unlock();
+    }
+
+    void unlock()
+    {
+        if (m_locked) {
+            m_mutex->unlock();
+            m_locked = false;
+        }
+    }
+
+    void relock()
+    {
+        if (m_mutex && !m_locked) {
+            m_mutex->lock();
+            m_locked = true;
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(QAVMutexLocker)
+    QAVMutex *m_mutex = nullptr;
+    bool m_locked = false;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -10,6 +10,9 @@
 #include "qavaudiocodec_p.h"
 #include "qavsubtitlecodec_p.h"
 #include "qavvideoframe.h"
+#include "qavvideoconverter.h"
+#include "qavmemorybudget_p.h"
+#include "qavallocations_p.h"
 
 #include <QObject>
 #include <QMutexLocker>
@@ -51,8 +54,17 @@ public:
     QList<QAVFrame> frames;
     mutable QMutex mutex;
     QWaitCondition cond;
+    QWaitCondition drained;
     bool quit = false;
 
+    QAVMemoryBudget *budget = nullptr;
+    // Frames in different format than the encoder
+    QAVVideoConverter converter;
+    // Bytes of the queued frames
+    qint64 bytes = 0;
+
+    QAVFrame takeFrame();
+    void clearFrames();
     void doWork();
 };
 
@@ -73,6 +85,7 @@ void QAVMuxer::reset()
     if (d->ctx && !(d->ctx->oformat->flags & AVFMT_NOFILE))
         avio_closep(&d->ctx->pb);
     d->streams.clear();
+    d->clearFrames();
     avformat_free_context(d->ctx);
     d->ctx = nullptr;
 }
@@ -258,11 +271,41 @@ void QAVMuxer::enqueue(const QAVFrame &frame)
         QMutexLocker locker(&d->mutex);
         if (!d->loaded)
             return;
+        if (d->budget) {
+            switch (d->budget->policy()) {
+            case QAVMemoryBudget::BlockProducers:
+                // Only waits for own frames, the muxer thread always drains them
+                while (!d->quit && !d->frames.isEmpty() && d->budget->exceeded())
+                    d->drained.wait(&d->mutex, 10);
+                break;
+            case QAVMemoryBudget::DropFrames:
+                while (!d->frames.isEmpty() && d->budget->exceeded())
+                    d->takeFrame();
+                break;
+            default:
+                break;
+            }
+        }
+        const qint64 bytes = QAVMemoryBudget::bytes(frame);
+        d->bytes += bytes;
+        if (d->budget)
+            d->budget->add(QAVMemoryBudget::MuxerFrames, bytes);
         d->frames.push_back(frame);
     }
     d->cond.wakeAll();
 }
 
+void QAVMuxer::setMemoryBudget(QAVMemoryBudget *budget)
+{
+    Q_D(QAVMuxer);
+    QMutexLocker locker(&d->mutex);
+    if (d->budget)
+        d->budget->release(QAVMemoryBudget::MuxerFrames, d->bytes);
+    d->budget = budget;
+    if (d->budget)
+        d->budget->add(QAVMemoryBudget::MuxerFrames, d->bytes);
+}
+
 size_t QAVMuxer::size() const
 {
     Q_D(const QAVMuxer);
@@ -270,6 +313,24 @@ size_t QAVMuxer::size() const
     return d->frames.size();
 }
 
+QAVFrame QAVMuxerPrivate::takeFrame()
+{
+    auto frame = frames.takeFirst();
+    const qint64 size = QAVMemoryBudget::bytes(frame);
+    bytes -= size;
+    if (budget)
+        budget->release(QAVMemoryBudget::MuxerFrames, size);
+    return frame;
+}
+
+void QAVMuxerPrivate::clearFrames()
+{
+    frames.clear();
+    if (budget)
+        budget->release(QAVMemoryBudget::MuxerFrames, bytes);
+    bytes = 0;
+}
+
 void QAVMuxerPrivate::doWork()
 {
     QMutexLocker locker(&mutex);
@@ -279,7 +340,8 @@ void QAVMuxerPrivate::doWork()
             if (quit || frames.isEmpty())
                 break;
         }
-        auto frame = frames.takeFirst();
+        auto frame = takeFrame();
+        drained.wakeAll();
         q_ptr->write(frame, frame.stream().index());
     }
 }
@@ -312,11 +374,8 @@ int QAVMuxer::write(QAVFrame frame, int streamIndex)
 
     if (enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
         // If the frame is in different format than the encoder
-        // TODO: avoid converting
-        if (frame && frame.frame()->format != enc_ctx->pix_fmt) {
-            QAVVideoFrame videoFrame = frame;
-            frame = videoFrame.convertTo(enc_ctx->pix_fmt);
-        }
+        if (frame && frame.frame()->format != enc_ctx->pix_fmt)
+            frame = d->converter.convert(frame, enc_ctx->pix_fmt);
         frame.frame()->pict_type = AV_PICTURE_TYPE_NONE;
     }
 
@@ -336,6 +395,7 @@ int QAVMuxer::write(QAVFrame frame, int streamIndex)
             int received = pkt.receive();
             if (received < 0)
                 break;
+            QAVAllocations::instance().track(QAVAllocations::Muxer, streamIndex, pkt.packet());
             auto enc_pkt = pkt.packet();
             enc_pkt->stream_index = streamIndex;
             av_packet_rescale_ts(enc_pkt, enc_ctx->time_base, stream->time_base);
@@ -367,6 +427,7 @@ int QAVMuxer::write(QAVSubtitleFrame frame, int streamIndex)
     int received = pkt.receive();
     if (received < 0)
         return received;
+    QAVAllocations::instance().track(QAVAllocations::Muxer, streamIndex, pkt.packet());
     auto enc_pkt = pkt.packet();
     enc_pkt->stream_index = streamIndex;
     av_packet_rescale_ts(enc_pkt, enc_ctx->time_base, stream->time_base);
@@ -29,6 +29,7 @@ struct AVFormatContext;
 QT_BEGIN_NAMESPACE
 
 class QAVMuxerPrivate;
+class QAVMemoryBudget;
 /**
  * Allows to mux and write the input streams to output file.
  */
@@ -47,6 +48,8 @@ public:
     void enqueue(const QAVFrame &frame);
     // Returns size of frames in the queue
     size_t size() const;
+    // Accounts the queued frames, the producer is throttled according to the policy
+    void setMemoryBudget(QAVMemoryBudget *budget);
 
     // Directly writes the frame to the encoder
     int write(const QAVFrame &frame);
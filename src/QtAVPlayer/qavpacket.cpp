@@ -8,6 +8,7 @@
 #include "qavpacket_p.h"
 #include "qavcodec_p.h"
 #include "qavstream.h"
+#include "qavpool_p.h"
 #include <QSharedPointer>
 #include <QDebug>
 
@@ -22,17 +23,26 @@ QT_BEGIN_NAMESPACE
 class QAVPacketPrivate
 {
 public:
+    static void *operator new(size_t size) { return QAVPool::instance().allocate(size); }
+    static void operator delete(void *p, size_t size) { QAVPool::instance().deallocate(p, size); }
+
     AVPacket *pkt = nullptr;
     QAVStream stream;
 };
 
+static QAVPacketPrivate *create_packet()
+{
+    auto d = new QAVPacketPrivate;
+    d->pkt = QAVPool::instance().packet();
+    d->pkt->size = 0;
+    d->pkt->stream_index = -1;
+    d->pkt->pts = AV_NOPTS_VALUE;
+    return d;
+}
+
 QAVPacket::QAVPacket()
-    : d_ptr(new QAVPacketPrivate)
+    : d_ptr(create_packet())
 {
-    d_ptr->pkt = av_packet_alloc();
-    d_ptr->pkt->size = 0;
-    d_ptr->pkt->stream_index = -1;
-    d_ptr->pkt->pts = AV_NOPTS_VALUE;
 }
 
 QAVPacket::QAVPacket(const QAVPacket &other)
@@ -41,8 +51,16 @@ QAVPacket::QAVPacket(const QAVPacket &other)
     *this = other;
 }
 
+QAVPacket::QAVPacket(QAVPacket &&other) noexcept
+    : QAVPacket()
+{
+    d_ptr.swap(other.d_ptr);
+}
+
 QAVPacket &QAVPacket::operator=(const QAVPacket &other)
 {
+    if (this == &other)
+        return *this;
     av_packet_unref(d_ptr->pkt);
     av_packet_ref(d_ptr->pkt, other.d_ptr->pkt);
 
@@ -51,16 +69,23 @@ QAVPacket &QAVPacket::operator=(const QAVPacket &other)
     return *this;
 }
 
+QAVPacket &QAVPacket::operator=(QAVPacket &&other) noexcept
+{
+    d_ptr.swap(other.d_ptr);
+    return *this;
+}
+
 QAVPacket::operator bool() const
 {
     Q_D(const QAVPacket);
-    return d->pkt->size;
+    return d && d->pkt->size;
 }
 
 QAVPacket::~QAVPacket()
 {
     Q_D(QAVPacket);
-    av_packet_free(&d->pkt);
+    if (d)
+        QAVPool::instance().release(d->pkt);
 }
 
 AVPacket *QAVPacket::packet() const
@@ -33,7 +33,10 @@ public:
     QAVPacket();
     ~QAVPacket();
     QAVPacket(const QAVPacket &other);
+    // The moved-from packet is valid but unspecified
+    QAVPacket(QAVPacket &&other) noexcept;
     QAVPacket &operator=(const QAVPacket &other);
+    QAVPacket &operator=(QAVPacket &&other) noexcept;
     operator bool() const;
 
     AVPacket *packet() const;
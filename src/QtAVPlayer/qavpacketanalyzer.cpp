@@ -0,0 +1,290 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavpacketanalyzer.h"
+#include "qavdemuxer_p.h"
+#include <QVector>
+#include <atomic>
+#include <limits>
+#include <math.h>
+#include <QDebug>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+struct QAVPacketAnalyzerStats
+{
+    QAVPacketAnalyzer::StreamStats stats;
+    bool started = false;
+    qint64 gopSum = 0;
+    qint64 gopCount = 0;
+
+    void add(int size, double ts, double duration, bool key)
+    {
+        ++stats.packets;
+        stats.bytes += size;
+        stats.minSize = stats.packets > 1 ? qMin<qint64>(stats.minSize, size) : size;
+        stats.maxSize = qMax<qint64>(stats.maxSize, size);
+        if (key)
+            ++stats.keyframes;
+        if (isnan(ts)) {
+            ++stats.missingTimestamps;
+            return;
+        }
+        if (!started) {
+            stats.start = ts;
+            stats.end = ts;
+            started = true;
+        }
+        stats.start = qMin(stats.start, ts);
+        stats.end = qMax(stats.end, ts + duration);
+    }
+
+    void addGop(qint64 packets, double interval)
+    {
+        stats.minGop = gopCount ? qMin(stats.minGop, packets) : packets;
+        stats.maxGop = qMax(stats.maxGop, packets);
+        gopSum += packets;
+        ++gopCount;
+        if (!isnan(interval))
+            stats.maxKeyframeInterval = qMax(stats.maxKeyframeInterval, interval);
+    }
+
+    void addGap(double gap)
+    {
+        ++stats.gaps;
+        stats.maxGap = qMax(stats.maxGap, gap);
+    }
+
+    QAVPacketAnalyzer::StreamStats result(double duration) const
+    {
+        auto ret = stats;
+        if (duration > 0)
+            ret.bitrate = ret.bytes * 8 / duration;
+        if (gopCount)
+            ret.avgGop = double(gopSum) / gopCount;
+        return ret;
+    }
+};
+
+struct QAVPacketAnalyzerStream
+{
+    AVMediaType type = AVMEDIA_TYPE_UNKNOWN;
+    double lastTs = NAN;
+    double lastDuration = 0;
+    double lastKeyTs = NAN;
+    qint64 sinceKey = -1;
+    QAVPacketAnalyzerStats window;
+    QAVPacketAnalyzerStats total;
+};
+
+} // namespace
+
+class QAVPacketAnalyzerPrivate
+{
+public:
+    QString source;
+    double window = 1.0;
+    double gapThreshold = 0.1;
+    QAVDemuxer demuxer;
+    std::atomic_bool abortRequest = false;
+};
+
+QAVPacketAnalyzer::QAVPacketAnalyzer(QObject *parent)
+    : QObject(parent)
+    , d_ptr(new QAVPacketAnalyzerPrivate)
+{
+    qRegisterMetaType<Report>();
+    d_ptr->demuxer.setCodecsEnabled(false);
+}
+
+QAVPacketAnalyzer::~QAVPacketAnalyzer()
+{
+}
+
+QString QAVPacketAnalyzer::source() const
+{
+    return d_func()->source;
+}
+
+void QAVPacketAnalyzer::setSource(const QString &url)
+{
+    d_func()->source = url;
+}
+
+double QAVPacketAnalyzer::window() const
+{
+    return d_func()->window;
+}
+
+void QAVPacketAnalyzer::setWindow(double sec)
+{
+    d_func()->window = sec;
+}
+
+double QAVPacketAnalyzer::gapThreshold() const
+{
+    return d_func()->gapThreshold;
+}
+
+void QAVPacketAnalyzer::setGapThreshold(double sec)
+{
+    d_func()->gapThreshold = sec;
+}
+
+void QAVPacketAnalyzer::abort()
+{
+    Q_D(QAVPacketAnalyzer);
+    d->abortRequest = true;
+    d->demuxer.abort();
+}
+
+static double interleave_skew(const QVector<QAVPacketAnalyzerStream> &streams)
+{
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+    for (const auto &s : streams) {
+        if ((s.type != AVMEDIA_TYPE_VIDEO && s.type != AVMEDIA_TYPE_AUDIO) || isnan(s.lastTs))
+            continue;
+        min = qMin(min, s.lastTs);
+        max = qMax(max, s.lastTs);
+    }
+    return max > min ? max - min : 0.0;
+}
+
+int QAVPacketAnalyzer::run()
+{
+    Q_D(QAVPacketAnalyzer);
+    d->abortRequest = false;
+    d->demuxer.unload();
+    int ret = d->demuxer.load(d->source);
+    if (ret < 0) {
+        qWarning() << "Could not load:" << d->source << ret;
+        return ret;
+    }
+
+    auto ctx = d->demuxer.avctx();
+    QVector<QAVPacketAnalyzerStream> streams(int(ctx->nb_streams));
+    for (int i = 0; i < streams.size(); ++i) {
+        streams[i].type = ctx->streams[i]->codecpar->codec_type;
+        streams[i].window.stats.index = streams[i].total.stats.index = i;
+        streams[i].window.stats.type = streams[i].total.stats.type = streams[i].type;
+    }
+
+    double windowStart = NAN;
+    double windowSkew = 0;
+    double totalSkew = 0;
+    auto emitWindow = [&] {
+        Report r;
+        r.start = windowStart;
+        r.end = windowStart + d->window;
+        r.maxInterleaveSkew = windowSkew;
+        for (auto &s : streams) {
+            r.streams.push_back(s.window.result(d->window));
+            s.window = {};
+            s.window.stats.index = s.total.stats.index;
+            s.window.stats.type = s.type;
+        }
+        windowSkew = 0;
+        Q_EMIT report(r);
+    };
+
+    int errors = 0;
+    while (!d->abortRequest) {
+        auto pkt = d->demuxer.read();
+        if (!pkt) {
+            // Read errors are skipped until too many in a row
+            if (d->demuxer.eof() || ++errors > 100)
+                break;
+            continue;
+        }
+        errors = 0;
+
+        const AVPacket *p = pkt.packet();
+        if (p->stream_index < 0 || p->stream_index >= streams.size())
+            continue;
+        auto &s = streams[p->stream_index];
+        const AVRational tb = ctx->streams[p->stream_index]->time_base;
+        const int64_t ts = p->dts != AV_NOPTS_VALUE ? p->dts : p->pts;
+        const double t = ts != AV_NOPTS_VALUE ? ts * av_q2d(tb) : NAN;
+        const double duration = p->duration * av_q2d(tb);
+        const bool key = p->flags & AV_PKT_FLAG_KEY;
+
+        // Late packets of interleaved streams are counted in the current window
+        if (!isnan(t) && d->window > 0) {
+            if (isnan(windowStart))
+                windowStart = floor(t / d->window) * d->window;
+            if (t >= windowStart + d->window) {
+                emitWindow();
+                windowStart = floor(t / d->window) * d->window;
+            }
+        }
+
+        s.window.add(p->size, t, duration, key);
+        s.total.add(p->size, t, duration, key);
+        if (!isnan(t) && !isnan(s.lastTs)) {
+            const double gap = t - (s.lastTs + s.lastDuration);
+            if (t < s.lastTs) {
+                ++s.window.stats.discontinuities;
+                ++s.total.stats.discontinuities;
+            } else if (gap > d->gapThreshold) {
+                s.window.addGap(gap);
+                s.total.addGap(gap);
+            }
+        }
+
+        if (s.type == AVMEDIA_TYPE_VIDEO) {
+            if (key) {
+                if (s.sinceKey > 0) {
+                    const double interval = !isnan(t) && !isnan(s.lastKeyTs) ? t - s.lastKeyTs : NAN;
+                    s.window.addGop(s.sinceKey, interval);
+                    s.total.addGop(s.sinceKey, interval);
+                }
+                s.sinceKey = 0;
+                s.lastKeyTs = t;
+            }
+            if (s.sinceKey >= 0)
+                ++s.sinceKey;
+        }
+
+        if (!isnan(t)) {
+            s.lastTs = t;
+            s.lastDuration = duration;
+        }
+        const double skew = interleave_skew(streams);
+        windowSkew = qMax(windowSkew, skew);
+        totalSkew = qMax(totalSkew, skew);
+    }
+
+    if (d->abortRequest)
+        return AVERROR_EXIT;
+
+    if (!isnan(windowStart))
+        emitWindow();
+
+    Report summary;
+    summary.maxInterleaveSkew = totalSkew;
+    bool started = false;
+    for (const auto &s : streams) {
+        const auto &stats = s.total.stats;
+        summary.streams.push_back(s.total.result(stats.end - stats.start));
+        if (!s.total.started)
+            continue;
+        summary.start = started ? qMin(summary.start, stats.start) : stats.start;
+        summary.end = started ? qMax(summary.end, stats.end) : stats.end;
+        started = true;
+    }
+    Q_EMIT finished(summary);
+    return 0;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,97 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVPACKETANALYZER_H
+#define QAVPACKETANALYZER_H
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QObject>
+#include <QList>
+#include <memory>
+
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+class QAVPacketAnalyzerPrivate;
+/**
+ * Collects packet statistics of all streams without decoding.
+ * Timestamps and durations are in seconds.
+ */
+class QAVPacketAnalyzer : public QObject
+{
+    Q_OBJECT
+public:
+    struct StreamStats
+    {
+        int index = -1;
+        AVMediaType type = AVMEDIA_TYPE_UNKNOWN;
+        double start = 0;
+        double end = 0;
+        qint64 packets = 0;
+        qint64 bytes = 0;
+        qint64 minSize = 0;
+        qint64 maxSize = 0;
+        // Bits per second
+        double bitrate = 0;
+        qint64 keyframes = 0;
+        // Packets between keyframes of video streams
+        qint64 minGop = 0;
+        qint64 maxGop = 0;
+        double avgGop = 0;
+        double maxKeyframeInterval = 0;
+        // Forward jumps of timestamps above gapThreshold()
+        qint64 gaps = 0;
+        double maxGap = 0;
+        // Backward jumps of timestamps
+        qint64 discontinuities = 0;
+        qint64 missingTimestamps = 0;
+    };
+
+    struct Report
+    {
+        double start = 0;
+        double end = 0;
+        QList<StreamStats> streams;
+        // Max difference of the last timestamps of audio and video streams
+        double maxInterleaveSkew = 0;
+    };
+
+    QAVPacketAnalyzer(QObject *parent = nullptr);
+    ~QAVPacketAnalyzer();
+
+    QString source() const;
+    void setSource(const QString &url);
+
+    // Duration of the windows of the reports
+    double window() const;
+    void setWindow(double sec);
+
+    double gapThreshold() const;
+    void setGapThreshold(double sec);
+
+    // Reads all packets and emits the reports, blocks until finished or aborted
+    int run();
+    void abort();
+
+Q_SIGNALS:
+    void report(const QAVPacketAnalyzer::Report &report);
+    void finished(const QAVPacketAnalyzer::Report &summary);
+
+private:
+    std::unique_ptr<QAVPacketAnalyzerPrivate> d_ptr;
+    Q_DISABLE_COPY(QAVPacketAnalyzer)
+    Q_DECLARE_PRIVATE(QAVPacketAnalyzer)
+};
+
+Q_DECLARE_METATYPE(QAVPacketAnalyzer::Report)
+
+QT_END_NAMESPACE
+
+#endif
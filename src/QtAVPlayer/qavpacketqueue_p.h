@@ -26,10 +26,14 @@
 #include "qavsubtitleframe.h"
 #include "qavstreamframe.h"
 #include "qavdemuxer_p.h"
+#include "qavmemorybudget_p.h"
+#include "qavbufferpool_p.h"
+#include "qavmutex_p.h"
 #include <QMutex>
 #include <QWaitCondition>
 #include <QList>
 #include <math.h>
+#include <atomic>
 #include <memory>
 
 extern "C" {
@@ -39,6 +43,8 @@ extern "C" {
 
 QT_BEGIN_NAMESPACE
 
+// Played by one thread, but cleared on seek and configured by the demuxer thread.
+// The lock is not contended while playing, pts() is read by others without it
 class QAVQueueClock
 {
 public:
@@ -49,7 +55,7 @@ public:
 
     bool wait(bool shouldSync, double pts, double speed = 1.0, double master = -1)
     {
-        QMutexLocker locker(&m_mutex);
+        QAVMutexLocker locker(&m_mutex);
         double delay = pts - prevPts;
         if (isnan(delay) || delay <= 0 || delay > maxFrameDuration)
             delay = frameRate;
@@ -88,28 +94,27 @@ public:
 
     double pts() const
     {
-        QMutexLocker locker(&m_mutex);
         return prevPts;
     }
 
     void clear()
     {
-        QMutexLocker locker(&m_mutex);
+        QAVMutexLocker locker(&m_mutex);
         prevPts = 0;
         frameTimer = 0;
     }
 
     void setFrameRate(double v)
     {
-        QMutexLocker locker(&m_mutex);
+        QAVMutexLocker locker(&m_mutex);
         frameRate = v;
     }
 
 private:
     double frameRate = 0;
     double frameTimer = 0;
-    double prevPts = 0;
-    mutable QMutex m_mutex;
+    std::atomic<double> prevPts {0};
+    mutable QAVMutex m_mutex {"QAVQueueClock"};
     const double maxFrameDuration = 10.0;
     const double minThreshold = 0.04;
     const double maxThreshold = 0.1;
@@ -121,15 +126,17 @@ template<class T>
 class QAVPacketQueue
 {
 public:
-    QAVPacketQueue(AVMediaType mediaType, QAVDemuxer &demuxer)
+    QAVPacketQueue(AVMediaType mediaType, QAVDemuxer &demuxer, QAVMemoryBudget *budget = nullptr)
         : m_mediaType(mediaType)
         , m_demuxer(demuxer)
+        , m_budget(budget)
     {
     }
 
     ~QAVPacketQueue()
     {
         abort();
+        clear();
     }
 
     AVMediaType mediaType() const
@@ -139,28 +146,29 @@ public:
 
     bool isEmpty() const
     {
-        QMutexLocker locker(&m_mutex);
+        QAVMutexLocker locker(&m_mutex);
         return m_packets.isEmpty() && m_decodedFrames.isEmpty();
     }
 
-    void enqueue(const QAVPacket &packet)
+    void enqueue(QAVPacket &&packet)
     {
-        QMutexLocker locker(&m_mutex);
+        QAVMutexLocker locker(&m_mutex);
         if (m_abort)
             return;
-        m_packets.append(packet);
         m_bytes += packet.packet()->size + sizeof(packet);
         m_duration += packet.duration();
+        measure(packet);
+        account(QAVMemoryBudget::Packets, m_packetBytes, QAVMemoryBudget::bytes(packet));
+        m_packets.append(std::move(packet));
         m_consumerWaiter.wakeAll();
         m_waitingForPackets = false;
     }
 
     bool frontFrame(T &frame)
     {
-        QMutexLocker locker(&m_mutex);
-        if (m_decodedFrames.isEmpty())
-            m_demuxer.decode(dequeue(), m_decodedFrames);
-        if (m_decodedFrames.isEmpty())
+        waitForBuffers();
+        QAVMutexLocker locker(&m_mutex);
+        if (!decodeFrames())
             return false;
         frame = m_decodedFrames.front();
         return true;
@@ -168,78 +176,167 @@ public:
 
     void popFrame()
     {
-        QMutexLocker locker(&m_mutex);
-        if (!m_decodedFrames.isEmpty())
+        QAVMutexLocker locker(&m_mutex);
+        if (!m_decodedFrames.isEmpty()) {
+            account(QAVMemoryBudget::DecodedFrames, m_frameBytes, -QAVMemoryBudget::bytes(m_decodedFrames.front()));
             m_decodedFrames.pop_front();
+        }
     }
 
     void waitForEmpty()
     {
-        QMutexLocker locker(&m_mutex);
+        QAVMutexLocker locker(&m_mutex);
         clearPackets();
         if (!m_abort && !m_waitingForPackets)
-            m_producerWaiter.wait(&m_mutex);
+            m_producerWaiter.wait(m_mutex.native());
     }
 
     void abort(bool aborted = true)
     {
-        QMutexLocker locker(&m_mutex);
+        QAVMutexLocker locker(&m_mutex);
         m_abort = aborted;
         m_waitingForPackets = true;
         m_consumerWaiter.wakeAll();
         m_producerWaiter.wakeAll();
     }
 
-    bool enough() const
+    // Checks if the buffered packets last for the seconds,
+    // falls back to the count of packets if the duration could not be measured
+    bool enough(double seconds) const
+    {
+        QAVMutexLocker locker(&m_mutex);
+        const double buffered = bufferedDuration();
+        if (buffered < 0) {
+            const int minFrames = 15;
+            return m_packets.size() > minFrames;
+        }
+        return !m_packets.isEmpty() && buffered >= seconds;
+    }
+
+    // Seconds of the buffered packets, -1 if not known
+    double duration() const
+    {
+        QAVMutexLocker locker(&m_mutex);
+        return bufferedDuration();
+    }
+
+    // Bytes per second of the enqueued packets, 0 if not measured yet
+    double bitrate() const
+    {
+        QAVMutexLocker locker(&m_mutex);
+        return measuredBitrate();
+    }
+
+    // Counts how many times the consumer waited for packets
+    int underruns() const
     {
-        QMutexLocker locker(&m_mutex);
-        const int minFrames = 15;
-        return m_packets.size() > minFrames && (!m_duration || m_duration > 1.0);
+        QAVMutexLocker locker(&m_mutex);
+        return m_underruns;
     }
 
     int bytes() const
     {
-        QMutexLocker locker(&m_mutex);
+        QAVMutexLocker locker(&m_mutex);
         return m_bytes;
     }
 
     void clear()
     {
-        QMutexLocker locker(&m_mutex);
+        QAVMutexLocker locker(&m_mutex);
         clearPackets();
     }
 
+    // Moves out the packets which are not decoded yet, the decoded frames are dropped
+    QList<QAVPacket> takePackets()
+    {
+        QAVMutexLocker locker(&m_mutex);
+        QList<QAVPacket> packets;
+        packets.swap(m_packets);
+        clearPackets();
+        return packets;
+    }
+
     void clearFrames()
     {
-        QMutexLocker locker(&m_mutex);
+        QAVMutexLocker locker(&m_mutex);
         m_decodedFrames.clear();
+        account(QAVMemoryBudget::DecodedFrames, m_frameBytes, -m_frameBytes);
     }
 
     void wake(bool wake)
     {
-        QMutexLocker locker(&m_mutex);
+        QAVMutexLocker locker(&m_mutex);
         if (wake)
             m_consumerWaiter.wakeAll();
         m_wake = wake;
     }
 
 private:
+    // The cap of frame buffers is applied before decoding: the decoder is not fed until
+    // other frames are released. Waits without the lock, so the demuxer is not blocked
+    // and the frames of this queue could be released
+    void waitForBuffers()
+    {
+        if (m_mediaType == AVMEDIA_TYPE_SUBTITLE)
+            return;
+        auto &pool = QAVBufferPool::instance();
+        while (pool.exhausted()) {
+            {
+                QAVMutexLocker locker(&m_mutex);
+                if (m_abort || m_wake || !m_decodedFrames.isEmpty() || m_packets.isEmpty())
+                    return;
+            }
+            pool.waitForRelease(10);
+        }
+    }
+
+    bool decodeFrames()
+    {
+        if (m_decodedFrames.isEmpty()) {
+            QList<QAVPacket> packets;
+            packets.push_back(dequeue());
+            // Takes the following packets of the same stream if they could be decoded in parallel
+            const auto stream = packets.first().stream();
+            const int count = packets.first() ? m_demuxer.decoders(stream) : 1;
+            while (packets.size() < count
+                   && !m_packets.isEmpty()
+                   && m_packets.first()
+                   && m_packets.first().stream().index() == stream.index())
+            {
+                packets.push_back(takePacket());
+            }
+            m_demuxer.decode(packets, m_decodedFrames);
+            qint64 bytes = 0;
+            for (const auto &frame : m_decodedFrames)
+                bytes += QAVMemoryBudget::bytes(frame);
+            account(QAVMemoryBudget::DecodedFrames, m_frameBytes, bytes);
+        }
+        return !m_decodedFrames.isEmpty();
+    }
+
     QAVPacket dequeue()
     {
         if (m_packets.isEmpty()) {
             m_producerWaiter.wakeAll();
             if (!m_abort && !m_wake) {
+                ++m_underruns;
                 m_waitingForPackets = true;
-                m_consumerWaiter.wait(&m_mutex);
+                m_consumerWaiter.wait(m_mutex.native());
                 m_waitingForPackets = false;
             }
         }
         if (m_packets.isEmpty())
             return {};
 
+        return takePacket();
+    }
+
+    QAVPacket takePacket()
+    {
         auto packet = m_packets.takeFirst();
         m_bytes -= packet.packet()->size + sizeof(packet);
-        m_duration -= packet.duration();
+        m_duration = !m_packets.isEmpty() ? m_duration - packet.duration() : 0;
+        account(QAVMemoryBudget::Packets, m_packetBytes, -QAVMemoryBudget::bytes(packet));
         return packet;
     }
 
@@ -249,14 +346,66 @@ private:
         m_decodedFrames.clear();
         m_bytes = 0;
         m_duration = 0;
+        m_measuredBytes = 0;
+        m_firstPts = m_lastPts = NAN;
+        account(QAVMemoryBudget::Packets, m_packetBytes, -m_packetBytes);
+        account(QAVMemoryBudget::DecodedFrames, m_frameBytes, -m_frameBytes);
+    }
+
+    // Packets could have no durations, then the bitrate is measured by pts
+    void measure(const QAVPacket &packet)
+    {
+        if (!packet || packet.packet()->pts == AV_NOPTS_VALUE)
+            return;
+        const double pts = packet.pts();
+        const double end = pts + packet.duration();
+        if (isnan(m_firstPts) || pts < m_firstPts)
+            m_firstPts = pts;
+        if (isnan(m_lastPts) || end > m_lastPts)
+            m_lastPts = end;
+        m_measuredBytes += packet.packet()->size;
+        // Halves the window to follow changes of the bitrate
+        const double maxWindow = 10.0;
+        const double window = m_lastPts - m_firstPts;
+        if (window > maxWindow) {
+            m_measuredBytes /= 2;
+            m_firstPts = m_lastPts - window / 2;
+        }
+    }
+
+    double measuredBitrate() const
+    {
+        const double window = m_lastPts - m_firstPts;
+        return !isnan(window) && window > 0 ? m_measuredBytes / window : 0.0;
+    }
+
+    double bufferedDuration() const
+    {
+        if (m_duration > 0)
+            return m_duration;
+        const double rate = measuredBitrate();
+        return rate > 0 ? m_bytes / rate : -1.0;
+    }
+
+    // Keeps own counters to release all memory on clear
+    void account(QAVMemoryBudget::Component c, qint64 &counter, qint64 bytes)
+    {
+        counter += bytes;
+        if (!m_budget)
+            return;
+        if (bytes > 0)
+            m_budget->add(c, bytes);
+        else
+            m_budget->release(c, -bytes);
     }
 
     const AVMediaType m_mediaType = AVMEDIA_TYPE_UNKNOWN;
     QAVDemuxer &m_demuxer;
+    QAVMemoryBudget *m_budget = nullptr;
     QList<QAVPacket> m_packets;
     // Tracks decoded frames to prevent EOF if not all frames are landed
     QList<T> m_decodedFrames;
-    mutable QMutex m_mutex;
+    mutable QAVMutex m_mutex {"QAVPacketQueue"};
     QWaitCondition m_consumerWaiter;
     QWaitCondition m_producerWaiter;
     bool m_abort = false;
@@ -264,7 +413,13 @@ private:
     bool m_wake = false;
 
     int m_bytes = 0;
-    int m_duration = 0;
+    double m_duration = 0;
+    int m_underruns = 0;
+    qint64 m_measuredBytes = 0;
+    double m_firstPts = NAN;
+    double m_lastPts = NAN;
+    qint64 m_packetBytes = 0;
+    qint64 m_frameBytes = 0;
 
 private:
     Q_DISABLE_COPY(QAVPacketQueue)
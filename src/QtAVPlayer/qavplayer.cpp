@@ -8,6 +8,7 @@
 #include "qavplayer.h"
 #include "qavdemuxer_p.h"
 #include "qavmuxer_p.h"
+#include "qavmemorybudget_p.h"
 #include "qaviodevice.h"
 #include "qavvideocodec_p.h"
 #include "qavaudiocodec_p.h"
@@ -19,12 +20,20 @@
 #include "qavvideofilter_p.h"
 #include "qavaudiofilter_p.h"
 #include "qavfilters_p.h"
+#include "qavthreadbudget_p.h"
+#include "qavbufferpool_p.h"
+#include "qavvideoconverter_p.h"
+#include "qavmutex_p.h"
+#include "qavallocations_p.h"
 #include <QtConcurrent/qtconcurrentrun.h>
 #include <QLoggingCategory>
+#include <QTimer>
 #include <functional>
+#include <atomic>
 
 extern "C" {
 #include <libavformat/avformat.h>
+#include <libavutil/time.h>
 }
 
 QT_BEGIN_NAMESPACE
@@ -48,11 +57,13 @@ class QAVPlayerPrivate
 public:
     QAVPlayerPrivate(QAVPlayer *q)
         : q_ptr(q)
-        , videoQueue(AVMEDIA_TYPE_VIDEO, demuxer)
-        , audioQueue(AVMEDIA_TYPE_AUDIO, demuxer)
-        , subtitleQueue(AVMEDIA_TYPE_SUBTITLE, demuxer)
+        , videoQueue(AVMEDIA_TYPE_VIDEO, demuxer, &memoryBudget)
+        , audioQueue(AVMEDIA_TYPE_AUDIO, demuxer, &memoryBudget)
+        , subtitleQueue(AVMEDIA_TYPE_SUBTITLE, demuxer, &memoryBudget)
     {
         threadPool.setMaxThreadCount(4);
+        muxer.setMemoryBudget(&memoryBudget);
+        hibernateTimer.setSingleShot(true);
     }
 
     QAVPlayer::Error currentError() const;
@@ -73,9 +84,27 @@ public:
     double pts() const;
     void applyFilters();
     void applyFilters(bool reset, const QAVFrame &frame);
-    void resetMuxer();
+    void resetMuxer(bool loading = false);
+    bool setLoadTiming(qint64 QAVPlayer::LoadTimings::*timing, std::atomic_bool &measured, qint64 time = -1);
+    void emitVideoFrame(const QAVFrame &frame);
+    QAVPlayer::BufferingPolicy currentBufferingPolicy() const;
+    bool isBuffering() const;
+    void setBuffering(bool v);
+    void doWaitBuffering();
+    bool isBuffered(double videoSeconds, double audioSeconds) const;
+    bool isQueueFull(double videoSeconds, double audioSeconds) const;
+    void checkUnderruns(int &videoUnderruns, int &audioUnderruns);
+    void onFirstFrameSent();
 
     void terminate();
+    void shutdown();
+    void hibernate();
+    void wakeUp();
+    bool selectHibernatedStreams(AVMediaType type, const QList<QAVStream> &streams);
+    bool selectHibernatedVariant(int index);
+    QList<QAVPlayer::Variant> variants() const;
+    void emitVariantChanged(int previous, AVMediaType type);
+    void scheduleHibernation();
 
     void doWait();
     void wait(bool v);
@@ -107,6 +136,28 @@ public:
     void doPlayAudio();
     void doPlaySubtitle();
 
+    // Decodes an additional selected video or audio stream on own thread
+    struct StreamWorker
+    {
+        StreamWorker(AVMediaType mediaType, QAVDemuxer &demuxer, QAVMemoryBudget *budget)
+            : queue(mediaType, demuxer, budget)
+        {
+        }
+
+        QFuture<void> future;
+        QAVPacketQueue<QAVFrame> queue;
+        QAVQueueClock clock;
+        // The stream is not decoded by this worker anymore
+        std::atomic_bool stopped {false};
+    };
+
+    QAVPacketQueue<QAVFrame> &streamQueue(int index, AVMediaType mediaType);
+    QList<std::shared_ptr<StreamWorker>> workers() const;
+    bool isWorkersEmpty() const;
+    void route(QAVPacket &&packet, const QAVDemuxer::Routing &routing);
+    void reroute(const QAVDemuxer::Routing &prev, const QAVDemuxer::Routing &routing);
+    void doPlayStream(std::shared_ptr<StreamWorker> worker);
+
     template <class T>
     void dispatch(T fn);
 
@@ -117,22 +168,27 @@ public:
     QAVPlayer::MediaStatus mediaStatus = QAVPlayer::NoMedia;
     QList<PendingMediaStatus> pendingMediaStatuses;
     QAVPlayer::State state = QAVPlayer::StoppedState;
-    mutable QMutex stateMutex;
+    mutable QAVMutex stateMutex {"QAVPlayer::state"};
 
     bool seekable = false;
-    qreal speed = 1.0;
-    mutable QMutex speedMutex;
+    // Read per frame without the lock
+    std::atomic<qreal> speed {1.0};
+    mutable QAVMutex speedMutex {"QAVPlayer::speed"};
     double videoFrameRate = 0.0;
 
     double duration = 0;
-    double pendingPosition = 0;
-    bool pendingSeek = false;
-    double currPts = 0.0;
-    mutable QMutex positionMutex;
+    // Written under positionMutex, read without it on the hot path
+    std::atomic<double> pendingPosition {0};
+    std::atomic_bool pendingSeek {false};
+    std::atomic<double> currPts {0.0};
+    mutable QAVMutex positionMutex {"QAVPlayer::position"};
     bool synced = true;
+    bool posterFrame = false;
 
     QAVPlayer::Error error = QAVPlayer::NoError;
 
+    // Must outlive the queues and the muxer
+    QAVMemoryBudget memoryBudget {&QAVMemoryBudget::process()};
     QAVDemuxer demuxer;
     QAVMuxer muxer;
 
@@ -152,15 +208,52 @@ public:
     QAVPacketQueue<QAVSubtitleFrame> subtitleQueue;
     QAVQueueClock subtitleClock;
 
+    QMap<int, std::shared_ptr<StreamWorker>> streamWorkers;
+    // Finishing after the selection is changed
+    QList<std::shared_ptr<StreamWorker>> stoppedWorkers;
+    mutable QAVMutex streamWorkersMutex {"QAVPlayer::streamWorkers"};
+    // Video or audio frames of several streams are filtered by same filter graphs
+    QAVMutex videoFilterMutex {"QAVPlayer::videoFilter"};
+    QAVMutex audioFilterMutex {"QAVPlayer::audioFilter"};
+
     bool quit = 0;
-    bool isWaiting = false;
-    mutable QMutex waitMutex;
+    std::atomic_bool isWaiting {false};
+    mutable QAVMutex waitMutex {"QAVPlayer::wait"};
     QWaitCondition waitCond;
-    bool eof = false;
+    std::atomic_bool eof {false};
+    // Fast path of step() without stateMutex
+    std::atomic_bool hasPendingStatuses {false};
+    std::atomic_bool queuesWoken {false};
     std::atomic_bool startDemuxing {false};
 
     QList<QString> filterDescs;
     QAVFilters filters;
+
+    qint64 loadStart = 0;
+    QAVPlayer::LoadTimings timings;
+    mutable QMutex timingsMutex;
+    std::atomic_bool firstPacketRead {false};
+    std::atomic_bool firstFrameDecoded {false};
+    std::atomic_bool firstFrameSent {false};
+
+    QAVPlayer::BufferingPolicy bufferingPolicy;
+    std::atomic_bool buffering {false};
+    mutable QAVMutex bufferingMutex {"QAVPlayer::buffering"};
+    QWaitCondition bufferingCond;
+
+    // Threads, queues, decoders and filters are released while idle,
+    // the media is reloaded on wake up and seeked to the same frame
+    int hibernateTimeout = 0;
+    QTimer hibernateTimer;
+    std::atomic_bool hibernated {false};
+    double hibernatedPosition = 0.0;
+    // Restored by the loader, the streams and variant selected while hibernated are also applied there
+    mutable QAVMutex hibernateMutex {"QAVPlayer::hibernate"};
+    bool restoring = false;
+    int hibernatedVariant = -1;
+    QList<QAVPlayer::Variant> hibernatedVariants;
+    QMap<AVMediaType, QList<int>> hibernatedStreams;
+    QList<AVMediaType> selectedStreams;
 };
 
 static QString err_str(int err)
@@ -175,14 +268,14 @@ static QString err_str(int err)
 
 QAVPlayer::Error QAVPlayerPrivate::currentError() const
 {
-    QMutexLocker locker(&stateMutex);
+    QAVMutexLocker locker(&stateMutex);
     return error;
 }
 
 void QAVPlayerPrivate::setMediaStatus(QAVPlayer::MediaStatus status)
 {
     {
-        QMutexLocker locker(&stateMutex);
+        QAVMutexLocker locker(&stateMutex);
         if (mediaStatus == status)
             return;
 
@@ -198,16 +291,18 @@ void QAVPlayerPrivate::setMediaStatus(QAVPlayer::MediaStatus status)
 
 void QAVPlayerPrivate::resetPendingStatuses()
 {
-    QMutexLocker locker(&stateMutex);
+    QAVMutexLocker locker(&stateMutex);
     qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << pendingMediaStatuses;
     pendingMediaStatuses.clear();
+    hasPendingStatuses = false;
     wait(true);
 }
 
 void QAVPlayerPrivate::setPendingMediaStatus(PendingMediaStatus status)
 {
-    QMutexLocker locker(&stateMutex);
+    QAVMutexLocker locker(&stateMutex);
     pendingMediaStatuses.push_back(status);
+    hasPendingStatuses = true;
     qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << mediaStatus << "->" << pendingMediaStatuses;
 }
 
@@ -216,7 +311,7 @@ bool QAVPlayerPrivate::setState(QAVPlayer::State s)
     Q_Q(QAVPlayer);
     bool result = false;
     {
-        QMutexLocker locker(&stateMutex);
+        QAVMutexLocker locker(&stateMutex);
         if (state == s)
             return result;
 
@@ -253,19 +348,16 @@ void QAVPlayerPrivate::setDuration(double d)
 
 bool QAVPlayerPrivate::isSeeking() const
 {
-    QMutexLocker locker(&positionMutex);
     return pendingSeek;
 }
 
 bool QAVPlayerPrivate::isEndOfFile() const
 {
-    QMutexLocker locker(&stateMutex);
     return eof;
 }
 
 void QAVPlayerPrivate::endOfFile(bool v)
 {
-    QMutexLocker locker(&stateMutex);
     eof = v;
 }
 
@@ -282,14 +374,12 @@ void QAVPlayerPrivate::setVideoFrameRate(double v)
 
 void QAVPlayerPrivate::setPts(double v)
 {
-    QMutexLocker locker(&positionMutex);
     if (!isnan(v))
         currPts = v;
 }
 
 double QAVPlayerPrivate::pts() const
 {
-    QMutexLocker locker(&positionMutex);
     return currPts;
 }
 
@@ -303,7 +393,7 @@ void QAVPlayerPrivate::setError(QAVPlayer::Error err, const QString &str)
 {
     Q_Q(QAVPlayer);
     {
-        QMutexLocker locker(&stateMutex);
+        QAVMutexLocker locker(&stateMutex);
         error = err;
     }
 
@@ -318,9 +408,41 @@ void QAVPlayerPrivate::terminate()
 {
     qCDebug(lcAVPlayer) << __FUNCTION__;
     setState(QAVPlayer::StoppedState);
+    hibernateTimer.stop();
+    if (hibernated) {
+        hibernated = false;
+        Q_EMIT q_ptr->hibernatedChanged(false);
+    }
+    shutdown();
+    videoFrameRate = 0.0;
+
+    pendingPosition = 0;
+    pendingSeek = false;
+    currPts = 0.0;
+    pendingMediaStatuses.clear();
+    hasPendingStatuses = false;
+    queuesWoken = false;
+    filters.clear();
+    setDuration(0);
+    error = QAVPlayer::NoError;
+    dev.reset();
+    eof = false;
+    startDemuxing = false;
+    setBuffering(false);
+    {
+        QMutexLocker locker(&timingsMutex);
+        timings = {};
+    }
+    firstPacketRead = false;
+    firstFrameDecoded = false;
+    firstFrameSent = false;
+}
+
+// Stops all threads and unloads the media
+void QAVPlayerPrivate::shutdown()
+{
     quit = true;
     wait(false);
-    videoFrameRate = 0.0;
     videoQueue.clear();
     videoQueue.abort();
     videoClock.clear();
@@ -330,35 +452,212 @@ void QAVPlayerPrivate::terminate()
     subtitleQueue.clear();
     subtitleQueue.abort();
     subtitleClock.clear();
+    for (auto &worker : workers()) {
+        worker->queue.clear();
+        worker->queue.abort();
+    }
     if (dev)
         dev->abort(true);
     demuxer.abort();
     demuxerFuture.waitForFinished();
+    // The workers are created by the demuxer thread, including the ones started while quitting
+    auto allWorkers = workers();
+    {
+        QAVMutexLocker locker(&streamWorkersMutex);
+        allWorkers += stoppedWorkers;
+    }
+    for (auto &worker : allWorkers) {
+        worker->queue.clear();
+        worker->queue.abort();
+    }
     loaderFuture.waitForFinished();
     videoPlayFuture.waitForFinished();
     audioPlayFuture.waitForFinished();
+    subtitlePlayFuture.waitForFinished();
+    for (auto &worker : allWorkers)
+        worker->future.waitForFinished();
+    {
+        QAVMutexLocker locker(&streamWorkersMutex);
+        streamWorkers.clear();
+        stoppedWorkers.clear();
+        threadPool.setMaxThreadCount(4);
+    }
     videoQueue.abort(false);
     audioQueue.abort(false);
     subtitleQueue.abort(false);
     demuxer.abort(false);
     demuxer.unload();
     muxer.unload();
+}
 
-    pendingPosition = 0;
-    pendingSeek = false;
-    currPts = 0.0;
-    pendingMediaStatuses.clear();
+void QAVPlayerPrivate::hibernate()
+{
+    Q_Q(QAVPlayer);
+    // Reloading would truncate the output
+    if (hibernated || url.isEmpty() || !outputFilename.isEmpty()
+        || q->state() == QAVPlayer::PlayingState || currentError() != QAVPlayer::NoError)
+    {
+        return;
+    }
+
+    // Not idle yet
+    if (hasPendingStatuses || isSeeking() || !loaderFuture.isFinished()) {
+        hibernateTimer.start(hibernateTimeout > 0 ? hibernateTimeout : 100);
+        return;
+    }
+
+    hibernateTimer.stop();
+    // The sent frame is not sent again
+    hibernatedPosition = pts() + (firstFrameSent ? 1e-6 : 0.0);
+    {
+        QAVMutexLocker locker(&hibernateMutex);
+        hibernatedVariant = demuxer.currentVariant();
+        hibernatedVariants = variants();
+        hibernatedStreams.clear();
+        selectedStreams.clear();
+        auto indexes = [](const QList<QAVStream> &streams) {
+            QList<int> ret;
+            for (const auto &stream : streams)
+                ret.push_back(stream.index());
+            return ret;
+        };
+        // Also the types without selected streams
+        hibernatedStreams[AVMEDIA_TYPE_VIDEO] = indexes(demuxer.currentVideoStreams());
+        hibernatedStreams[AVMEDIA_TYPE_AUDIO] = indexes(demuxer.currentAudioStreams());
+        hibernatedStreams[AVMEDIA_TYPE_SUBTITLE] = indexes(demuxer.currentSubtitleStreams());
+    }
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ": pos" << hibernatedPosition << ", variant" << hibernatedVariant
+                        << ", streams" << hibernatedStreams;
+
+    shutdown();
+    if (dev)
+        dev->abort(false);
     filters.clear();
-    setDuration(0);
-    error = QAVPlayer::NoError;
-    dev.reset();
-    eof = false;
     startDemuxing = false;
+    setBuffering(false);
+    // Frame buffers of released decoders are returned to the process pools
+    QAVBufferPool::instance().trim();
+    QAVPool::instance().trim();
+    QAVVideoConverters::instance().trim();
+    // Parks the idle threads
+    threadPool.waitForDone();
+
+    hibernated = true;
+    Q_EMIT q->hibernatedChanged(true);
+}
+
+// Reopens the media, the demuxer seeks to the same position as soon as demuxing is started
+void QAVPlayerPrivate::wakeUp()
+{
+    Q_Q(QAVPlayer);
+    if (!hibernated)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ": pos" << hibernatedPosition;
+    hibernated = false;
+    quit = false;
+    wait(true);
+    {
+        QAVMutexLocker locker(&positionMutex);
+        pendingSeek = true;
+        pendingPosition = hibernatedPosition;
+    }
+    {
+        QAVMutexLocker locker(&hibernateMutex);
+        restoring = true;
+    }
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    loaderFuture = QtConcurrent::run(&threadPool, this, &QAVPlayerPrivate::doLoad);
+#else
+    loaderFuture = QtConcurrent::run(&threadPool, &QAVPlayerPrivate::doLoad, this);
+#endif
+    Q_EMIT q->hibernatedChanged(false);
+}
+
+// Selected streams are applied by the loader while it has not restored the streams yet
+bool QAVPlayerPrivate::selectHibernatedStreams(AVMediaType type, const QList<QAVStream> &streams)
+{
+    {
+        QAVMutexLocker locker(&hibernateMutex);
+        if (!hibernated && !restoring)
+            return false;
+        QList<int> indexes;
+        for (const auto &stream : streams)
+            indexes.push_back(stream.index());
+        qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << type << hibernatedStreams.value(type) << "->" << indexes;
+        hibernatedStreams[type] = indexes;
+        if (!selectedStreams.contains(type))
+            selectedStreams.push_back(type);
+    }
+    wakeUp();
+    scheduleHibernation();
+    return true;
+}
+
+// The streams of the previous variant are not restored then, the variant selects own ones
+bool QAVPlayerPrivate::selectHibernatedVariant(int index)
+{
+    {
+        QAVMutexLocker locker(&hibernateMutex);
+        if (!hibernated && !restoring)
+            return false;
+        if (index < 0 || index >= hibernatedVariants.size())
+            return true;
+        qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << hibernatedVariant << "->" << index;
+        hibernatedVariant = index;
+        hibernatedStreams.clear();
+        for (auto type : {AVMEDIA_TYPE_VIDEO, AVMEDIA_TYPE_AUDIO, AVMEDIA_TYPE_SUBTITLE}) {
+            if (!selectedStreams.contains(type))
+                selectedStreams.push_back(type);
+        }
+    }
+    Q_EMIT q_ptr->variantChanged(index);
+    wakeUp();
+    scheduleHibernation();
+    return true;
+}
+
+QList<QAVPlayer::Variant> QAVPlayerPrivate::variants() const
+{
+    QList<QAVPlayer::Variant> ret;
+    for (const auto &v : demuxer.variants())
+        ret.push_back({v.id, v.bandwidth, v.size, v.streams});
+    return ret;
+}
+
+// Selecting a stream of another variant switches to that variant
+void QAVPlayerPrivate::emitVariantChanged(int previous, AVMediaType type)
+{
+    Q_Q(QAVPlayer);
+    const int variant = demuxer.currentVariant();
+    if (variant == previous)
+        return;
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << previous << "->" << variant;
+    Q_EMIT q->variantChanged(variant);
+    if (type != AVMEDIA_TYPE_VIDEO)
+        Q_EMIT q->videoStreamsChanged(demuxer.currentVideoStreams());
+    if (type != AVMEDIA_TYPE_AUDIO)
+        Q_EMIT q->audioStreamsChanged(demuxer.currentAudioStreams());
+    if (type != AVMEDIA_TYPE_SUBTITLE)
+        Q_EMIT q->subtitleStreamsChanged(demuxer.currentSubtitleStreams());
+}
+
+void QAVPlayerPrivate::scheduleHibernation()
+{
+    Q_Q(QAVPlayer);
+    if (hibernateTimeout > 0 && !hibernated && !url.isEmpty() && q->state() != QAVPlayer::PlayingState)
+        hibernateTimer.start(hibernateTimeout);
+    else
+        hibernateTimer.stop();
 }
 
 void QAVPlayerPrivate::step(bool hasFrame)
 {
-    QMutexLocker locker(&stateMutex);
+    // Called per frame, nothing to do in most cases
+    if (!hasPendingStatuses && !queuesWoken)
+        return;
+
+    QAVMutexLocker locker(&stateMutex);
     while (!pendingMediaStatuses.isEmpty()) {
         auto status = pendingMediaStatuses.first();
         locker.unlock();
@@ -367,14 +666,18 @@ void QAVPlayerPrivate::step(bool hasFrame)
         locker.relock();
         if (!pendingMediaStatuses.isEmpty()) {
             pendingMediaStatuses.removeFirst();
+            hasPendingStatuses = !pendingMediaStatuses.isEmpty();
             qCDebug(lcAVPlayer) << "Step done:" << status << ", pending" << pendingMediaStatuses;
         }
     }
 
     if (pendingMediaStatuses.isEmpty()) {
+        queuesWoken = false;
         videoQueue.wake(false);
         audioQueue.wake(false);
         subtitleQueue.wake(false);
+        for (auto &worker : workers())
+            worker->queue.wake(false);
     } else {
         wait(false);
     }
@@ -455,6 +758,7 @@ bool QAVPlayerPrivate::doStep(PendingMediaStatus status, bool hasFrame)
         && demuxer.eof()
         && videoQueue.isEmpty()
         && audioQueue.isEmpty()
+        && isWorkersEmpty()
         && filters.isEmpty()
         && !isSeeking())
     {
@@ -467,17 +771,19 @@ bool QAVPlayerPrivate::doStep(PendingMediaStatus status, bool hasFrame)
 
 void QAVPlayerPrivate::doWait()
 {
-    QMutexLocker lock(&waitMutex);
+    if (!isWaiting)
+        return;
+    QAVMutexLocker lock(&waitMutex);
     if (isWaiting)
-        waitCond.wait(&waitMutex);
+        waitCond.wait(waitMutex.native());
 }
 
 void QAVPlayerPrivate::wait(bool v)
 {
     {
-        QMutexLocker locker(&waitMutex);
+        QAVMutexLocker locker(&waitMutex);
         if (isWaiting != v)
-            qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << isWaiting << "->" << v;
+            qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << isWaiting.load() << "->" << v;
         isWaiting = v;
     }
 
@@ -488,10 +794,17 @@ void QAVPlayerPrivate::wait(bool v)
     videoQueue.wake(true);
     audioQueue.wake(true);
     subtitleQueue.wake(true);
+    for (auto &worker : workers())
+        worker->queue.wake(true);
+    // Set after the queues, so step() does not miss them
+    queuesWoken = true;
 }
 
 void QAVPlayerPrivate::applyFilters()
 {
+    // Created by the loader
+    if (hibernated || !loaderFuture.isFinished())
+        return;
     applyFilters(false, {});
 }
 
@@ -500,53 +813,154 @@ void QAVPlayerPrivate::applyFilters(bool reset, const QAVFrame &frame)
     if ((filterDescs == filters.filterDescs()) && !reset)
         return;
     qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << filters.filterDescs() << "->" << filterDescs << "reset:" << reset;
+    const qint64 start = av_gettime_relative();
     int ret = filters.createFilters(filterDescs, frame, demuxer);
+    if (!firstFrameSent) {
+        // All filter graphs created before the first frame
+        QMutexLocker locker(&timingsMutex);
+        timings.createFilters = qMax<qint64>(timings.createFilters, 0) + av_gettime_relative() - start;
+    }
     if (ret < 0) {
         setError(QAVPlayer::FilterError, QLatin1String("Could not create filters: ") + err_str(ret));
         return;
     }
     videoQueue.clearFrames();
     audioQueue.clearFrames();
+    for (auto &worker : workers())
+        worker->queue.clearFrames();
     if (error == QAVPlayer::FilterError)
         setMediaStatus(QAVPlayer::LoadedMedia);
 }
 
-void QAVPlayerPrivate::resetMuxer()
+void QAVPlayerPrivate::resetMuxer(bool loading)
 {
     muxer.unload();
     QString filename = q_ptr->output();
     if (filename.isEmpty() || !demuxer.avctx())
         return;
     qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << filename;
+    const qint64 start = av_gettime_relative();
     int ret = muxer.load(demuxer.availableStreams(), filename);
+    // Later setOutput() calls are not part of loading
+    if (loading) {
+        QMutexLocker locker(&timingsMutex);
+        timings.openMuxer = av_gettime_relative() - start;
+    }
     if (ret < 0) {
         muxer.unload();
         setError(QAVPlayer::ResourceError, err_str(ret));
     }
 }
 
+void QAVPlayerPrivate::emitVideoFrame(const QAVFrame &frame)
+{
+    if (demuxer.videoSideDataOnly())
+        Q_EMIT q_ptr->videoFrame(QAVVideoFrame(frame).sideData());
+    else
+        Q_EMIT q_ptr->videoFrame(frame);
+}
+
+bool QAVPlayerPrivate::setLoadTiming(qint64 QAVPlayer::LoadTimings::*timing, std::atomic_bool &measured, qint64 time)
+{
+    if (measured.exchange(true))
+        return false;
+    QMutexLocker locker(&timingsMutex);
+    timings.*timing = (time >= 0 ? time : av_gettime_relative()) - loadStart;
+    return true;
+}
+
+void QAVPlayerPrivate::onFirstFrameSent()
+{
+    if (!setLoadTiming(&QAVPlayer::LoadTimings::firstFrame, firstFrameSent))
+        return;
+    dispatch([this] {
+        const auto t = q_ptr->loadTimings();
+        qCDebug(lcAVPlayer) << "[" << url << "]:" << t;
+        Q_EMIT q_ptr->loadTimingsChanged(t);
+    });
+}
+
 void QAVPlayerPrivate::doLoad()
 {
     demuxer.abort(false);
     demuxer.unload();
     int ret = demuxer.load(url, dev.get());
+    // The setters queue the selection until it is restored here
+    QAVMutexLocker locker(&hibernateMutex);
+    const bool restore = restoring;
+    restoring = false;
+    QList<AVMediaType> selected;
+    selected.swap(selectedStreams);
     if (ret < 0) {
+        locker.unlock();
         setError(QAVPlayer::ResourceError, err_str(ret));
         return;
     }
 
     if (demuxer.currentVideoStreams().isEmpty() && demuxer.currentAudioStreams().isEmpty()) {
+        locker.unlock();
         setError(QAVPlayer::ResourceError, QLatin1String("No codecs found"));
         return;
     }
 
+    // Same variant and streams as before hibernation
+    bool variantSwitched = false;
+    if (restore) {
+        if (hibernatedVariant >= 0)
+            demuxer.setVariant(hibernatedVariant);
+        const auto available = demuxer.availableStreams();
+        auto streams = [&](AVMediaType type) {
+            QList<QAVStream> result;
+            for (int index : hibernatedStreams.value(type)) {
+                if (index >= 0 && index < available.size() && available[index].stream()->codecpar->codec_type == type)
+                    result.push_back(available[index]);
+            }
+            return result;
+        };
+        if (hibernatedStreams.contains(AVMEDIA_TYPE_VIDEO))
+            demuxer.setVideoStreams(streams(AVMEDIA_TYPE_VIDEO));
+        if (hibernatedStreams.contains(AVMEDIA_TYPE_AUDIO))
+            demuxer.setAudioStreams(streams(AVMEDIA_TYPE_AUDIO));
+        if (hibernatedStreams.contains(AVMEDIA_TYPE_SUBTITLE))
+            demuxer.setSubtitleStreams(streams(AVMEDIA_TYPE_SUBTITLE));
+        // Streams of another variant were selected while hibernated
+        variantSwitched = hibernatedVariant >= 0 && demuxer.currentVariant() != hibernatedVariant;
+        if (variantSwitched)
+            selected = {AVMEDIA_TYPE_VIDEO, AVMEDIA_TYPE_AUDIO, AVMEDIA_TYPE_SUBTITLE};
+    }
+    locker.unlock();
+
     applyFilters(true, {});
-    resetMuxer();
-    dispatch([this]() -> void {
+    resetMuxer(true);
+
+    // Decode the first frame before any thread is started
+    QAVFrame poster;
+    qint64 firstPacketTime = -1;
+    if (q_ptr->isPosterFrameEnabled() && !restore)
+        poster = demuxer.posterFrame(&firstPacketTime);
+    // The packets are kept by the demuxer, so doDemux() reads them again later
+    if (firstPacketTime >= 0)
+        setLoadTiming(&QAVPlayer::LoadTimings::firstPacket, firstPacketRead, firstPacketTime);
+    if (poster)
+        setLoadTiming(&QAVPlayer::LoadTimings::firstDecodedFrame, firstFrameDecoded);
+
+    dispatch([this, poster, selected, variantSwitched]() -> void {
         qCDebug(lcAVPlayer) << "[" << url << "]: Loaded, seekable:" << demuxer.seekable() << ", duration:" << demuxer.duration();
         setSeekable(demuxer.seekable());
         setDuration(demuxer.duration());
         setVideoFrameRate(demuxer.videoFrameRate());
+        if (variantSwitched)
+            Q_EMIT q_ptr->variantChanged(demuxer.currentVariant());
+        if (selected.contains(AVMEDIA_TYPE_VIDEO))
+            Q_EMIT q_ptr->videoStreamsChanged(demuxer.currentVideoStreams());
+        if (selected.contains(AVMEDIA_TYPE_AUDIO))
+            Q_EMIT q_ptr->audioStreamsChanged(demuxer.currentAudioStreams());
+        if (selected.contains(AVMEDIA_TYPE_SUBTITLE))
+            Q_EMIT q_ptr->subtitleStreamsChanged(demuxer.currentSubtitleStreams());
+        if (poster) {
+            emitVideoFrame(poster);
+            onFirstFrameSent();
+        }
         step(false);
     });
 
@@ -570,30 +984,170 @@ void QAVPlayerPrivate::doLoad()
     qCDebug(lcAVPlayer) << __FUNCTION__ << "finished";
 }
 
+QAVPlayer::BufferingPolicy QAVPlayerPrivate::currentBufferingPolicy() const
+{
+    QAVMutexLocker locker(&bufferingMutex);
+    return bufferingPolicy;
+}
+
+bool QAVPlayerPrivate::isBuffering() const
+{
+    QAVMutexLocker locker(&bufferingMutex);
+    return buffering;
+}
+
+void QAVPlayerPrivate::setBuffering(bool v)
+{
+    Q_Q(QAVPlayer);
+    {
+        QAVMutexLocker locker(&bufferingMutex);
+        if (buffering == v)
+            return;
+        qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << buffering.load() << "->" << v;
+        buffering = v;
+    }
+    bufferingCond.wakeAll();
+    Q_EMIT q->bufferingChanged(v);
+}
+
+void QAVPlayerPrivate::doWaitBuffering()
+{
+    if (!buffering)
+        return;
+    QAVMutexLocker locker(&bufferingMutex);
+    while (buffering && !quit)
+        bufferingCond.wait(bufferingMutex.native(), 10);
+}
+
+// Streams that are not selected are always buffered
+bool QAVPlayerPrivate::isBuffered(double videoSeconds, double audioSeconds) const
+{
+    const auto routing = demuxer.routing();
+    return (routing->firstVideo < 0 || videoQueue.enough(videoSeconds))
+        && (routing->firstAudio < 0 || audioQueue.enough(audioSeconds));
+}
+
+// Limits bytes of the queues by the measured bitrate,
+// the fixed limit is used until the bitrate is known
+static bool queueFull(const QAVPacketQueue<QAVFrame> &queue, double seconds)
+{
+    const qint64 maxQueueBytes = 15 * 1024 * 1024;
+    const qint64 minQueueBytes = 256 * 1024;
+    const double rate = queue.bitrate();
+    const qint64 max = rate > 0 ? qMax(minQueueBytes, qint64(rate * seconds * 4)) : maxQueueBytes;
+    return queue.bytes() > max;
+}
+
+bool QAVPlayerPrivate::isQueueFull(double videoSeconds, double audioSeconds) const
+{
+    if (queueFull(videoQueue, videoSeconds) || queueFull(audioQueue, audioSeconds))
+        return true;
+    for (const auto &worker : workers()) {
+        const bool video = worker->queue.mediaType() == AVMEDIA_TYPE_VIDEO;
+        if (queueFull(worker->queue, video ? videoSeconds : audioSeconds))
+            return true;
+    }
+    return false;
+}
+
+// Consumers waited for packets while playing, starts rebuffering if enabled
+void QAVPlayerPrivate::checkUnderruns(int &videoUnderruns, int &audioUnderruns)
+{
+    Q_Q(QAVPlayer);
+    const int video = videoQueue.underruns();
+    const int audio = audioQueue.underruns();
+    if (video == videoUnderruns && audio == audioUnderruns)
+        return;
+
+    const auto videoStreams = video != videoUnderruns ? demuxer.currentVideoStreams() : QList<QAVStream>();
+    const auto audioStreams = audio != audioUnderruns ? demuxer.currentAudioStreams() : QList<QAVStream>();
+    videoUnderruns = video;
+    audioUnderruns = audio;
+    if (!startDemuxing || demuxer.eof() || isEndOfFile() || q->state() != QAVPlayer::PlayingState)
+        return;
+
+    // Queues of not selected streams are always empty
+    const auto &streams = !videoStreams.isEmpty() ? videoStreams : audioStreams;
+    if (streams.isEmpty())
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << streams.first();
+    Q_EMIT q->bufferUnderrun(streams.first());
+    const auto policy = currentBufferingPolicy();
+    if (policy.videoStartup > 0 || policy.audioStartup > 0)
+        setBuffering(true);
+}
+
 void QAVPlayerPrivate::doDemux()
 {
-    const int maxQueueBytes = 15 * 1024 * 1024;
     QMutex waiterMutex;
     QWaitCondition waiter;
+    int videoUnderruns = videoQueue.underruns();
+    int audioUnderruns = audioQueue.underruns();
+    bool started = false;
+    auto routed = demuxer.routing();
 
     while (!quit) {
-        if (videoQueue.bytes() + audioQueue.bytes() > maxQueueBytes
-            || (videoQueue.enough() && audioQueue.enough())
-            || !startDemuxing)
+        const auto policy = currentBufferingPolicy();
+        if (!startDemuxing) {
+            started = false;
+            videoUnderruns = videoQueue.underruns();
+            audioUnderruns = audioQueue.underruns();
+            QMutexLocker locker(&waiterMutex);
+            waiter.wait(&waiterMutex, 10);
+            continue;
+        }
+
+        // Playback starts when the startup targets are buffered
+        if (!started) {
+            started = true;
+            if ((policy.videoStartup > 0 || policy.audioStartup > 0) && !demuxer.eof())
+                setBuffering(true);
+        }
+        checkUnderruns(videoUnderruns, audioUnderruns);
+
+        // The selection is changed
+        const auto routing = demuxer.routing();
+        if (routing != routed) {
+            reroute(*routed, *routing);
+            routed = routing;
+        }
+
+        const bool full = memoryBudget.exceeded() || isQueueFull(policy.videoSteady, policy.audioSteady);
+        if (isBuffering()
+            && (full
+                || demuxer.eof()
+                || isBuffered(qMin(policy.videoStartup, policy.videoSteady),
+                              qMin(policy.audioStartup, policy.audioSteady))))
         {
+            setBuffering(false);
+        }
+
+        // Other queues are drained by own threads while reading is paused
+        if (memoryBudget.exceeded()) {
+            memoryBudget.wait(10);
+            continue;
+        }
+
+        if (full || isBuffered(policy.videoSteady, policy.audioSteady)) {
             QMutexLocker locker(&waiterMutex);
             waiter.wait(&waiterMutex, 10);
             continue;
         }
 
+        // Consumers must not be blocked to drain their queues on seek
+        if (isSeeking())
+            setBuffering(false);
+
         {
-            QMutexLocker locker(&positionMutex);
+            QAVMutexLocker locker(&positionMutex);
             if (pendingSeek) {
-                if (pendingPosition < 0)
-                    pendingPosition += demuxer.duration();
-                if (pendingPosition < 0)
-                    pendingPosition = 0;
-                const double pos = pendingPosition;
+                double pos = pendingPosition;
+                if (pos < 0)
+                    pos += demuxer.duration();
+                if (pos < 0)
+                    pos = 0;
+                pendingPosition = pos;
                 locker.unlock();
                 qCDebug(lcAVPlayer) << "Seeking to pos:" << pos * 1000;
                 int ret = demuxer.seek(pos);
@@ -607,6 +1161,10 @@ void QAVPlayerPrivate::doDemux()
                     qCDebug(lcAVPlayer) << "Waiting subtitle thread finished processing packets";
                     subtitleQueue.waitForEmpty();
                     subtitleClock.clear();
+                    for (auto &worker : workers()) {
+                        worker->queue.waitForEmpty();
+                        worker->clock.clear();
+                    }
                     qCDebug(lcAVPlayer) << "Flush codec buffers";
                     demuxer.flushCodecBuffers();
                     qCDebug(lcAVPlayer) << "Reset filters";
@@ -616,33 +1174,24 @@ void QAVPlayerPrivate::doDemux()
                     qWarning() << "Could not seek:" << ret << ":" << err_str(ret);
                 }
                 locker.relock();
-                if (qFuzzyCompare(pendingPosition, pos))
+                if (qFuzzyCompare(pendingPosition.load(), pos))
                     pendingSeek = false;
             }
         }
 
         auto packet = demuxer.read();
         if (packet.stream()) {
+            if (!firstPacketRead)
+                setLoadTiming(&QAVPlayer::LoadTimings::firstPacket, firstPacketRead);
             endOfFile(false);
             // Empty packet points to EOF and it needs to flush codecs
-            switch (demuxer.currentCodecType(packet.packet()->stream_index)) {
-                case AVMEDIA_TYPE_VIDEO:
-                    videoQueue.enqueue(packet);
-                    break;
-                case AVMEDIA_TYPE_AUDIO:
-                    audioQueue.enqueue(packet);
-                    break;
-                case AVMEDIA_TYPE_SUBTITLE:
-                    subtitleQueue.enqueue(packet);
-                    break;
-                default:
-                    break;
-            }
+            route(std::move(packet), *routed);
         } else {
             if (demuxer.eof()
                 && videoQueue.isEmpty()
                 && audioQueue.isEmpty()
                 && subtitleQueue.isEmpty()
+                && isWorkersEmpty()
                 && filters.isEmpty()
                 && !isEndOfFile())
             {
@@ -688,13 +1237,19 @@ bool QAVPlayerPrivate::skipFrame(
     const QAVStreamFrame &frame,
     bool isEmpty)
 {
-    QMutexLocker locker(&positionMutex);
+    // Frames are not skipped unless seeking
+    if (pendingSeek)
+        return true;
+    if (pendingPosition <= 0)
+        return false;
+
+    QAVMutexLocker locker(&positionMutex);
     bool result = pendingSeek;
     if (!pendingSeek && pendingPosition > 0) {
         const bool isQueueEOF = demuxer.eof() && isEmpty;
         // Assume that no frames will be sent after this duration
         const double duration = streamDuration(frame, demuxer);
-        const double requestedPos = qMin(pendingPosition, duration);
+        const double requestedPos = qMin(pendingPosition.load(), duration);
         double pos = frame.pts();
         // Show last frame if seeked to duration
         bool lastFrame = false;
@@ -726,6 +1281,7 @@ void QAVPlayerPrivate::doPlayStep(
     const std::function<void(const QAVFrame &frame)> &cb)
 {
     doWait();
+    doWaitBuffering();
 
     // 1. Decode a frame
     QAVFrame decodedFrame;
@@ -734,11 +1290,15 @@ void QAVPlayerPrivate::doPlayStep(
     int ret = 0;
 
     // Determine if current thread is handling events and pts
-    if (decodedFrame)
+    if (decodedFrame) {
         master = demuxer.isMasterStream(decodedFrame.stream());
+        if (!firstFrameDecoded)
+            setLoadTiming(&QAVPlayer::LoadTimings::firstDecodedFrame, firstFrameDecoded);
+    }
 
     // 2. Filter decoded frame
     QList<QAVFrame> filteredFrames;
+    QAVMutexLocker filterLocker(queue.mediaType() == AVMEDIA_TYPE_VIDEO ? &videoFilterMutex : &audioFilterMutex);
     if (decodedFrame)
         ret = filters.write(queue.mediaType(), decodedFrame);
     if (ret >= 0 || ret == AVERROR(EAGAIN))
@@ -747,6 +1307,7 @@ void QAVPlayerPrivate::doPlayStep(
         // Try filters again
         filteredFrames.clear();
         if (ret != AVERROR(ENOTSUP)) {
+            filterLocker.unlock();
             setError(QAVPlayer::FilterError, err_str(ret));
             return;
         }
@@ -755,6 +1316,12 @@ void QAVPlayerPrivate::doPlayStep(
         // The frame is already filtered, decode next one
         queue.popFrame();
     }
+    filterLocker.unlock();
+
+    qint64 filteredBytes = 0;
+    for (const auto &frame : filteredFrames)
+        filteredBytes += QAVMemoryBudget::bytes(frame);
+    memoryBudget.add(QAVMemoryBudget::FilteredFrames, filteredBytes);
 
     // 3. Sync filtered frames
     while (!quit && !filteredFrames.isEmpty()) {
@@ -774,14 +1341,20 @@ void QAVPlayerPrivate::doPlayStep(
                     flushEvents = true;
                 cb(frame);
                 demuxer.onFrameSent(frame);
+                if (!firstFrameSent)
+                    onFirstFrameSent();
             }
             muxer.enqueue(frame);
+            const qint64 bytes = QAVMemoryBudget::bytes(frame);
+            filteredBytes -= bytes;
+            memoryBudget.release(QAVMemoryBudget::FilteredFrames, bytes);
             filteredFrames.pop_front();
         } else {
             flushEvents = isLastFrame(frame, demuxer);
         }
     }
 
+    memoryBudget.release(QAVMemoryBudget::FilteredFrames, filteredBytes);
     if (master)
         step(flushEvents);
 }
@@ -795,11 +1368,11 @@ void QAVPlayerPrivate::doPlayVideo()
     while (!quit) {
         doPlayStep(
             master,
-            !demuxer.currentAudioStreams().isEmpty() ? audioClock.pts() : -1,
+            demuxer.routing()->firstAudio >= 0 ? audioClock.pts() : -1,
             videoClock,
             videoQueue,
             sync,
-            [&](const QAVFrame &frame) { Q_EMIT q_ptr->videoFrame(frame); }
+            [&](const QAVFrame &frame) { emitVideoFrame(frame); }
         );
     }
 
@@ -836,6 +1409,143 @@ void QAVPlayerPrivate::doPlayAudio()
     qCDebug(lcAVPlayer) << __FUNCTION__ << "finished";
 }
 
+QAVPacketQueue<QAVFrame> &QAVPlayerPrivate::streamQueue(int index, AVMediaType mediaType)
+{
+    QAVMutexLocker locker(&streamWorkersMutex);
+    auto &worker = streamWorkers[index];
+    if (!worker) {
+        qCDebug(lcAVPlayer) << __FUNCTION__ << ": Starting decoding of stream" << index;
+        worker.reset(new StreamWorker(mediaType, demuxer, &memoryBudget));
+        if (mediaType == AVMEDIA_TYPE_VIDEO)
+            worker->clock.setFrameRate(demuxer.videoFrameRate());
+        threadPool.setMaxThreadCount(threadPool.maxThreadCount() + 1);
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+        worker->future = QtConcurrent::run(&threadPool, this, &QAVPlayerPrivate::doPlayStream, worker);
+#else
+        worker->future = QtConcurrent::run(&threadPool, &QAVPlayerPrivate::doPlayStream, this, worker);
+#endif
+    }
+    return worker->queue;
+}
+
+QList<std::shared_ptr<QAVPlayerPrivate::StreamWorker>> QAVPlayerPrivate::workers() const
+{
+    QAVMutexLocker locker(&streamWorkersMutex);
+    return streamWorkers.values();
+}
+
+bool QAVPlayerPrivate::isWorkersEmpty() const
+{
+    QAVMutexLocker locker(&streamWorkersMutex);
+    for (const auto &worker : streamWorkers) {
+        if (!worker->queue.isEmpty())
+            return false;
+    }
+    return true;
+}
+
+void QAVPlayerPrivate::route(QAVPacket &&packet, const QAVDemuxer::Routing &routing)
+{
+    const int index = packet.packet()->stream_index;
+    bool first = false;
+    switch (routing.type(index, &first)) {
+        case AVMEDIA_TYPE_VIDEO:
+            if (first)
+                videoQueue.enqueue(std::move(packet));
+            else
+                streamQueue(index, AVMEDIA_TYPE_VIDEO).enqueue(std::move(packet));
+            break;
+        case AVMEDIA_TYPE_AUDIO:
+            if (first)
+                audioQueue.enqueue(std::move(packet));
+            else
+                streamQueue(index, AVMEDIA_TYPE_AUDIO).enqueue(std::move(packet));
+            break;
+        case AVMEDIA_TYPE_SUBTITLE:
+            subtitleQueue.enqueue(std::move(packet));
+            break;
+        default:
+            break;
+    }
+}
+
+// The codec of a stream must be driven by one thread only:
+// packets left in the queues of the streams which changed the role are taken
+// under the queue locks, and routed again, the workers of these streams are stopped
+void QAVPlayerPrivate::reroute(const QAVDemuxer::Routing &prev, const QAVDemuxer::Routing &routing)
+{
+    QList<QAVPacket> packets;
+    if (routing.firstVideo != prev.firstVideo)
+        packets += videoQueue.takePackets();
+    if (routing.firstAudio != prev.firstAudio)
+        packets += audioQueue.takePackets();
+
+    QList<std::shared_ptr<StreamWorker>> stopping;
+    {
+        QAVMutexLocker locker(&streamWorkersMutex);
+        for (auto it = streamWorkers.begin(); it != streamWorkers.end();) {
+            bool first = false;
+            const auto type = routing.type(it.key(), &first);
+            if (!first && (type == AVMEDIA_TYPE_VIDEO || type == AVMEDIA_TYPE_AUDIO)) {
+                ++it;
+                continue;
+            }
+            qCDebug(lcAVPlayer) << __FUNCTION__ << ": Stopping decoding of stream" << it.key();
+            stopping.push_back(it.value());
+            stoppedWorkers.push_back(it.value());
+            it = streamWorkers.erase(it);
+        }
+    }
+
+    for (auto &worker : stopping) {
+        worker->stopped = true;
+        packets += worker->queue.takePackets();
+        worker->queue.abort();
+    }
+
+    for (auto &packet : packets)
+        route(std::move(packet), routing);
+}
+
+void QAVPlayerPrivate::doPlayStream(std::shared_ptr<StreamWorker> worker)
+{
+    bool master = false;
+    bool sync = true;
+    const bool video = worker->queue.mediaType() == AVMEDIA_TYPE_VIDEO;
+
+    while (!quit && !worker->stopped) {
+        // Sync against the audio clock if any, or the first video stream
+        const double ref = demuxer.routing()->firstAudio >= 0 ? audioClock.pts() : videoClock.pts();
+        doPlayStep(
+            master,
+            ref,
+            worker->clock,
+            worker->queue,
+            sync,
+            [this, video, &worker](const QAVFrame &frame) {
+                // Frames decoded before the stream was routed to another thread
+                if (worker->stopped)
+                    return;
+                if (video) {
+                    emitVideoFrame(frame);
+                } else {
+                    frame.frame()->sample_rate *= q_ptr->speed();
+                    Q_EMIT q_ptr->audioFrame(frame);
+                }
+            }
+        );
+    }
+
+    worker->queue.clear();
+    worker->clock.clear();
+    if (worker->stopped) {
+        QAVMutexLocker locker(&streamWorkersMutex);
+        stoppedWorkers.removeOne(worker);
+        threadPool.setMaxThreadCount(threadPool.maxThreadCount() - 1);
+    }
+    qCDebug(lcAVPlayer) << __FUNCTION__ << "finished";
+}
+
 void QAVPlayerPrivate::doPlayStep(
     QAVQueueClock &clock,
     QAVPacketQueue<QAVSubtitleFrame> &queue,
@@ -893,7 +1603,12 @@ QAVPlayer::QAVPlayer(QObject *parent)
     qRegisterMetaType<State>();
     qRegisterMetaType<MediaStatus>();
     qRegisterMetaType<Error>();
+    qRegisterMetaType<MemoryPolicy>();
     qRegisterMetaType<QAVStream>();
+    qRegisterMetaType<LoadTimings>();
+    qRegisterMetaType<BufferingPolicy>();
+
+    connect(&d_ptr->hibernateTimer, &QTimer::timeout, this, [this] { d_func()->hibernate(); });
 }
 
 QAVPlayer::~QAVPlayer()
@@ -913,6 +1628,7 @@ void QAVPlayer::setSource(const QString &url, const QSharedPointer<QAVIODevice>
     d->terminate();
     d->url = url;
     d->dev = dev;
+    d->loadStart = av_gettime_relative();
     Q_EMIT sourceChanged(url);
     d->wait(true);
     d->quit = false;
@@ -926,6 +1642,7 @@ void QAVPlayer::setSource(const QString &url, const QSharedPointer<QAVIODevice>
 #else
     d->loaderFuture = QtConcurrent::run(&d->threadPool, &QAVPlayerPrivate::doLoad, d);
 #endif
+    d->scheduleHibernation();
 }
 
 QString QAVPlayer::source() const
@@ -937,7 +1654,7 @@ void QAVPlayer::setOutput(const QString &filename)
 {
     Q_D(QAVPlayer);
     {
-        QMutexLocker locker(&d->stateMutex);
+        QAVMutexLocker locker(&d->stateMutex);
         if (d->outputFilename == filename)
             return;
         d->outputFilename = filename;
@@ -950,7 +1667,7 @@ void QAVPlayer::setOutput(const QString &filename)
 QString QAVPlayer::output() const
 {
     Q_D(const QAVPlayer);
-    QMutexLocker locker(&d->stateMutex);
+    QAVMutexLocker locker(&d->stateMutex);
     return d->outputFilename;
 }
 
@@ -969,21 +1686,31 @@ QList<QAVStream> QAVPlayer::currentVideoStreams() const
 void QAVPlayer::setVideoStream(const QAVStream &stream)
 {
     Q_D(QAVPlayer);
+    if (d->selectHibernatedStreams(AVMEDIA_TYPE_VIDEO, {stream}))
+        return;
     if (d->demuxer.currentVideoStreams() == QList<QAVStream>({stream}))
         return;
     qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->demuxer.currentVideoStreams() << "->" << stream.index();
-    if (d->demuxer.setVideoStreams({stream}))
+    const int variant = d->demuxer.currentVariant();
+    if (d->demuxer.setVideoStreams({stream})) {
         Q_EMIT videoStreamsChanged(d->demuxer.currentVideoStreams());
+        d->emitVariantChanged(variant, AVMEDIA_TYPE_VIDEO);
+    }
 }
 
 void QAVPlayer::setVideoStreams(const QList<QAVStream> &streams)
 {
     Q_D(QAVPlayer);
+    if (d->selectHibernatedStreams(AVMEDIA_TYPE_VIDEO, streams))
+        return;
     if (d->demuxer.currentVideoStreams() == streams)
         return;
     qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->demuxer.currentVideoStreams() << "->" << streams;
-    if (d->demuxer.setVideoStreams(streams))
+    const int variant = d->demuxer.currentVariant();
+    if (d->demuxer.setVideoStreams(streams)) {
         Q_EMIT videoStreamsChanged(d->demuxer.currentVideoStreams());
+        d->emitVariantChanged(variant, AVMEDIA_TYPE_VIDEO);
+    }
 }
 
 QList<QAVStream> QAVPlayer::availableAudioStreams() const
@@ -1001,21 +1728,31 @@ QList<QAVStream> QAVPlayer::currentAudioStreams() const
 void QAVPlayer::setAudioStream(const QAVStream &stream)
 {
     Q_D(QAVPlayer);
+    if (d->selectHibernatedStreams(AVMEDIA_TYPE_AUDIO, {stream}))
+        return;
     if (d->demuxer.currentAudioStreams() == QList<QAVStream>({stream}))
         return;
     qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->demuxer.currentAudioStreams() << "->" << stream.index();
-    if (d->demuxer.setAudioStreams({stream}))
+    const int variant = d->demuxer.currentVariant();
+    if (d->demuxer.setAudioStreams({stream})) {
         Q_EMIT audioStreamsChanged(d->demuxer.currentAudioStreams());
+        d->emitVariantChanged(variant, AVMEDIA_TYPE_AUDIO);
+    }
 }
 
 void QAVPlayer::setAudioStreams(const QList<QAVStream> &streams)
 {
     Q_D(QAVPlayer);
+    if (d->selectHibernatedStreams(AVMEDIA_TYPE_AUDIO, streams))
+        return;
     if (d->demuxer.currentAudioStreams() == streams)
         return;
     qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->demuxer.currentAudioStreams() << "->" << streams;
-    if (d->demuxer.setAudioStreams(streams))
+    const int variant = d->demuxer.currentVariant();
+    if (d->demuxer.setAudioStreams(streams)) {
         Q_EMIT audioStreamsChanged(d->demuxer.currentAudioStreams());
+        d->emitVariantChanged(variant, AVMEDIA_TYPE_AUDIO);
+    }
 }
 
 QList<QAVStream> QAVPlayer::availableSubtitleStreams() const
@@ -1033,21 +1770,31 @@ QList<QAVStream> QAVPlayer::currentSubtitleStreams() const
 void QAVPlayer::setSubtitleStream(const QAVStream &stream)
 {
     Q_D(QAVPlayer);
+    if (d->selectHibernatedStreams(AVMEDIA_TYPE_SUBTITLE, {stream}))
+        return;
     if (d->demuxer.currentSubtitleStreams() == QList<QAVStream>({stream}))
         return;
     qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->demuxer.currentSubtitleStreams() << "->" << stream.index();
-    if (d->demuxer.setSubtitleStreams({stream}))
+    const int variant = d->demuxer.currentVariant();
+    if (d->demuxer.setSubtitleStreams({stream})) {
         Q_EMIT subtitleStreamsChanged(d->demuxer.currentSubtitleStreams());
+        d->emitVariantChanged(variant, AVMEDIA_TYPE_SUBTITLE);
+    }
 }
 
 void QAVPlayer::setSubtitleStreams(const QList<QAVStream> &streams)
 {
     Q_D(QAVPlayer);
+    if (d->selectHibernatedStreams(AVMEDIA_TYPE_SUBTITLE, streams))
+        return;
     if (d->demuxer.currentSubtitleStreams() == streams)
         return;
     qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->demuxer.currentSubtitleStreams() << "->" << streams;
-    if (d->demuxer.setSubtitleStreams(streams))
+    const int variant = d->demuxer.currentVariant();
+    if (d->demuxer.setSubtitleStreams(streams)) {
         Q_EMIT subtitleStreamsChanged(d->demuxer.currentSubtitleStreams());
+        d->emitVariantChanged(variant, AVMEDIA_TYPE_SUBTITLE);
+    }
 }
 
 AVFormatContext *QAVPlayer::avctx() const
@@ -1059,14 +1806,14 @@ AVFormatContext *QAVPlayer::avctx() const
 QAVPlayer::State QAVPlayer::state() const
 {
     Q_D(const QAVPlayer);
-    QMutexLocker locker(&d->stateMutex);
+    QAVMutexLocker locker(&d->stateMutex);
     return d->state;
 }
 
 QAVPlayer::MediaStatus QAVPlayer::mediaStatus() const
 {
     Q_D(const QAVPlayer);
-    QMutexLocker locker(&d->stateMutex);
+    QAVMutexLocker locker(&d->stateMutex);
     return d->mediaStatus;
 }
 
@@ -1076,6 +1823,7 @@ void QAVPlayer::play()
     if (d->url.isEmpty() || d->currentError() == QAVPlayer::ResourceError)
         return;
 
+    d->wakeUp();
     qCDebug(lcAVPlayer) << __FUNCTION__;
     if (d->setState(QAVPlayer::PlayingState)) {
         if (d->isEndOfFile()) {
@@ -1087,6 +1835,7 @@ void QAVPlayer::play()
     d->wait(false);
     if (mediaStatus() != QAVPlayer::NoMedia)
         d->applyFilters();
+    d->scheduleHibernation();
 }
 
 void QAVPlayer::pause()
@@ -1095,6 +1844,7 @@ void QAVPlayer::pause()
     if (d->currentError() == QAVPlayer::ResourceError)
         return;
 
+    d->wakeUp();
     qCDebug(lcAVPlayer) << __FUNCTION__;
     if (d->setState(QAVPlayer::PausedState)) {
         if (d->isEndOfFile()) {
@@ -1108,6 +1858,7 @@ void QAVPlayer::pause()
     }
     if (mediaStatus() != QAVPlayer::NoMedia)
         d->applyFilters();
+    d->scheduleHibernation();
 }
 
 void QAVPlayer::stop()
@@ -1116,6 +1867,7 @@ void QAVPlayer::stop()
     if (d->currentError() == QAVPlayer::ResourceError)
         return;
 
+    d->wakeUp();
     qCDebug(lcAVPlayer) << __FUNCTION__;
     if (d->setState(QAVPlayer::StoppedState)) {
         d->setPendingMediaStatus(StoppingMedia);
@@ -1125,6 +1877,7 @@ void QAVPlayer::stop()
     }
     if (mediaStatus() != QAVPlayer::NoMedia)
         d->applyFilters();
+    d->scheduleHibernation();
 }
 
 void QAVPlayer::stepForward()
@@ -1133,6 +1886,7 @@ void QAVPlayer::stepForward()
     if (d->currentError() == QAVPlayer::ResourceError)
         return;
 
+    d->wakeUp();
     qCDebug(lcAVPlayer) << __FUNCTION__;
     d->setState(QAVPlayer::PausedState);
     if (d->isEndOfFile()) {
@@ -1143,6 +1897,7 @@ void QAVPlayer::stepForward()
     d->wait(false);
     if (mediaStatus() != QAVPlayer::NoMedia)
         d->applyFilters();
+    d->scheduleHibernation();
 }
 
 void QAVPlayer::stepBackward()
@@ -1151,6 +1906,7 @@ void QAVPlayer::stepBackward()
     if (d->currentError() == QAVPlayer::ResourceError)
         return;
 
+    d->wakeUp();
     qCDebug(lcAVPlayer) << __FUNCTION__;
     d->setState(QAVPlayer::PausedState);
     const qint64 pos = d->pts() > 0 ? (d->pts() - videoFrameRate()) * 1000 : duration();
@@ -1159,6 +1915,7 @@ void QAVPlayer::stepBackward()
     d->wait(false);
     if (mediaStatus() != QAVPlayer::NoMedia)
         d->applyFilters();
+    d->scheduleHibernation();
 }
 
 bool QAVPlayer::isSeekable() const
@@ -1172,9 +1929,10 @@ void QAVPlayer::seek(qint64 pos)
     if ((duration() > 0 && pos > duration()) || d->currentError() == QAVPlayer::ResourceError)
         return;
 
+    d->wakeUp();
     qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << "pos:" << pos;
     {
-        QMutexLocker locker(&d->positionMutex);
+        QAVMutexLocker locker(&d->positionMutex);
         d->pendingSeek = true;
         d->pendingPosition = pos / 1000.0;
     }
@@ -1183,6 +1941,7 @@ void QAVPlayer::seek(qint64 pos)
     d->wait(false);
     if (mediaStatus() != QAVPlayer::NoMedia)
         d->applyFilters();
+    d->scheduleHibernation();
 }
 
 qint64 QAVPlayer::duration() const
@@ -1195,7 +1954,7 @@ qint64 QAVPlayer::position() const
     Q_D(const QAVPlayer);
 
     {
-        QMutexLocker locker(&d->positionMutex);
+        QAVMutexLocker locker(&d->positionMutex);
         if (d->pendingSeek)
             return d->pendingPosition * 1000 + (d->pendingPosition < 0 ? duration() : 0);
     }
@@ -1211,11 +1970,11 @@ void QAVPlayer::setSpeed(qreal r)
     Q_D(QAVPlayer);
 
     {
-        QMutexLocker locker(&d->speedMutex);
-        if (qFuzzyCompare(d->speed, r))
+        QAVMutexLocker locker(&d->speedMutex);
+        if (qFuzzyCompare(d->speed.load(), r))
             return;
 
-        qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->speed << "->" << r;
+        qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->speed.load() << "->" << r;
         d->speed = r;
     }
     Q_EMIT speedChanged(r);
@@ -1224,8 +1983,6 @@ void QAVPlayer::setSpeed(qreal r)
 qreal QAVPlayer::speed() const
 {
     Q_D(const QAVPlayer);
-
-    QMutexLocker locker(&d->speedMutex);
     return d->speed;
 }
 
@@ -1238,7 +1995,7 @@ void QAVPlayer::setFilter(const QString &desc)
 {
     Q_D(QAVPlayer);
     {
-        QMutexLocker locker(&d->stateMutex);
+        QAVMutexLocker locker(&d->stateMutex);
         if (d->filterDescs.size() == 1 && d->filterDescs.front() == desc)
             return;
 
@@ -1258,7 +2015,7 @@ void QAVPlayer::setFilters(const QList<QString> &filters)
 {
     Q_D(QAVPlayer);
     {
-        QMutexLocker locker(&d->stateMutex);
+        QAVMutexLocker locker(&d->stateMutex);
         qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->filterDescs << "->" << filters;
         d->filterDescs = filters;
     }
@@ -1271,7 +2028,7 @@ void QAVPlayer::setFilters(const QList<QString> &filters)
 QList<QString> QAVPlayer::filters() const
 {
     Q_D(const QAVPlayer);
-    QMutexLocker locker(&d->stateMutex);
+    QAVMutexLocker locker(&d->stateMutex);
     return d->filterDescs;
 }
 
@@ -1311,6 +2068,31 @@ void QAVPlayer::setSynced(bool sync)
     Q_EMIT syncedChanged(sync);
 }
 
+/*!
+ * \brief Decodes the first video frame, or the attached picture, during loading
+ * and sends it via videoFrame() before LoadedMedia. Filters are not applied.
+ */
+bool QAVPlayer::isPosterFrameEnabled() const
+{
+    Q_D(const QAVPlayer);
+    QAVMutexLocker locker(&d->stateMutex);
+    return d->posterFrame;
+}
+
+void QAVPlayer::setPosterFrameEnabled(bool enabled)
+{
+    Q_D(QAVPlayer);
+    {
+        QAVMutexLocker locker(&d->stateMutex);
+        if (d->posterFrame == enabled)
+            return;
+        d->posterFrame = enabled;
+    }
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << enabled;
+    Q_EMIT posterFrameEnabledChanged(enabled);
+}
+
 QString QAVPlayer::inputFormat() const
 {
     Q_D(const QAVPlayer);
@@ -1352,6 +2134,29 @@ QStringList QAVPlayer::supportedVideoCodecs()
     return QAVDemuxer::supportedVideoCodecs();
 }
 
+/*!
+ * \brief Selects the fastest software decoder of the video stream on load.
+ * First packets are decoded by each decoder of the codec, the result is cached
+ * per machine and codec profile. Ignored if inputVideoCodec() is set. Applied on next load.
+ */
+bool QAVPlayer::autoSelectVideoCodec() const
+{
+    Q_D(const QAVPlayer);
+    return d->demuxer.autoSelectVideoCodec();
+}
+
+void QAVPlayer::setAutoSelectVideoCodec(bool enabled)
+{
+    Q_D(QAVPlayer);
+    const bool current = autoSelectVideoCodec();
+    if (enabled == current)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << current << "->" << enabled;
+    d->demuxer.setAutoSelectVideoCodec(enabled);
+    Q_EMIT autoSelectVideoCodecChanged(enabled);
+}
+
 QMap<QString, QString> QAVPlayer::inputOptions() const
 {
     Q_D(const QAVPlayer);
@@ -1389,6 +2194,436 @@ void QAVPlayer::setVideoCodecOptions(const QMap<QString, QString> &opts)
     Q_EMIT videoCodecOptionsChanged(opts);
 }
 
+/*!
+ * \brief Number of decoders used for intra-only video streams, e.g. FFV1, DV, ProRes or MJPEG.
+ * Packets are decoded in parallel and the frames are returned in pts order.
+ * Hardware decoders are not affected, 0 or 1 disables. Applied on next load.
+ */
+int QAVPlayer::intraOnlyDecoders() const
+{
+    Q_D(const QAVPlayer);
+    return d->demuxer.intraOnlyDecoders();
+}
+
+void QAVPlayer::setIntraOnlyDecoders(int count)
+{
+    Q_D(QAVPlayer);
+    const int current = intraOnlyDecoders();
+    if (count == current)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << current << "->" << count;
+    d->demuxer.setIntraOnlyDecoders(count);
+    Q_EMIT intraOnlyDecodersChanged(count);
+}
+
+/*!
+ * \brief Weight of the video decoders of the player in the process-wide thread budget.
+ * Threads are divided by priority multiplied by the resolution. Applied on next load.
+ */
+int QAVPlayer::decoderPriority() const
+{
+    Q_D(const QAVPlayer);
+    return d->demuxer.decoderPriority();
+}
+
+void QAVPlayer::setDecoderPriority(int priority)
+{
+    Q_D(QAVPlayer);
+    const int current = decoderPriority();
+    if (priority == current)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << current << "->" << priority;
+    d->demuxer.setDecoderPriority(priority);
+    Q_EMIT decoderPriorityChanged(priority);
+}
+
+/*!
+ * \brief Total number of threads shared by software video decoders of all players.
+ * Each opened decoder gets a share by its priority and resolution.
+ * Live sources use slice threading to avoid frame delays.
+ * When decoders are opened or closed, a decoder whose share changes by more than one thread
+ * and a quarter of its threads is reopened at its next keyframe, after the share is not changed
+ * for half a second, and not more often than every 5 seconds.
+ * Defaults to QT_AVPLAYER_DECODER_THREADS or the number of cores, 0 leaves FFmpeg defaults.
+ * See QAVStream::Progress::decoderThreads() for the allocated threads.
+ */
+int QAVPlayer::decoderThreadBudget()
+{
+    return QAVThreadBudget::instance().total();
+}
+
+void QAVPlayer::setDecoderThreadBudget(int threads)
+{
+    QAVThreadBudget::instance().setTotal(threads);
+}
+
+/*!
+ * \brief Counters of the pools of frame buffers used by software decoders of all players.
+ * Buffers are taken from the pools by size, hits are reused buffers and misses are new allocations.
+ */
+QAVPlayer::FrameBufferStats QAVPlayer::frameBufferStats()
+{
+    const auto s = QAVBufferPool::instance().stats();
+    FrameBufferStats ret;
+    ret.hits = s.hits;
+    ret.misses = s.misses;
+    ret.waits = s.waits;
+    ret.failures = s.failures;
+    ret.allocatedBytes = s.allocatedBytes;
+    ret.usedBytes = s.usedBytes;
+    return ret;
+}
+
+/*!
+ * \brief Max bytes of the frame buffers of software decoders of all players, 0 means unlimited.
+ * When the cap is reached, the decoders are not fed with packets until the frames are released,
+ * a frame fails to decode only if its buffer still does not fit to the cap.
+ * Defaults to QT_AVPLAYER_FRAME_BUFFER_CAP.
+ */
+qint64 QAVPlayer::frameBufferCap()
+{
+    return QAVBufferPool::instance().cap();
+}
+
+void QAVPlayer::setFrameBufferCap(qint64 bytes)
+{
+    QAVBufferPool::instance().setCap(bytes);
+}
+
+/*!
+ * \brief Max bytes held by the queues of the player: demuxed packets, decoded and filtered frames
+ * and frames waiting for the muxer. 0 means unlimited, only the queues of packets are limited then.
+ * When the budget or the process one is reached, reading of packets is paused
+ * and other queues are throttled according to memoryPolicy().
+ */
+qint64 QAVPlayer::memoryBudget() const
+{
+    Q_D(const QAVPlayer);
+    return d->memoryBudget.limit();
+}
+
+void QAVPlayer::setMemoryBudget(qint64 bytes)
+{
+    Q_D(QAVPlayer);
+    bytes = qMax<qint64>(0, bytes);
+    const qint64 current = memoryBudget();
+    if (bytes == current)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << current << "->" << bytes;
+    d->memoryBudget.setLimit(bytes);
+    Q_EMIT memoryBudgetChanged(bytes);
+}
+
+/*!
+ * \brief What is throttled when the memory budget is reached.
+ * PauseDemuxer only pauses reading of packets, the queues are drained by own threads.
+ * BlockProducers also blocks the playback until the muxer drains its queue.
+ * DropFrames drops the oldest frames waiting for the muxer, the output file could miss them.
+ */
+QAVPlayer::MemoryPolicy QAVPlayer::memoryPolicy() const
+{
+    Q_D(const QAVPlayer);
+    return MemoryPolicy(d->memoryBudget.policy());
+}
+
+void QAVPlayer::setMemoryPolicy(MemoryPolicy policy)
+{
+    Q_D(QAVPlayer);
+    const auto current = memoryPolicy();
+    if (policy == current)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << current << "->" << policy;
+    d->memoryBudget.setPolicy(QAVMemoryBudget::Policy(policy));
+    Q_EMIT memoryPolicyChanged(policy);
+}
+
+static QAVPlayer::MemoryUsage toMemoryUsage(const QAVMemoryBudget &budget)
+{
+    QAVPlayer::MemoryUsage ret;
+    ret.packets = budget.usage(QAVMemoryBudget::Packets);
+    ret.decodedFrames = budget.usage(QAVMemoryBudget::DecodedFrames);
+    ret.filteredFrames = budget.usage(QAVMemoryBudget::FilteredFrames);
+    ret.muxerFrames = budget.usage(QAVMemoryBudget::MuxerFrames);
+    ret.audioBuffers = budget.usage(QAVMemoryBudget::AudioBuffers);
+    ret.total = budget.total();
+    return ret;
+}
+
+/*!
+ * \brief Current bytes held by the queues of the player.
+ */
+QAVPlayer::MemoryUsage QAVPlayer::memoryUsage() const
+{
+    Q_D(const QAVPlayer);
+    return toMemoryUsage(d->memoryBudget);
+}
+
+/*!
+ * \brief Targets of buffered packets in seconds of media per stream type.
+ * Reading of packets is paused when the steady targets are buffered,
+ * durations are derived from the measured bitrate if packets have no durations.
+ * The playback starts after the startup targets are buffered. If a queue runs out of packets
+ * while playing, bufferUnderrun() is emitted and the playback waits for the startup targets again.
+ * Zero startup targets disable rebuffering, the playback continues as soon as packets arrive.
+ */
+QAVPlayer::BufferingPolicy QAVPlayer::bufferingPolicy() const
+{
+    Q_D(const QAVPlayer);
+    return d->currentBufferingPolicy();
+}
+
+static bool operator==(const QAVPlayer::BufferingPolicy &lhs, const QAVPlayer::BufferingPolicy &rhs)
+{
+    return qFuzzyCompare(lhs.videoStartup + 1, rhs.videoStartup + 1)
+        && qFuzzyCompare(lhs.audioStartup + 1, rhs.audioStartup + 1)
+        && qFuzzyCompare(lhs.videoSteady + 1, rhs.videoSteady + 1)
+        && qFuzzyCompare(lhs.audioSteady + 1, rhs.audioSteady + 1);
+}
+
+void QAVPlayer::setBufferingPolicy(const BufferingPolicy &policy)
+{
+    Q_D(QAVPlayer);
+    BufferingPolicy p = policy;
+    p.videoStartup = qMax(0.0, p.videoStartup);
+    p.audioStartup = qMax(0.0, p.audioStartup);
+    p.videoSteady = qMax(0.0, p.videoSteady);
+    p.audioSteady = qMax(0.0, p.audioSteady);
+    {
+        QAVMutexLocker locker(&d->bufferingMutex);
+        if (d->bufferingPolicy == p)
+            return;
+
+        qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->bufferingPolicy << "->" << p;
+        d->bufferingPolicy = p;
+    }
+    Q_EMIT bufferingPolicyChanged(p);
+}
+
+/*!
+ * \brief The playback waits for the startup targets of bufferingPolicy().
+ */
+bool QAVPlayer::isBuffering() const
+{
+    Q_D(const QAVPlayer);
+    return d->isBuffering();
+}
+
+/*!
+ * \brief Msecs after which a paused or stopped player is hibernated, 0 disables it (default).
+ */
+int QAVPlayer::hibernateTimeout() const
+{
+    Q_D(const QAVPlayer);
+    return d->hibernateTimeout;
+}
+
+void QAVPlayer::setHibernateTimeout(int msecs)
+{
+    Q_D(QAVPlayer);
+    msecs = qMax(0, msecs);
+    if (d->hibernateTimeout == msecs)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << d->hibernateTimeout << "->" << msecs;
+    d->hibernateTimeout = msecs;
+    d->scheduleHibernation();
+    Q_EMIT hibernateTimeoutChanged(msecs);
+}
+
+/*!
+ * \brief Hibernated player has released threads, packet queues, decoded frames, filters and decoders.
+ * Any of play(), pause(), stop(), seek(), stepForward(), stepBackward(), setVariant() or stream setters
+ * reopens the media and seeks to the same frame. Until the media is reopened, the available and current
+ * streams are empty, variants() and currentVariant() are kept, and the selected streams and variant
+ * are applied after reopening.
+ * Players with an output are never hibernated.
+ */
+bool QAVPlayer::isHibernated() const
+{
+    Q_D(const QAVPlayer);
+    return d->hibernated;
+}
+
+/*!
+ * \brief Hibernates the paused or stopped player immediately, f.e. if it is hidden.
+ */
+void QAVPlayer::hibernate()
+{
+    Q_D(QAVPlayer);
+    d->hibernate();
+}
+
+/*!
+ * \brief Max bytes held by all players and QAVAudioOutput buffers,
+ * defaults to QT_AVPLAYER_MEMORY_BUDGET or 0 that means unlimited.
+ * The policy is used by QAVAudioOutput, players use own policies.
+ */
+qint64 QAVPlayer::processMemoryBudget()
+{
+    return QAVMemoryBudget::process().limit();
+}
+
+void QAVPlayer::setProcessMemoryBudget(qint64 bytes)
+{
+    QAVMemoryBudget::process().setLimit(bytes);
+}
+
+QAVPlayer::MemoryPolicy QAVPlayer::processMemoryPolicy()
+{
+    return MemoryPolicy(QAVMemoryBudget::process().policy());
+}
+
+void QAVPlayer::setProcessMemoryPolicy(MemoryPolicy policy)
+{
+    QAVMemoryBudget::process().setPolicy(QAVMemoryBudget::Policy(policy));
+}
+
+QAVPlayer::MemoryUsage QAVPlayer::processMemoryUsage()
+{
+    return toMemoryUsage(QAVMemoryBudget::process());
+}
+
+/*!
+ * \brief Live allocations of packets, frames and their wrappers by subsystem and stream.
+ * Empty unless built with QT_AVPLAYER_PROFILE_ALLOCS, then the report is also printed
+ * every QT_AVPLAYER_ALLOCS_INTERVAL msecs and on exit.
+ */
+QList<QAVPlayer::Allocation> QAVPlayer::allocations()
+{
+    QList<Allocation> ret;
+    for (const auto &e : QAVAllocations::instance().snapshot()) {
+        Allocation a;
+        a.subsystem = QAVAllocations::name(e.subsystem);
+        a.stream = e.stream;
+        a.bytes = e.bytes;
+        a.count = e.count;
+        a.peakBytes = e.peakBytes;
+        a.allocations = e.allocations;
+        ret.push_back(a);
+    }
+    return ret;
+}
+
+/*!
+ * \brief Video decoders export motion vectors and quantizers, see QAVVideoFrame::motionVectors().
+ * Sent video frames contain only the side data without the image, so QAVFrame::operator bool() is false.
+ * Hardware decoding and the loop filter are disabled. Applied on next load.
+ */
+bool QAVPlayer::videoSideDataOnly() const
+{
+    Q_D(const QAVPlayer);
+    return d->demuxer.videoSideDataOnly();
+}
+
+void QAVPlayer::setVideoSideDataOnly(bool enabled)
+{
+    Q_D(QAVPlayer);
+    const bool current = videoSideDataOnly();
+    if (enabled == current)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << current << "->" << enabled;
+    d->demuxer.setVideoSideDataOnly(enabled);
+    Q_EMIT videoSideDataOnlyChanged(enabled);
+}
+
+/*!
+ * \brief Variants of adaptive streams, e.g. HLS, each variant is a program of the input.
+ * For DASH each video representation is a variant, other representations are shared.
+ * Streams of not used variants are discarded and not downloaded,
+ * selecting a stream of another variant switches to that variant.
+ */
+QList<QAVPlayer::Variant> QAVPlayer::variants() const
+{
+    Q_D(const QAVPlayer);
+    {
+        QAVMutexLocker locker(&d->hibernateMutex);
+        if (d->hibernated || d->restoring)
+            return d->hibernatedVariants;
+    }
+    return d->variants();
+}
+
+int QAVPlayer::currentVariant() const
+{
+    Q_D(const QAVPlayer);
+    {
+        QAVMutexLocker locker(&d->hibernateMutex);
+        if (d->hibernated || d->restoring)
+            return d->hibernatedVariant;
+    }
+    return d->demuxer.currentVariant();
+}
+
+/*!
+ * \brief Switches to the variant by index in variants() without reloading the source.
+ * The demuxer starts to read the new streams from the next segment.
+ */
+void QAVPlayer::setVariant(int index)
+{
+    Q_D(QAVPlayer);
+    const int current = currentVariant();
+    if (index == current)
+        return;
+
+    if (d->selectHibernatedVariant(index))
+        return;
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << current << "->" << index;
+    if (!d->demuxer.setVariant(index))
+        return;
+    Q_EMIT variantChanged(index);
+    Q_EMIT videoStreamsChanged(d->demuxer.currentVideoStreams());
+    Q_EMIT audioStreamsChanged(d->demuxer.currentAudioStreams());
+    Q_EMIT subtitleStreamsChanged(d->demuxer.currentSubtitleStreams());
+}
+
+/*!
+ * \brief Limits the bandwidth of the variant selected on load, 0 means no limit.
+ * The variant with highest bandwidth within the limits is used, or the lowest one if none fits.
+ */
+qint64 QAVPlayer::maxBandwidth() const
+{
+    Q_D(const QAVPlayer);
+    return d->demuxer.maxBandwidth();
+}
+
+void QAVPlayer::setMaxBandwidth(qint64 bandwidth)
+{
+    Q_D(QAVPlayer);
+    const qint64 current = maxBandwidth();
+    if (bandwidth == current)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << current << "->" << bandwidth;
+    d->demuxer.setMaxBandwidth(bandwidth);
+    Q_EMIT maxBandwidthChanged(bandwidth);
+}
+
+/*!
+ * \brief Limits the resolution of the variant selected on load, invalid size means no limit.
+ */
+QSize QAVPlayer::maxResolution() const
+{
+    Q_D(const QAVPlayer);
+    return d->demuxer.maxResolution();
+}
+
+void QAVPlayer::setMaxResolution(const QSize &size)
+{
+    Q_D(QAVPlayer);
+    const QSize current = maxResolution();
+    if (size == current)
+        return;
+
+    qCDebug(lcAVPlayer) << __FUNCTION__ << ":" << current << "->" << size;
+    d->demuxer.setMaxResolution(size);
+    Q_EMIT maxResolutionChanged(size);
+}
+
 /*!
  * \brief Use to set log level of FFmpeg backend
  * \param[in] level
@@ -1406,6 +2641,19 @@ QAVStream::Progress QAVPlayer::progress(const QAVStream &s) const
     return d_func()->demuxer.progress(s);
 }
 
+QAVPlayer::LoadTimings QAVPlayer::loadTimings() const
+{
+    Q_D(const QAVPlayer);
+    const auto demuxerTimings = d->demuxer.timings();
+    QMutexLocker locker(&d->timingsMutex);
+    LoadTimings t = d->timings;
+    t.openInput = demuxerTimings.openInput;
+    t.findStreamInfo = demuxerTimings.findStreamInfo;
+    t.codecOpen = demuxerTimings.codecOpen;
+    t.hwDeviceCreate = demuxerTimings.hwDeviceCreate;
+    return t;
+}
+
 #ifndef QT_NO_DEBUG_STREAM
 QDebug operator<<(QDebug dbg, QAVPlayer::State state)
 {
@@ -1480,6 +2728,49 @@ QDebug operator<<(QDebug dbg, QAVPlayer::Error err)
             return dbg << QString(QLatin1String("UserType(%1)" )).arg(int(err)).toLatin1().constData();
     }
 }
+
+QDebug operator<<(QDebug dbg, QAVPlayer::MemoryPolicy policy)
+{
+    QDebugStateSaver saver(dbg);
+    dbg.nospace();
+    switch (policy) {
+        case QAVPlayer::PauseDemuxer:
+            return dbg << "PauseDemuxer";
+        case QAVPlayer::BlockProducers:
+            return dbg << "BlockProducers";
+        case QAVPlayer::DropFrames:
+            return dbg << "DropFrames";
+        default:
+            return dbg << QString(QLatin1String("UserType(%1)" )).arg(int(policy)).toLatin1().constData();
+    }
+}
+
+QDebug operator<<(QDebug dbg, const QAVPlayer::BufferingPolicy &p)
+{
+    QDebugStateSaver saver(dbg);
+    dbg.nospace();
+    dbg << "BufferingPolicy(video startup " << p.videoStartup
+        << " s, steady " << p.videoSteady
+        << " s, audio startup " << p.audioStartup
+        << " s, steady " << p.audioSteady << " s)";
+    return dbg;
+}
+
+QDebug operator<<(QDebug dbg, const QAVPlayer::LoadTimings &t)
+{
+    QDebugStateSaver saver(dbg);
+    dbg.nospace();
+    dbg << "LoadTimings(open input " << t.openInput
+        << " us, find stream info " << t.findStreamInfo
+        << " us, codec open " << t.codecOpen
+        << " us, hw device " << t.hwDeviceCreate
+        << " us, filters " << t.createFilters
+        << " us, muxer " << t.openMuxer
+        << " us, first packet " << t.firstPacket
+        << " us, first decoded frame " << t.firstDecodedFrame
+        << " us, first frame " << t.firstFrame << " us)";
+    return dbg;
+}
 #endif
 
 Q_DECLARE_METATYPE(PendingMediaStatus)
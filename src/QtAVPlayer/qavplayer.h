@@ -14,6 +14,7 @@
 #include <QtAVPlayer/qavstream.h>
 #include <QtAVPlayer/qtavplayerglobal.h>
 #include <QString>
+#include <QSize>
 #include <memory>
 
 QT_BEGIN_NAMESPACE
@@ -27,6 +28,7 @@ class QAVPlayer : public QObject
     Q_ENUMS(State)
     Q_ENUMS(MediaStatus)
     Q_ENUMS(Error)
+    Q_ENUMS(MemoryPolicy)
 
 public:
     enum State
@@ -51,6 +53,14 @@ public:
         FilterError
     };
 
+    // What is throttled first when the memory budget is reached
+    enum MemoryPolicy
+    {
+        PauseDemuxer,
+        BlockProducers,
+        DropFrames
+    };
+
     QAVPlayer(QObject *parent = nullptr);
     ~QAVPlayer();
 
@@ -96,6 +106,9 @@ public:
     bool isSynced() const;
     void setSynced(bool sync);
 
+    bool isPosterFrameEnabled() const;
+    void setPosterFrameEnabled(bool enabled);
+
     QString inputFormat() const;
     void setInputFormat(const QString &format);
 
@@ -103,14 +116,97 @@ public:
     void setInputVideoCodec(const QString &codec);
     static QStringList supportedVideoCodecs();
 
+    bool autoSelectVideoCodec() const;
+    void setAutoSelectVideoCodec(bool enabled);
+
     QMap<QString, QString> inputOptions() const;
     void setInputOptions(const QMap<QString, QString> &opts);
 
     QMap<QString, QString> videoCodecOptions() const;
     void setVideoCodecOptions(const QMap<QString, QString> &opts);
 
+    int intraOnlyDecoders() const;
+    void setIntraOnlyDecoders(int count);
+
+    int decoderPriority() const;
+    void setDecoderPriority(int priority);
+
+    bool videoSideDataOnly() const;
+    void setVideoSideDataOnly(bool enabled);
+
+    // Variants of adaptive streams, e.g. HLS or DASH
+    struct Variant
+    {
+        int id = -1;
+        qint64 bandwidth = 0;
+        QSize resolution;
+        // Stream indexes
+        QList<int> streams;
+    };
+    QList<Variant> variants() const;
+    int currentVariant() const;
+    void setVariant(int index);
+
+    qint64 maxBandwidth() const;
+    void setMaxBandwidth(qint64 bandwidth);
+    QSize maxResolution() const;
+    void setMaxResolution(const QSize &size);
+
     QAVStream::Progress progress(const QAVStream &stream) const;
 
+    // All values are in microseconds, -1 if not measured
+    struct LoadTimings
+    {
+        qint64 openInput = -1;
+        qint64 findStreamInfo = -1;
+        // By stream index
+        QMap<int, qint64> codecOpen;
+        QMap<int, qint64> hwDeviceCreate;
+        qint64 createFilters = -1;
+        qint64 openMuxer = -1;
+        // Elapsed since setSource()
+        qint64 firstPacket = -1;
+        qint64 firstDecodedFrame = -1;
+        qint64 firstFrame = -1;
+    };
+    LoadTimings loadTimings() const;
+
+    // Bytes held by the queues of the pipeline
+    struct MemoryUsage
+    {
+        qint64 packets = 0;
+        qint64 decodedFrames = 0;
+        qint64 filteredFrames = 0;
+        qint64 muxerFrames = 0;
+        // Only accounted by the process, see processMemoryUsage()
+        qint64 audioBuffers = 0;
+        qint64 total = 0;
+    };
+    qint64 memoryBudget() const;
+    void setMemoryBudget(qint64 bytes);
+    MemoryPolicy memoryPolicy() const;
+    void setMemoryPolicy(MemoryPolicy policy);
+    MemoryUsage memoryUsage() const;
+
+    // Seconds of packets buffered per stream type
+    struct BufferingPolicy
+    {
+        // Buffered before the playback starts or resumes after an underrun, 0 disables rebuffering
+        double videoStartup = 0.0;
+        double audioStartup = 0.0;
+        // Reading of packets is paused when buffered
+        double videoSteady = 1.0;
+        double audioSteady = 1.0;
+    };
+    BufferingPolicy bufferingPolicy() const;
+    void setBufferingPolicy(const BufferingPolicy &policy);
+    bool isBuffering() const;
+
+    // Msecs after which a paused or stopped player releases its resources, 0 disables
+    int hibernateTimeout() const;
+    void setHibernateTimeout(int msecs);
+    bool isHibernated() const;
+
 public Q_SLOTS:
     void play();
     void pause();
@@ -119,6 +215,7 @@ public Q_SLOTS:
     void setSpeed(qreal rate);
     void stepForward();
     void stepBackward();
+    void hibernate();
 
 Q_SIGNALS:
     void sourceChanged(const QString &url);
@@ -141,10 +238,26 @@ Q_SIGNALS:
     void filtersChanged(const QList<QString> &filters);
     void bitstreamFilterChanged(const QString &desc);
     void syncedChanged(bool sync);
+    void posterFrameEnabledChanged(bool enabled);
+    void loadTimingsChanged(const QAVPlayer::LoadTimings &timings);
     void inputFormatChanged(const QString &format);
     void inputVideoCodecChanged(const QString &codec);
+    void autoSelectVideoCodecChanged(bool enabled);
     void inputOptionsChanged(const QMap<QString, QString> &opts);
     void videoCodecOptionsChanged(const QMap<QString, QString> &opts);
+    void intraOnlyDecodersChanged(int count);
+    void decoderPriorityChanged(int priority);
+    void videoSideDataOnlyChanged(bool enabled);
+    void variantChanged(int index);
+    void maxBandwidthChanged(qint64 bandwidth);
+    void maxResolutionChanged(const QSize &size);
+    void memoryBudgetChanged(qint64 bytes);
+    void memoryPolicyChanged(QAVPlayer::MemoryPolicy policy);
+    void bufferingPolicyChanged(const QAVPlayer::BufferingPolicy &policy);
+    void bufferingChanged(bool buffering);
+    void bufferUnderrun(const QAVStream &stream);
+    void hibernateTimeoutChanged(int msecs);
+    void hibernatedChanged(bool hibernated);
 
     void videoFrame(const QAVVideoFrame &frame);
     void audioFrame(const QAVAudioFrame &frame);
@@ -152,7 +265,44 @@ Q_SIGNALS:
 
 public:
     static void setLogsLevelBackend(int level);
-    
+    static int decoderThreadBudget();
+    static void setDecoderThreadBudget(int threads);
+
+    // Frame buffers of software decoders shared by all players
+    struct FrameBufferStats
+    {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 waits = 0;
+        qint64 failures = 0;
+        qint64 allocatedBytes = 0;
+        qint64 usedBytes = 0;
+    };
+    static FrameBufferStats frameBufferStats();
+    static qint64 frameBufferCap();
+    static void setFrameBufferCap(qint64 bytes);
+
+    // Budget of all players and audio outputs
+    static qint64 processMemoryBudget();
+    static void setProcessMemoryBudget(qint64 bytes);
+    static MemoryPolicy processMemoryPolicy();
+    static void setProcessMemoryPolicy(MemoryPolicy policy);
+    static MemoryUsage processMemoryUsage();
+
+    // Attributed to demuxer, decoder, filters, converters, muxer, audio output or wrappers
+    struct Allocation
+    {
+        QString subsystem;
+        // -1 if not related to a stream
+        int stream = -1;
+        qint64 bytes = 0;
+        qint64 count = 0;
+        qint64 peakBytes = 0;
+        // Since start
+        qint64 allocations = 0;
+    };
+    static QList<Allocation> allocations();
+
 protected:
     std::unique_ptr<QAVPlayerPrivate> d_ptr;
 
@@ -165,11 +315,17 @@ private:
 QDebug operator<<(QDebug, QAVPlayer::State);
 QDebug operator<<(QDebug, QAVPlayer::MediaStatus);
 QDebug operator<<(QDebug, QAVPlayer::Error);
+QDebug operator<<(QDebug, QAVPlayer::MemoryPolicy);
+QDebug operator<<(QDebug, const QAVPlayer::LoadTimings &);
+QDebug operator<<(QDebug, const QAVPlayer::BufferingPolicy &);
 #endif
 
 Q_DECLARE_METATYPE(QAVPlayer::State)
 Q_DECLARE_METATYPE(QAVPlayer::MediaStatus)
 Q_DECLARE_METATYPE(QAVPlayer::Error)
+Q_DECLARE_METATYPE(QAVPlayer::MemoryPolicy)
+Q_DECLARE_METATYPE(QAVPlayer::LoadTimings)
+Q_DECLARE_METATYPE(QAVPlayer::BufferingPolicy)
 
 QT_END_NAMESPACE
 
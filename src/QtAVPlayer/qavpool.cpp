@@ -0,0 +1,186 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavpool_p.h"
+#include "qavallocations_p.h"
+#include <new>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+// Enough for queued packets and decoded frames of a few players,
+// the rest is returned to the heap
+static const int maxBlocks = 4096;
+static const size_t maxShells = 2048;
+
+QAVPool::QAVPool()
+{
+    m_frames.reserve(maxShells);
+    m_packets.reserve(maxShells);
+}
+
+QAVPool &QAVPool::instance()
+{
+    // Never destroyed, frames could be released after static destructors
+    static QAVPool *pool = new QAVPool;
+    return *pool;
+}
+
+void *QAVPool::allocate(size_t size)
+{
+    QAVAllocations::instance().add(QAVAllocations::Wrappers, -1, qint64(size));
+    if (size == 0 || size > maxBlockSize) {
+        QMutexLocker locker(&m_mutex);
+        ++m_stats.heapAllocations;
+        locker.unlock();
+        return ::operator new(size);
+    }
+
+    const size_t index = (size - 1) / blockAlign;
+    QMutexLocker locker(&m_mutex);
+    if (auto block = m_blocks[index]) {
+        m_blocks[index] = block->next;
+        --m_blockCounts[index];
+        --m_stats.pooled;
+        ++m_stats.reused;
+        return block;
+    }
+    ++m_stats.heapAllocations;
+    locker.unlock();
+    // All blocks of the size class are interchangeable
+    return ::operator new((index + 1) * blockAlign);
+}
+
+void QAVPool::deallocate(void *p, size_t size)
+{
+    if (!p)
+        return;
+    QAVAllocations::instance().release(QAVAllocations::Wrappers, -1, qint64(size));
+    if (size == 0 || size > maxBlockSize) {
+        ::operator delete(p);
+        return;
+    }
+
+    const size_t index = (size - 1) / blockAlign;
+    QMutexLocker locker(&m_mutex);
+    if (m_blockCounts[index] >= maxBlocks) {
+        locker.unlock();
+        ::operator delete(p);
+        return;
+    }
+    auto block = new (p) Block;
+    block->next = m_blocks[index];
+    m_blocks[index] = block;
+    ++m_blockCounts[index];
+    ++m_stats.pooled;
+}
+
+AVFrame *QAVPool::frame()
+{
+    QAVAllocations::instance().add(QAVAllocations::Wrappers, -1, qint64(sizeof(AVFrame)));
+    QMutexLocker locker(&m_mutex);
+    if (!m_frames.empty()) {
+        auto frame = m_frames.back();
+        m_frames.pop_back();
+        --m_stats.pooled;
+        ++m_stats.reused;
+        return frame;
+    }
+    ++m_stats.heapAllocations;
+    locker.unlock();
+    return av_frame_alloc();
+}
+
+void QAVPool::release(AVFrame *frame)
+{
+    if (!frame)
+        return;
+    QAVAllocations::instance().release(QAVAllocations::Wrappers, -1, qint64(sizeof(AVFrame)));
+    // Resets all fields to defaults as av_frame_alloc() does
+    av_frame_unref(frame);
+    QMutexLocker locker(&m_mutex);
+    if (m_frames.size() >= maxShells) {
+        locker.unlock();
+        av_frame_free(&frame);
+        return;
+    }
+    m_frames.push_back(frame);
+    ++m_stats.pooled;
+}
+
+AVPacket *QAVPool::packet()
+{
+    QAVAllocations::instance().add(QAVAllocations::Wrappers, -1, qint64(sizeof(AVPacket)));
+    QMutexLocker locker(&m_mutex);
+    if (!m_packets.empty()) {
+        auto packet = m_packets.back();
+        m_packets.pop_back();
+        --m_stats.pooled;
+        ++m_stats.reused;
+        return packet;
+    }
+    ++m_stats.heapAllocations;
+    locker.unlock();
+    return av_packet_alloc();
+}
+
+void QAVPool::release(AVPacket *packet)
+{
+    if (!packet)
+        return;
+    QAVAllocations::instance().release(QAVAllocations::Wrappers, -1, qint64(sizeof(AVPacket)));
+    av_packet_unref(packet);
+    QMutexLocker locker(&m_mutex);
+    if (m_packets.size() >= maxShells) {
+        locker.unlock();
+        av_packet_free(&packet);
+        return;
+    }
+    m_packets.push_back(packet);
+    ++m_stats.pooled;
+}
+
+QAVPool::Stats QAVPool::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+void QAVPool::trim()
+{
+    std::vector<Block *> blocks;
+    std::vector<AVFrame *> frames;
+    std::vector<AVPacket *> packets;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (size_t i = 0; i < sizeClasses; ++i) {
+            for (auto block = m_blocks[i]; block; block = block->next)
+                blocks.push_back(block);
+            m_blocks[i] = nullptr;
+            m_blockCounts[i] = 0;
+        }
+        frames.swap(m_frames);
+        packets.swap(m_packets);
+        m_frames.reserve(maxShells);
+        m_packets.reserve(maxShells);
+        m_stats.pooled = 0;
+    }
+    for (auto block : blocks) {
+        block->~Block();
+        ::operator delete(block);
+    }
+    for (auto frame : frames)
+        av_frame_free(&frame);
+    for (auto packet : packets)
+        av_packet_free(&packet);
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,85 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVPOOL_P_H
+#define QAVPOOL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QMutex>
+#include <vector>
+#include <cstddef>
+
+QT_BEGIN_NAMESPACE
+
+struct AVFrame;
+struct AVPacket;
+
+// Process-wide free lists recycling the wrappers of packets and frames,
+// objects released by one thread are reused by another one
+class QAVPool
+{
+public:
+    static QAVPool &instance();
+
+    // Memory of the private objects, blocks of the same size class are reused
+    void *allocate(size_t size);
+    void deallocate(void *p, size_t size);
+
+    // Empty shells, the data is unreferenced on release
+    AVFrame *frame();
+    void release(AVFrame *frame);
+    AVPacket *packet();
+    void release(AVPacket *packet);
+
+    struct Stats
+    {
+        // Objects allocated on the heap since the pool could not reuse any
+        qint64 heapAllocations = 0;
+        qint64 reused = 0;
+        // Objects kept in the free lists
+        qint64 pooled = 0;
+    };
+    Stats stats() const;
+
+    // Frees the objects kept in the free lists
+    void trim();
+
+private:
+    QAVPool();
+    Q_DISABLE_COPY(QAVPool)
+
+    struct Block
+    {
+        Block *next = nullptr;
+    };
+
+    static const size_t blockAlign = 16;
+    static const size_t maxBlockSize = 512;
+    static const size_t sizeClasses = maxBlockSize / blockAlign;
+
+    mutable QMutex m_mutex;
+    Block *m_blocks[sizeClasses] = {};
+    int m_blockCounts[sizeClasses] = {};
+    std::vector<AVFrame *> m_frames;
+    std::vector<AVPacket *> m_packets;
+    Stats m_stats;
+};
+
+QT_END_NAMESPACE
+
+#endif
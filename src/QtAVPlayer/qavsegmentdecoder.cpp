@@ -0,0 +1,432 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavsegmentdecoder_p.h"
+#include "qavdemuxer_p.h"
+#include "qavmuxer_p.h"
+#include "qavfilters_p.h"
+#include <QThreadPool>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtConcurrent/qtconcurrentrun.h>
+#include <QtNumeric>
+#include <atomic>
+#include <vector>
+#include <math.h>
+#include <QDebug>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+struct QAVSegmentQueue
+{
+    QList<QAVFrame> frames;
+    bool finished = false;
+};
+
+struct QAVSegment
+{
+    double start = 0;
+    double end = 0;
+    QAVSegmentQueue queue;
+};
+
+} // namespace
+
+class QAVSegmentDecoderPrivate
+{
+public:
+    int loadDemuxer(QAVDemuxer &d, AVMediaType type) const;
+    double keyframeAt(double sec);
+    void decodeSegments();
+    int decodeSegment(QAVSegment &segment);
+    int decodeAudio();
+    void push(QAVSegmentQueue &queue, const QList<QAVFrame> &frames);
+    void finish(QAVSegmentQueue &queue, int ret);
+
+    QString url;
+    QAVDemuxer demuxer;
+    QList<QString> filterDescs;
+    int threadCount = QThread::idealThreadCount();
+    std::vector<QAVSegment> segments;
+    QAVSegmentQueue audio;
+    QThreadPool threadPool;
+
+    mutable QMutex mutex;
+    QWaitCondition produced;
+    QWaitCondition consumed;
+    std::atomic_int nextSegment = 0;
+    std::atomic_bool abortRequest = false;
+    int error = 0;
+    // Max frames decoded ahead per segment
+    const int queueSize = 16;
+};
+
+QAVSegmentDecoder::QAVSegmentDecoder()
+    : d_ptr(new QAVSegmentDecoderPrivate)
+{
+}
+
+QAVSegmentDecoder::~QAVSegmentDecoder()
+{
+    abort();
+    unload();
+}
+
+int QAVSegmentDecoderPrivate::loadDemuxer(QAVDemuxer &d, AVMediaType type) const
+{
+    // Segments are decoded in parallel already
+    d.setVideoCodecOptions({{"threads", "1"}});
+    int ret = d.load(url);
+    if (ret < 0)
+        return ret;
+
+    // Only needed packets are read
+    const auto videoStreams = d.currentVideoStreams();
+    const auto audioStreams = d.currentAudioStreams();
+    const int index = type == AVMEDIA_TYPE_VIDEO
+        ? (!videoStreams.isEmpty() ? videoStreams.first().index() : -1)
+        : (!audioStreams.isEmpty() ? audioStreams.first().index() : -1);
+    auto ctx = d.avctx();
+    for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+        if (int(i) != index)
+            ctx->streams[i]->discard = AVDISCARD_ALL;
+    }
+    return 0;
+}
+
+int QAVSegmentDecoder::load(const QString &url)
+{
+    Q_D(QAVSegmentDecoder);
+    unload();
+    d->url = url;
+    int ret = d->demuxer.load(url);
+    if (ret < 0)
+        return ret;
+
+    const auto videoStreams = d->demuxer.currentVideoStreams();
+    const double duration = d->demuxer.duration();
+    d->segments.push_back({ -qInf(), qInf(), {} });
+    if (videoStreams.isEmpty() || !d->demuxer.seekable() || duration <= 0)
+        return 0;
+
+    // More segments than threads to keep all of them busy
+    const int count = d->threadCount * 4;
+    for (int i = 1; i < count; ++i) {
+        const double pos = d->keyframeAt(duration * i / count);
+        if (!isnan(pos) && pos > d->segments.back().start) {
+            d->segments.back().end = pos;
+            d->segments.push_back({ pos, qInf(), {} });
+        }
+    }
+
+    qDebug() << "Loaded" << url << "segments:" << d->segments.size();
+    return 0;
+}
+
+// Uses the index of the demuxer to find the keyframe before the position
+double QAVSegmentDecoderPrivate::keyframeAt(double sec)
+{
+    const auto stream = demuxer.currentVideoStreams().first();
+    if (demuxer.seek(sec) < 0)
+        return NAN;
+
+    const int maxPackets = 1024;
+    for (int i = 0; i < maxPackets; ++i) {
+        const auto pkt = demuxer.read();
+        if (!pkt)
+            break;
+        if (pkt.packet()->stream_index != stream.index())
+            continue;
+        if (!(pkt.packet()->flags & AV_PKT_FLAG_KEY) || pkt.packet()->pts == AV_NOPTS_VALUE)
+            break;
+        return pkt.pts();
+    }
+    return NAN;
+}
+
+void QAVSegmentDecoder::unload()
+{
+    Q_D(QAVSegmentDecoder);
+    d->threadPool.waitForDone();
+    d->demuxer.unload();
+    d->segments.clear();
+    d->audio = {};
+    d->nextSegment = 0;
+    d->abortRequest = false;
+    d->error = 0;
+}
+
+int QAVSegmentDecoder::threadCount() const
+{
+    return d_func()->threadCount;
+}
+
+void QAVSegmentDecoder::setThreadCount(int count)
+{
+    d_func()->threadCount = qMax(1, count);
+}
+
+QList<QString> QAVSegmentDecoder::filters() const
+{
+    return d_func()->filterDescs;
+}
+
+void QAVSegmentDecoder::setFilters(const QList<QString> &filters)
+{
+    d_func()->filterDescs = filters;
+}
+
+QList<double> QAVSegmentDecoder::segments() const
+{
+    Q_D(const QAVSegmentDecoder);
+    QList<double> ret;
+    for (const auto &segment : d->segments)
+        ret.push_back(isinf(segment.start) ? 0.0 : segment.start);
+    return ret;
+}
+
+QList<QAVStream> QAVSegmentDecoder::availableStreams() const
+{
+    return d_func()->demuxer.availableStreams();
+}
+
+void QAVSegmentDecoderPrivate::push(QAVSegmentQueue &queue, const QList<QAVFrame> &frames)
+{
+    QMutexLocker locker(&mutex);
+    while (queue.frames.size() >= queueSize && !abortRequest)
+        consumed.wait(&mutex);
+    queue.frames += frames;
+    produced.wakeAll();
+}
+
+void QAVSegmentDecoderPrivate::finish(QAVSegmentQueue &queue, int ret)
+{
+    QMutexLocker locker(&mutex);
+    queue.finished = true;
+    if (ret < 0 && error >= 0) {
+        error = ret;
+        abortRequest = true;
+        consumed.wakeAll();
+    }
+    produced.wakeAll();
+}
+
+static int filter(QAVFilters &filters, bool &created, const QList<QString> &filterDescs,
+                  const QAVDemuxer &demuxer, AVMediaType type, const QAVFrame &frame,
+                  QList<QAVFrame> &filteredFrames)
+{
+    int ret = 0;
+    QList<QAVFrame> frames;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!created) {
+            ret = filters.createFilters(filterDescs, frame, demuxer);
+            if (ret < 0)
+                return ret;
+            created = true;
+        }
+        frames.clear();
+        ret = filters.write(type, frame);
+        if (ret >= 0 || ret == AVERROR(EAGAIN))
+            ret = filters.read(type, frame, frames);
+        // The format of the frame is changed, the filters are recreated
+        if (ret != AVERROR(ENOTSUP))
+            break;
+        created = false;
+    }
+    filteredFrames += frames;
+    return ret == AVERROR(EAGAIN) ? 0 : ret;
+}
+
+// Takes the next segment when the previous one is done
+void QAVSegmentDecoderPrivate::decodeSegments()
+{
+    int i = 0;
+    while (!abortRequest && (i = nextSegment++) < int(segments.size()))
+        finish(segments[i].queue, decodeSegment(segments[i]));
+}
+
+int QAVSegmentDecoderPrivate::decodeSegment(QAVSegment &segment)
+{
+    QAVDemuxer d;
+    int ret = loadDemuxer(d, AVMEDIA_TYPE_VIDEO);
+    if (ret < 0)
+        return ret;
+    const auto streams = d.currentVideoStreams();
+    if (streams.isEmpty())
+        return 0;
+    const auto stream = streams.first();
+    if (!isinf(segment.start) && (ret = d.seek(segment.start)) < 0)
+        return ret;
+
+    QAVFilters filters;
+    bool created = false;
+    bool done = false;
+    while (!done && !abortRequest) {
+        auto pkt = d.read();
+        if (pkt && pkt.packet()->stream_index != stream.index())
+            continue;
+        QList<QAVFrame> frames;
+        if (!pkt) {
+            // Flushes the decoder
+            pkt.setStream(stream);
+            done = true;
+        }
+        d.decode(pkt, frames);
+
+        QList<QAVFrame> filteredFrames;
+        for (const auto &frame : frames) {
+            // Frames before the keyframe belong to the previous segment,
+            // the decoder returns frames in pts order, so the segment is over on first frame after the end
+            const double pts = frame.pts();
+            if (pts < segment.start)
+                continue;
+            if (pts >= segment.end) {
+                done = true;
+                break;
+            }
+            ret = filter(filters, created, filterDescs, d, AVMEDIA_TYPE_VIDEO, frame, filteredFrames);
+            if (ret < 0)
+                return ret;
+        }
+        if (!filteredFrames.isEmpty())
+            push(segment.queue, filteredFrames);
+    }
+
+    return 0;
+}
+
+int QAVSegmentDecoderPrivate::decodeAudio()
+{
+    QAVDemuxer d;
+    int ret = loadDemuxer(d, AVMEDIA_TYPE_AUDIO);
+    if (ret < 0)
+        return ret;
+    const auto streams = d.currentAudioStreams();
+    if (streams.isEmpty())
+        return 0;
+    const auto stream = streams.first();
+
+    QAVFilters filters;
+    bool created = false;
+    bool done = false;
+    while (!done && !abortRequest) {
+        auto pkt = d.read();
+        if (pkt && pkt.packet()->stream_index != stream.index())
+            continue;
+        QList<QAVFrame> frames;
+        if (!pkt) {
+            pkt.setStream(stream);
+            done = true;
+        }
+        d.decode(pkt, frames);
+
+        QList<QAVFrame> filteredFrames;
+        for (const auto &frame : frames) {
+            ret = filter(filters, created, filterDescs, d, AVMEDIA_TYPE_AUDIO, frame, filteredFrames);
+            if (ret < 0)
+                return ret;
+        }
+        if (!filteredFrames.isEmpty())
+            push(audio, filteredFrames);
+    }
+
+    return 0;
+}
+
+int QAVSegmentDecoder::run(const std::function<void(const QAVFrame &frame)> &sink)
+{
+    Q_D(QAVSegmentDecoder);
+    if (d->segments.empty())
+        return AVERROR(EINVAL);
+
+    const bool hasAudio = !d->demuxer.currentAudioStreams().isEmpty();
+    const int threads = qMin(d->threadCount, int(d->segments.size()));
+    d->threadPool.setMaxThreadCount(threads + (hasAudio ? 1 : 0));
+    d->audio.finished = !hasAudio;
+    QList<QFuture<void>> futures;
+    if (hasAudio) {
+        futures.push_back(QtConcurrent::run(&d->threadPool, [d] {
+            d->finish(d->audio, d->decodeAudio());
+        }));
+    }
+    for (int i = 0; i < threads; ++i)
+        futures.push_back(QtConcurrent::run(&d->threadPool, [d] { d->decodeSegments(); }));
+
+    // Segments are consumed one by one, audio frames are merged by pts
+    size_t segment = 0;
+    QMutexLocker locker(&d->mutex);
+    while (!d->abortRequest) {
+        while (segment < d->segments.size()
+               && d->segments[segment].queue.finished
+               && d->segments[segment].queue.frames.isEmpty())
+        {
+            ++segment;
+        }
+        auto video = segment < d->segments.size() ? &d->segments[segment].queue : nullptr;
+        const bool videoReady = !video || !video->frames.isEmpty();
+        const bool audioReady = d->audio.finished || !d->audio.frames.isEmpty();
+        if (!videoReady || !audioReady) {
+            d->produced.wait(&d->mutex);
+            continue;
+        }
+
+        QAVSegmentQueue *queue = nullptr;
+        if (video && !d->audio.frames.isEmpty())
+            queue = d->audio.frames.first().pts() < video->frames.first().pts() ? &d->audio : video;
+        else if (video)
+            queue = video;
+        else if (!d->audio.frames.isEmpty())
+            queue = &d->audio;
+        else
+            break;
+
+        const auto frame = queue->frames.takeFirst();
+        d->consumed.wakeAll();
+        locker.unlock();
+        sink(frame);
+        locker.relock();
+    }
+
+    const int ret = d->error;
+    locker.unlock();
+    abort();
+    for (auto &future : futures)
+        future.waitForFinished();
+    return ret;
+}
+
+int QAVSegmentDecoder::run(QAVMuxer &muxer)
+{
+    int ret = 0;
+    int err = run([&](const QAVFrame &frame) {
+        if (ret >= 0 && (ret = muxer.write(frame)) < 0)
+            abort();
+    });
+    if (err < 0)
+        return err;
+    if (ret < 0)
+        return ret;
+    return muxer.flush();
+}
+
+void QAVSegmentDecoder::abort()
+{
+    Q_D(QAVSegmentDecoder);
+    QMutexLocker locker(&d->mutex);
+    d->abortRequest = true;
+    d->produced.wakeAll();
+    d->consumed.wakeAll();
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,74 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVSEGMENTDECODER_P_H
+#define QAVSEGMENTDECODER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include "qavframe.h"
+#include "qavstream.h"
+#include <functional>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+class QAVMuxer;
+class QAVSegmentDecoderPrivate;
+/**
+ * Decodes a file for offline processing:
+ * the video stream is split to keyframe aligned segments,
+ * each one is decoded by own demuxer and filters in parallel,
+ * the audio stream is decoded by another one.
+ * Frames are delivered on the caller thread in pts order.
+ */
+class QAVSegmentDecoder
+{
+public:
+    QAVSegmentDecoder();
+    ~QAVSegmentDecoder();
+
+    // Loads the file and finds the segments
+    int load(const QString &url);
+    void unload();
+
+    int threadCount() const;
+    void setThreadCount(int count);
+
+    QList<QString> filters() const;
+    void setFilters(const QList<QString> &filters);
+
+    // Start positions of the segments in seconds
+    QList<double> segments() const;
+    // Streams to load QAVMuxer with
+    QList<QAVStream> availableStreams() const;
+
+    // Decodes all segments, blocks until the end or abort()
+    int run(const std::function<void(const QAVFrame &frame)> &sink);
+    // Writes all frames to the muxer loaded with availableStreams()
+    int run(QAVMuxer &muxer);
+    void abort();
+
+private:
+    Q_DISABLE_COPY(QAVSegmentDecoder)
+    Q_DECLARE_PRIVATE(QAVSegmentDecoder)
+    std::unique_ptr<QAVSegmentDecoderPrivate> d_ptr;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -19,30 +19,39 @@ extern "C" {
 
 QT_BEGIN_NAMESPACE
 
-class QAVStreamPrivate
+class QAVStreamPrivate : public QSharedData
 {
-    Q_DECLARE_PUBLIC(QAVStream)
 public:
-    QAVStreamPrivate(QAVStream *q) : q_ptr(q) { }
-
-    QAVStream *q_ptr = nullptr;
     int index = -1;
     AVFormatContext *ctx = nullptr;
     QSharedPointer<QAVCodec> codec;
     QMap<QString, QString> metadata;
 };
 
+// Default constructed streams share the same private without allocations
+static QExplicitlySharedDataPointer<QAVStreamPrivate> shared_null()
+{
+    static const QExplicitlySharedDataPointer<QAVStreamPrivate> null(new QAVStreamPrivate);
+    return null;
+}
+
+static QMap<QString, QString> streamMetadata(const AVStream *stream);
+
 QAVStream::QAVStream()
-    : d_ptr(new QAVStreamPrivate(this))
+    : d_ptr(shared_null())
 {
 }
 
 QAVStream::QAVStream(int index, AVFormatContext *ctx, const QSharedPointer<QAVCodec> &codec)
-    : QAVStream()
+    : d_ptr(new QAVStreamPrivate)
 {
     d_ptr->index = index;
     d_ptr->ctx = ctx;
     d_ptr->codec = codec;
+    // Filled once since the private is shared between copies
+    auto s = ctx ? stream() : nullptr;
+    if (s)
+        d_ptr->metadata = streamMetadata(s);
 }
 
 QAVStream::~QAVStream()
@@ -50,16 +59,25 @@ QAVStream::~QAVStream()
 }
 
 QAVStream::QAVStream(const QAVStream &other)
-    : QAVStream()
+    : d_ptr(other.d_ptr)
 {
-    *this = other;
+}
+
+QAVStream::QAVStream(QAVStream &&other) noexcept
+    : d_ptr(shared_null())
+{
+    d_ptr.swap(other.d_ptr);
 }
 
 QAVStream &QAVStream::operator=(const QAVStream &other)
 {
-    d_ptr->index = other.d_ptr->index;
-    d_ptr->ctx = other.d_ptr->ctx;
-    d_ptr->codec = other.d_ptr->codec;
+    d_ptr = other.d_ptr;
+    return *this;
+}
+
+QAVStream &QAVStream::operator=(QAVStream &&other) noexcept
+{
+    d_ptr.swap(other.d_ptr);
     return *this;
 }
 
@@ -117,12 +135,6 @@ static QMap<QString, QString> streamMetadata(const AVStream *stream)
 QMap<QString, QString> QAVStream::metadata() const
 {
     Q_D(const QAVStream);
-    if (!d->metadata.isEmpty())
-        return d->metadata;
-    auto s = stream();
-    if (!s)
-        return {};
-    const_cast<QAVStreamPrivate *>(d)->metadata = streamMetadata(s);
     return d->metadata;
 }
 
@@ -203,6 +215,8 @@ QAVStream::Progress &QAVStream::Progress::operator=(const Progress &other)
     m_expectedFrameRate = other.m_expectedFrameRate;
     m_time = other.m_time;
     m_diffs = other.m_diffs;
+    m_decoderThreads = other.m_decoderThreads;
+    m_frameThreading = other.m_frameThreading;
     return *this;
 }
 
@@ -242,6 +256,22 @@ unsigned QAVStream::Progress::fps() const
     return fr ? static_cast<unsigned>(1 / fr) : 0;
 }
 
+int QAVStream::Progress::decoderThreads() const
+{
+    return m_decoderThreads;
+}
+
+bool QAVStream::Progress::isFrameThreading() const
+{
+    return m_frameThreading;
+}
+
+void QAVStream::Progress::setDecoderThreads(int threads, bool frameThreading)
+{
+    m_decoderThreads = threads;
+    m_frameThreading = frameThreading;
+}
+
 void QAVStream::Progress::onFrameSent(double pts)
 {
     m_pts = pts;
@@ -271,14 +301,16 @@ QDebug operator<<(QDebug dbg, const QAVStream::Progress &p)
 {
     QDebugStateSaver saver(dbg);
     dbg.nospace();
-    return dbg << QString(QLatin1String("Progress(%1/%2 pts, %3/%4 frames, %5/%6 frame rate, %7 fps)"))
+    return dbg << QString(QLatin1String("Progress(%1/%2 pts, %3/%4 frames, %5/%6 frame rate, %7 fps, %8 %9 threads)"))
         .arg(p.pts())
         .arg(p.duration())
         .arg(p.framesCount())
         .arg(p.expectedFramesCount())
         .arg(p.frameRate())
         .arg(p.expectedFrameRate())
-        .arg(p.fps()).toLatin1().constData();
+        .arg(p.fps())
+        .arg(p.decoderThreads())
+        .arg(p.isFrameThreading() ? QLatin1String("frame") : QLatin1String("slice")).toLatin1().constData();
 }
 #endif
 
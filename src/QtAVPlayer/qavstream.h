@@ -11,6 +11,7 @@
 #include <QtAVPlayer/qtavplayerglobal.h>
 #include <QMap>
 #include <QSharedPointer>
+#include <QSharedData>
 #include <memory>
 
 QT_BEGIN_NAMESPACE
@@ -25,8 +26,10 @@ public:
     QAVStream();
     QAVStream(int index, AVFormatContext *ctx = nullptr, const QSharedPointer<QAVCodec> &codec = {});
     QAVStream(const QAVStream &other);
+    QAVStream(QAVStream &&other) noexcept;
     ~QAVStream();
     QAVStream &operator=(const QAVStream &other);
+    QAVStream &operator=(QAVStream &&other) noexcept;
     operator bool() const;
 
     int index() const;
@@ -52,8 +55,12 @@ public:
         double frameRate() const;
         double expectedFrameRate() const;
         unsigned fps() const;
+        // Threads of the decoder, 0 if not known
+        int decoderThreads() const;
+        bool isFrameThreading() const;
 
         void onFrameSent(double pts);
+        void setDecoderThreads(int threads, bool frameThreading);
     private:
         double m_pts = 0.0;
         double m_duration = 0.0;
@@ -62,10 +69,13 @@ public:
         double m_expectedFrameRate = 0.0;
         qint64 m_time = 0;
         qint64 m_diffs = 0;
+        int m_decoderThreads = 0;
+        bool m_frameThreading = false;
     };
 
 private:
-    std::unique_ptr<QAVStreamPrivate> d_ptr;
+    // Implicitly shared, streams are immutable once created
+    QExplicitlySharedDataPointer<QAVStreamPrivate> d_ptr;
     Q_DECLARE_PRIVATE(QAVStream)
 };
 
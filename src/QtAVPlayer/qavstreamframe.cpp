@@ -10,6 +10,7 @@
 #include "qavframe_p.h"
 #include "qavcodec_p.h"
 #include <QDebug>
+#include <utility>
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -28,6 +29,12 @@ QAVStreamFrame::QAVStreamFrame(const QAVStreamFrame &other)
     *this = other;
 }
 
+QAVStreamFrame::QAVStreamFrame(QAVStreamFrame &&other) noexcept
+    : QAVStreamFrame()
+{
+    *this = std::move(other);
+}
+
 QAVStreamFrame::QAVStreamFrame(QAVStreamFramePrivate &d)
     : d_ptr(&d)
 {
@@ -54,10 +61,17 @@ QAVStreamFrame &QAVStreamFrame::operator=(const QAVStreamFrame &other)
     return *this;
 }
 
+QAVStreamFrame &QAVStreamFrame::operator=(QAVStreamFrame &&other) noexcept
+{
+    if (this != &other)
+        d_ptr->stream = std::exchange(other.d_ptr->stream, QAVStream());
+    return *this;
+}
+
 QAVStreamFrame::operator bool() const
 {
     Q_D(const QAVStreamFrame);
-    return d->stream;
+    return d && d->stream;
 }
 
 double QAVStreamFrame::pts() const
@@ -20,8 +20,11 @@ class QAVStreamFrame
 public:
     QAVStreamFrame();
     QAVStreamFrame(const QAVStreamFrame &other);
+    // The moved-from frame is empty
+    QAVStreamFrame(QAVStreamFrame &&other) noexcept;
     ~QAVStreamFrame();
     QAVStreamFrame &operator=(const QAVStreamFrame &other);
+    QAVStreamFrame &operator=(QAVStreamFrame &&other) noexcept;
 
     QAVStream stream() const;
     void setStream(const QAVStream &stream);
@@ -20,6 +20,7 @@
 //
 
 #include "qavstream.h"
+#include "qavpool_p.h"
 #include <cmath>
 
 QT_BEGIN_NAMESPACE
@@ -30,6 +31,10 @@ public:
     QAVStreamFramePrivate() = default;
     virtual ~QAVStreamFramePrivate() = default;
 
+    // Privates of all frame types are recycled
+    static void *operator new(size_t size) { return QAVPool::instance().allocate(size); }
+    static void operator delete(void *p, size_t size) { QAVPool::instance().deallocate(p, size); }
+
     virtual double pts() const { return NAN; }
     virtual double duration() const { return 0.0; }
 
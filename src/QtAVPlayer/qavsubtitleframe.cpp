@@ -44,13 +44,21 @@ QAVSubtitleFrame::~QAVSubtitleFrame()
 }
 
 QAVSubtitleFrame::QAVSubtitleFrame(const QAVSubtitleFrame &other)
-    : QAVSubtitleFrame()
+    : QAVStreamFrame(*new QAVSubtitleFramePrivate)
 {
     operator=(other);
 }
 
+QAVSubtitleFrame::QAVSubtitleFrame(QAVSubtitleFrame &&other) noexcept
+    : QAVSubtitleFrame()
+{
+    *this = std::move(other);
+}
+
 QAVSubtitleFrame &QAVSubtitleFrame::operator=(const QAVSubtitleFrame &other)
 {
+    if (this == &other)
+        return *this;
     Q_D(QAVSubtitleFrame);
     QAVStreamFrame::operator=(other);
     d->subtitle = static_cast<QAVSubtitleFramePrivate *>(other.d_ptr.get())->subtitle;
@@ -58,6 +66,19 @@ QAVSubtitleFrame &QAVSubtitleFrame::operator=(const QAVSubtitleFrame &other)
     return *this;
 }
 
+QAVSubtitleFrame &QAVSubtitleFrame::operator=(QAVSubtitleFrame &&other) noexcept
+{
+    if (this == &other)
+        return *this;
+    Q_D(QAVSubtitleFrame);
+    QAVStreamFrame::operator=(std::move(other));
+    auto rhs = static_cast<QAVSubtitleFramePrivate *>(other.d_ptr.get());
+    d->subtitle.swap(rhs->subtitle);
+    rhs->subtitle.reset();
+
+    return *this;
+}
+
 AVSubtitle *QAVSubtitleFrame::subtitle() const
 {
     Q_D(const QAVSubtitleFrame);
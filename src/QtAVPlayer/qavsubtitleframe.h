@@ -20,7 +20,9 @@ public:
     QAVSubtitleFrame();
     ~QAVSubtitleFrame();
     QAVSubtitleFrame(const QAVSubtitleFrame &other);
+    QAVSubtitleFrame(QAVSubtitleFrame &&other) noexcept;
     QAVSubtitleFrame &operator=(const QAVSubtitleFrame &other);
+    QAVSubtitleFrame &operator=(QAVSubtitleFrame &&other) noexcept;
 
     AVSubtitle *subtitle() const;
 
@@ -0,0 +1,135 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavthreadbudget_p.h"
+#include <QThread>
+#include <QDebug>
+
+QT_BEGIN_NAMESPACE
+
+// More threads do not make frame threading faster
+static const int maxDecoderThreads = 16;
+// Players started or stopped together change the shares several times,
+// the decoders are reopened once the share is not changed for this time
+static const qint64 settleTime = 500;
+// Reopening flushes the pipeline and creates new context, so it is not done often
+static const qint64 minReopenInterval = 5000;
+
+QAVThreadBudget::QAVThreadBudget()
+    : m_total(qEnvironmentVariableIsSet("QT_AVPLAYER_DECODER_THREADS")
+              ? qEnvironmentVariableIntValue("QT_AVPLAYER_DECODER_THREADS")
+              : QThread::idealThreadCount())
+{
+    m_clock.start();
+}
+
+QAVThreadBudget &QAVThreadBudget::instance()
+{
+    static QAVThreadBudget budget;
+    return budget;
+}
+
+int QAVThreadBudget::total() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_total;
+}
+
+void QAVThreadBudget::setTotal(int threads)
+{
+    QMutexLocker locker(&m_mutex);
+    m_total = qMax(0, threads);
+    rebalance();
+}
+
+int QAVThreadBudget::used() const
+{
+    QMutexLocker locker(&m_mutex);
+    int ret = 0;
+    for (const auto &a : m_allocations)
+        ret += a.threads;
+    return ret;
+}
+
+int QAVThreadBudget::decoders() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_allocations.size();
+}
+
+// Shares of the budget by weight, the decoders get their targets when reopened
+void QAVThreadBudget::rebalance()
+{
+    qint64 weights = 0;
+    for (const auto &a : m_allocations)
+        weights += a.weight;
+    // Disabled budget keeps the threads of opened decoders
+    for (auto &a : m_allocations) {
+        const int target = m_total > 0 ? qBound(1, int(qRound64(double(m_total) * a.weight / weights)), maxDecoderThreads) : a.threads;
+        if (target != a.target) {
+            a.target = target;
+            a.targetChanged = m_clock.elapsed();
+        }
+    }
+}
+
+int QAVThreadBudget::acquire(qint64 weight)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_total <= 0)
+        return -1;
+
+    // New decoder is capped by its share, the others give their threads back when reopened
+    const int id = m_nextId++;
+    // Opening is not counted as reopening
+    m_allocations[id] = { qMax<qint64>(1, weight), 0, 0, 0, -minReopenInterval };
+    rebalance();
+    m_allocations[id].threads = m_allocations[id].target;
+    return id;
+}
+
+void QAVThreadBudget::release(int id)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_allocations.remove(id))
+        rebalance();
+}
+
+int QAVThreadBudget::threads(int id) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_allocations.constFind(id);
+    return it != m_allocations.constEnd() ? it->threads : 0;
+}
+
+int QAVThreadBudget::rebalanced(int id) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_allocations.constFind(id);
+    if (it == m_allocations.constEnd() || it->target <= 0)
+        return 0;
+    // Differs by more than one thread and a quarter of the threads
+    const int diff = qAbs(it->target - it->threads);
+    if (diff <= 1 || diff * 4 <= it->threads)
+        return 0;
+    const qint64 now = m_clock.elapsed();
+    if (now - it->targetChanged < settleTime || now - it->reopened < minReopenInterval)
+        return 0;
+    return it->target;
+}
+
+void QAVThreadBudget::setThreads(int id, int threads)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_allocations.find(id);
+    if (it != m_allocations.end()) {
+        it->threads = threads;
+        it->reopened = m_clock.elapsed();
+    }
+}
+
+QT_END_NAMESPACE
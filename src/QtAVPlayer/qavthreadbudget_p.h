@@ -0,0 +1,80 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVTHREADBUDGET_P_H
+#define QAVTHREADBUDGET_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QMutex>
+#include <QMap>
+#include <QElapsedTimer>
+
+QT_BEGIN_NAMESPACE
+
+// Process-wide number of decoder threads shared by all opened decoders,
+// each decoder gets its share by weight and is reopened when the share changes enough
+class QAVThreadBudget
+{
+public:
+    static QAVThreadBudget &instance();
+
+    // 0 disables the budget and FFmpeg picks the threads itself
+    int total() const;
+    void setTotal(int threads);
+
+    // Threads currently given to the decoders
+    int used() const;
+    int decoders() const;
+
+    // Returns an id of the allocation, or -1 if the budget is disabled
+    int acquire(qint64 weight);
+    void release(int id);
+    int threads(int id) const;
+    // Share of the decoder after other decoders were opened or closed,
+    // 0 if the decoder is not reopened yet: the share differs too little, is not settled,
+    // or the decoder was reopened recently
+    int rebalanced(int id) const;
+    // Threads of the reopened decoder
+    void setThreads(int id, int threads);
+
+private:
+    QAVThreadBudget();
+    Q_DISABLE_COPY(QAVThreadBudget)
+
+    void rebalance();
+
+    struct Allocation
+    {
+        qint64 weight = 0;
+        int threads = 0;
+        int target = 0;
+        // Msecs of the clock
+        qint64 targetChanged = 0;
+        qint64 reopened = 0;
+    };
+
+    mutable QMutex m_mutex;
+    QElapsedTimer m_clock;
+    int m_total = 0;
+    int m_nextId = 0;
+    QMap<int, Allocation> m_allocations;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,260 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavthumbnailer.h"
+#include "qavdemuxer_p.h"
+#include "qavcodec_p.h"
+#include <QThreadPool>
+#include <QMutex>
+#include <QtConcurrent/qtconcurrentrun.h>
+#include <atomic>
+#include <vector>
+#include <QDebug>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+struct QAVThumbnailerWorker
+{
+    ~QAVThumbnailerWorker()
+    {
+        sws_freeContext(sws);
+    }
+
+    QString url;
+    QAVDemuxer demuxer;
+    SwsContext *sws = nullptr;
+};
+
+} // namespace
+
+class QAVThumbnailerPrivate
+{
+    Q_DECLARE_PUBLIC(QAVThumbnailer)
+public:
+    QAVThumbnailerPrivate(QAVThumbnailer *q)
+        : q_ptr(q)
+    {
+    }
+
+    std::unique_ptr<QAVThumbnailerWorker> acquire();
+    void release(std::unique_ptr<QAVThumbnailerWorker> worker);
+    QAVVideoFrame decode(QAVThumbnailerWorker &worker, double sec, QAVThumbnailer::Mode mode, int gen) const;
+    QAVVideoFrame scale(QAVThumbnailerWorker &worker, const QAVVideoFrame &frame, const QSize &size, AVPixelFormat format) const;
+    QAVVideoFrame thumbnail(int gen, qint64 pos, const QSize &size, QAVThumbnailer::Mode mode, AVPixelFormat format);
+
+    QAVThumbnailer *q_ptr = nullptr;
+    QString source;
+    QThreadPool threadPool;
+    mutable QMutex mutex;
+    // Loaded demuxers which are not used at the moment
+    std::vector<std::unique_ptr<QAVThumbnailerWorker>> workers;
+    // Requests from previous generations are cancelled
+    std::atomic_int generation = 0;
+};
+
+QAVThumbnailer::QAVThumbnailer(QObject *parent)
+    : QObject(parent)
+    , d_ptr(new QAVThumbnailerPrivate(this))
+{
+    qRegisterMetaType<QAVVideoFrame>();
+    qRegisterMetaType<Mode>();
+}
+
+QAVThumbnailer::~QAVThumbnailer()
+{
+    Q_D(QAVThumbnailer);
+    ++d->generation;
+    d->threadPool.waitForDone();
+}
+
+QString QAVThumbnailer::source() const
+{
+    Q_D(const QAVThumbnailer);
+    QMutexLocker locker(&d->mutex);
+    return d->source;
+}
+
+void QAVThumbnailer::setSource(const QString &url)
+{
+    Q_D(QAVThumbnailer);
+    {
+        QMutexLocker locker(&d->mutex);
+        if (d->source == url)
+            return;
+        d->source = url;
+        d->workers.clear();
+        ++d->generation;
+    }
+    Q_EMIT sourceChanged(url);
+}
+
+int QAVThumbnailer::threadCount() const
+{
+    return d_func()->threadPool.maxThreadCount();
+}
+
+void QAVThumbnailer::setThreadCount(int count)
+{
+    d_func()->threadPool.setMaxThreadCount(qMax(1, count));
+}
+
+QList<QFuture<QAVVideoFrame>> QAVThumbnailer::request(
+    const QList<qint64> &positions,
+    const QSize &size,
+    Mode mode,
+    AVPixelFormat format)
+{
+    Q_D(QAVThumbnailer);
+    const int gen = ++d->generation;
+    QList<QFuture<QAVVideoFrame>> ret;
+    for (const auto pos : positions) {
+        ret.push_back(QtConcurrent::run(&d->threadPool, [d, gen, pos, size, mode, format] {
+            return d->thumbnail(gen, pos, size, mode, format);
+        }));
+    }
+    return ret;
+}
+
+void QAVThumbnailer::cancel()
+{
+    Q_D(QAVThumbnailer);
+    ++d->generation;
+}
+
+std::unique_ptr<QAVThumbnailerWorker> QAVThumbnailerPrivate::acquire()
+{
+    QString url;
+    {
+        QMutexLocker locker(&mutex);
+        if (!workers.empty()) {
+            auto worker = std::move(workers.back());
+            workers.pop_back();
+            return worker;
+        }
+        url = source;
+    }
+
+    std::unique_ptr<QAVThumbnailerWorker> worker(new QAVThumbnailerWorker);
+    worker->url = url;
+    int ret = worker->demuxer.load(url);
+    const auto streams = worker->demuxer.currentVideoStreams();
+    if (ret < 0 || streams.isEmpty()) {
+        qWarning() << "Could not load video:" << url << ret;
+        return {};
+    }
+
+    // Only video packets are read
+    auto ctx = worker->demuxer.avctx();
+    for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+        if (int(i) != streams.first().index())
+            ctx->streams[i]->discard = AVDISCARD_ALL;
+    }
+    return worker;
+}
+
+void QAVThumbnailerPrivate::release(std::unique_ptr<QAVThumbnailerWorker> worker)
+{
+    QMutexLocker locker(&mutex);
+    if (worker && worker->url == source)
+        workers.push_back(std::move(worker));
+}
+
+QAVVideoFrame QAVThumbnailerPrivate::decode(QAVThumbnailerWorker &worker, double sec, QAVThumbnailer::Mode mode, int gen) const
+{
+    auto &demuxer = worker.demuxer;
+    const auto stream = demuxer.currentVideoStreams().first();
+    stream.codec()->avctx()->skip_frame = mode == QAVThumbnailer::KeyFrame ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+    demuxer.flushCodecBuffers();
+    if (demuxer.seek(sec) < 0 && sec > 0)
+        return {};
+
+    QAVFrame result;
+    bool eof = false;
+    while (!eof && gen == generation) {
+        auto pkt = demuxer.read();
+        if (pkt && pkt.packet()->stream_index != stream.index())
+            continue;
+        if (!pkt) {
+            pkt.setStream(stream);
+            eof = true;
+        }
+
+        QList<QAVFrame> frames;
+        demuxer.decode(pkt, frames);
+        for (const auto &frame : frames) {
+            if (mode == QAVThumbnailer::KeyFrame)
+                return frame;
+            // The previous frame is displayed at the position
+            if (result && frame.pts() > sec)
+                return result;
+            result = frame;
+        }
+    }
+
+    return result;
+}
+
+QAVVideoFrame QAVThumbnailerPrivate::scale(QAVThumbnailerWorker &worker, const QAVVideoFrame &frame, const QSize &size, AVPixelFormat format) const
+{
+    auto mapData = frame.map();
+    if (mapData.format == AV_PIX_FMT_NONE) {
+        qWarning() << "Could not map:" << frame.formatName();
+        return {};
+    }
+
+    QSize outSize = frame.size().scaled(size, Qt::KeepAspectRatio);
+    if (outSize.isEmpty())
+        outSize = frame.size();
+    // The context is reused while the source and the size are not changed
+    worker.sws = sws_getCachedContext(worker.sws,
+                                      frame.size().width(), frame.size().height(), mapData.format,
+                                      outSize.width(), outSize.height(), format,
+                                      SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!worker.sws) {
+        qWarning() << "Could not get sws context:" << frame.formatName();
+        return {};
+    }
+
+    QAVVideoFrame result(outSize, format);
+    result.setStream(frame.stream());
+    result.frame()->pts = frame.frame()->pts;
+    sws_scale(worker.sws, mapData.data, mapData.bytesPerLine, 0, frame.size().height(),
+              result.frame()->data, result.frame()->linesize);
+    return result;
+}
+
+QAVVideoFrame QAVThumbnailerPrivate::thumbnail(int gen, qint64 pos, const QSize &size, QAVThumbnailer::Mode mode, AVPixelFormat format)
+{
+    if (gen != generation)
+        return {};
+
+    auto worker = acquire();
+    if (!worker)
+        return {};
+
+    QAVVideoFrame result;
+    QAVVideoFrame frame = decode(*worker, pos / 1000.0, mode, gen);
+    if (frame && gen == generation)
+        result = scale(*worker, frame, size, format);
+    release(std::move(worker));
+
+    if (!result || gen != generation)
+        return {};
+
+    Q_EMIT q_ptr->thumbnailReady(pos, result);
+    return result;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,72 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVTHUMBNAILER_H
+#define QAVTHUMBNAILER_H
+
+#include <QtAVPlayer/qavvideoframe.h>
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QObject>
+#include <QFuture>
+#include <QSize>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+class QAVThumbnailerPrivate;
+/**
+ * Extracts scaled video frames at given positions
+ * using several demuxers in parallel.
+ * The frames refer to the streams of the source,
+ * and should not be used after the source is changed.
+ */
+class QAVThumbnailer : public QObject
+{
+    Q_OBJECT
+public:
+    enum Mode
+    {
+        // Nearest keyframe before the position, only keyframes are decoded
+        KeyFrame,
+        // The frame displayed at the position
+        ExactFrame
+    };
+    Q_ENUM(Mode)
+
+    QAVThumbnailer(QObject *parent = nullptr);
+    ~QAVThumbnailer();
+
+    QString source() const;
+    void setSource(const QString &url);
+
+    int threadCount() const;
+    void setThreadCount(int count);
+
+    // Requests the frames at positions in milliseconds scaled to fit the size,
+    // pending requests are cancelled and return empty frames
+    QList<QFuture<QAVVideoFrame>> request(
+        const QList<qint64> &positions,
+        const QSize &size,
+        Mode mode = KeyFrame,
+        AVPixelFormat format = AV_PIX_FMT_RGB32);
+    void cancel();
+
+Q_SIGNALS:
+    void sourceChanged(const QString &url);
+    void thumbnailReady(qint64 position, const QAVVideoFrame &frame);
+
+private:
+    std::unique_ptr<QAVThumbnailerPrivate> d_ptr;
+    Q_DISABLE_COPY(QAVThumbnailer)
+    Q_DECLARE_PRIVATE(QAVThumbnailer)
+};
+
+Q_DECLARE_METATYPE(QAVThumbnailer::Mode)
+
+QT_END_NAMESPACE
+
+#endif
@@ -21,6 +21,10 @@ QAVVideoFrame::MapData QAVVideoBuffer_CPU::map()
     if (frame->format == AV_PIX_FMT_NONE)
         return mapData;
 
+    // Only the data pointers of own reference are moved
+    if (frame->crop_left || frame->crop_top || frame->crop_right || frame->crop_bottom)
+        av_frame_apply_cropping(frame, AV_FRAME_CROP_UNALIGNED);
+
     mapData.size = av_image_get_buffer_size(AVPixelFormat(frame->format), frame->width, frame->height, 1);
     mapData.format = AVPixelFormat(frame->format);
 
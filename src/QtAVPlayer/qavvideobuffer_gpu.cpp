@@ -19,11 +19,18 @@ QAVVideoFrame::MapData QAVVideoBuffer_GPU::map()
 {
     auto mapData = m_cpu.map();
     if (mapData.format == AV_PIX_FMT_NONE) {
-        int ret = av_hwframe_transfer_data(m_cpu.frame().frame(), m_frame.frame(), 0);
+        auto src = m_frame.frame();
+        auto dst = m_cpu.frame().frame();
+        int ret = av_hwframe_transfer_data(dst, src, 0);
         if (ret < 0) {
             qWarning() << "Could not av_hwframe_transfer_data:" << ret;
             return {};
         }
+        // Whole surface is downloaded, the crop is applied on map
+        dst->crop_left = src->crop_left;
+        dst->crop_top = src->crop_top;
+        dst->crop_right = src->crop_right;
+        dst->crop_bottom = src->crop_bottom;
         m_frame = QAVVideoFrame();
         mapData = m_cpu.map();
     }
@@ -20,6 +20,7 @@
 //
 
 #include <QtAVPlayer/qavvideoframe.h>
+#include "qavpool_p.h"
 #include <QVariant>
 
 QT_BEGIN_NAMESPACE
@@ -31,6 +32,9 @@ public:
     QAVVideoBuffer() = default;
     explicit QAVVideoBuffer(const QAVVideoFrame &frame) : m_frame(frame) { }
     virtual ~QAVVideoBuffer() = default;
+    // Created on each map() of a new frame
+    static void *operator new(size_t size) { return QAVPool::instance().allocate(size); }
+    static void operator delete(void *p, size_t size) { QAVPool::instance().deallocate(p, size); }
     const QAVVideoFrame &frame() const { return m_frame; }
 
     virtual QAVVideoFrame::MapData map() = 0;
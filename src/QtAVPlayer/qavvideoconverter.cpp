@@ -0,0 +1,371 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavvideoconverter_p.h"
+#include "qavallocations_p.h"
+#include <QThreadPool>
+#include <QtConcurrent/qtconcurrentrun.h>
+#include <vector>
+#include <algorithm>
+#include <QDebug>
+
+extern "C" {
+#include <libswscale/swscale.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/buffer.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+struct QAVSwsKey
+{
+    AVPixelFormat srcFormat = AV_PIX_FMT_NONE;
+    QSize srcSize;
+    int colorspace = SWS_CS_DEFAULT;
+    int srcRange = 0;
+    AVPixelFormat dstFormat = AV_PIX_FMT_NONE;
+    QSize dstSize;
+    int dstRange = 0;
+    int flags = 0;
+    int slices = 1;
+
+    bool operator==(const QAVSwsKey &other) const
+    {
+        return srcFormat == other.srcFormat && srcSize == other.srcSize
+            && colorspace == other.colorspace && srcRange == other.srcRange
+            && dstFormat == other.dstFormat && dstSize == other.dstSize
+            && dstRange == other.dstRange && flags == other.flags && slices == other.slices;
+    }
+};
+
+struct QAVSwsContext
+{
+    ~QAVSwsContext()
+    {
+        for (auto ctx : contexts)
+            sws_freeContext(ctx);
+    }
+
+    QAVSwsKey key;
+    // Context and first row of each slice
+    std::vector<SwsContext *> contexts;
+    std::vector<int> rows;
+};
+
+} // namespace
+
+class QAVVideoConverterPrivate
+{
+public:
+    ~QAVVideoConverterPrivate()
+    {
+        // Buffers still used by frames are freed when released
+        av_buffer_pool_uninit(&pool);
+    }
+
+    int sliceCount(const AVPixFmtDescriptor *src, const AVPixFmtDescriptor *dst, const QSize &srcSize, const QSize &dstSize) const;
+    QAVSwsContext *context(const QAVSwsKey &key, const AVPixFmtDescriptor *src, const AVPixFmtDescriptor *dst);
+    bool allocate(AVFrame *frame);
+
+    int threadCount = 1;
+    int flags = SWS_BICUBIC;
+    QThreadPool threadPool;
+    // Most recently used first
+    std::vector<std::unique_ptr<QAVSwsContext>> contexts;
+    AVBufferPool *pool = nullptr;
+    int poolSize = 0;
+};
+
+static const int maxContexts = 4;
+static const int bufferAlign = 32;
+
+static int swsColorspace(AVColorSpace colorspace)
+{
+    switch (colorspace) {
+    case AVCOL_SPC_BT709:
+        return SWS_CS_ITU709;
+    case AVCOL_SPC_FCC:
+        return SWS_CS_FCC;
+    case AVCOL_SPC_SMPTE240M:
+        return SWS_CS_SMPTE240M;
+    case AVCOL_SPC_BT2020_NCL:
+    case AVCOL_SPC_BT2020_CL:
+        return SWS_CS_BT2020;
+    default:
+        return SWS_CS_DEFAULT;
+    }
+}
+
+static bool isFullRange(AVPixelFormat fmt)
+{
+    switch (fmt) {
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUVJ422P:
+    case AV_PIX_FMT_YUVJ444P:
+    case AV_PIX_FMT_YUVJ440P:
+    case AV_PIX_FMT_YUVJ411P:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Rows of the plane are subsampled for chroma
+static int rowShift(const AVPixFmtDescriptor *desc, int plane)
+{
+    return (plane == 1 || plane == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB) ? desc->log2_chroma_h : 0;
+}
+
+int QAVVideoConverterPrivate::sliceCount(const AVPixFmtDescriptor *src, const AVPixFmtDescriptor *dst, const QSize &srcSize, const QSize &dstSize) const
+{
+    // Slices are independent only if the rows are not scaled,
+    // chroma at the borders of slices is interpolated within the slice
+    if (srcSize.height() != dstSize.height())
+        return 1;
+    if ((src->flags | dst->flags) & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM))
+        return 1;
+
+    if (threadCount <= 1)
+        return 1;
+    const int align = 1 << qMax(src->log2_chroma_h, dst->log2_chroma_h);
+    return qBound(1, threadCount, srcSize.height() / qMax(16, align));
+}
+
+QAVSwsContext *QAVVideoConverterPrivate::context(const QAVSwsKey &key, const AVPixFmtDescriptor *src, const AVPixFmtDescriptor *dst)
+{
+    for (auto it = contexts.begin(); it != contexts.end(); ++it) {
+        if ((*it)->key == key) {
+            std::rotate(contexts.begin(), it, it + 1);
+            return contexts.front().get();
+        }
+    }
+
+    std::unique_ptr<QAVSwsContext> ctx(new QAVSwsContext);
+    ctx->key = key;
+    const int height = key.srcSize.height();
+    const int align = 1 << qMax(src->log2_chroma_h, dst->log2_chroma_h);
+    int rows = (height + key.slices - 1) / key.slices;
+    rows = (rows + align - 1) & ~(align - 1);
+    for (int y = 0; y < height; y += rows)
+        ctx->rows.push_back(y);
+
+    const int *table = sws_getCoefficients(key.colorspace);
+    for (size_t i = 0; i < ctx->rows.size(); ++i) {
+        const int srcHeight = key.slices > 1 ? qMin(rows, height - ctx->rows[i]) : height;
+        const int dstHeight = key.slices > 1 ? srcHeight : key.dstSize.height();
+        auto sws = sws_getContext(key.srcSize.width(), srcHeight, key.srcFormat,
+                                  key.dstSize.width(), dstHeight, key.dstFormat,
+                                  key.flags, nullptr, nullptr, nullptr);
+        if (!sws)
+            return nullptr;
+        ctx->contexts.push_back(sws);
+        // Not supported between some formats, the defaults are used
+        if (sws_setColorspaceDetails(sws, table, key.srcRange, table, key.dstRange, 0, 1 << 16, 1 << 16) < 0)
+            qDebug() << "Colorspace is not supported:" << av_get_pix_fmt_name(key.srcFormat) << "->" << av_get_pix_fmt_name(key.dstFormat);
+    }
+
+    contexts.insert(contexts.begin(), std::move(ctx));
+    if (contexts.size() > size_t(maxContexts))
+        contexts.pop_back();
+    return contexts.front().get();
+}
+
+bool QAVVideoConverterPrivate::allocate(AVFrame *frame)
+{
+    const auto fmt = AVPixelFormat(frame->format);
+    int size = av_image_get_buffer_size(fmt, frame->width, frame->height, bufferAlign);
+    if (size <= 0)
+        return false;
+
+    // Padding for SIMD writes past the last row
+    size += 64;
+    if (!pool || poolSize != size) {
+        av_buffer_pool_uninit(&pool);
+        pool = av_buffer_pool_init(size, nullptr);
+        poolSize = size;
+    }
+    if (!pool)
+        return false;
+
+    frame->buf[0] = av_buffer_pool_get(pool);
+    if (!frame->buf[0])
+        return false;
+
+    return av_image_fill_arrays(frame->data, frame->linesize, frame->buf[0]->data,
+                                fmt, frame->width, frame->height, bufferAlign) >= 0;
+}
+
+static const size_t maxIdleConverters = 8;
+
+QAVVideoConverters &QAVVideoConverters::instance()
+{
+    // Never destroyed, frames could be converted after static destructors
+    static QAVVideoConverters *converters = new QAVVideoConverters;
+    return *converters;
+}
+
+std::unique_ptr<QAVVideoConverter> QAVVideoConverters::acquire()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_converters.empty()) {
+            auto converter = std::move(m_converters.back());
+            m_converters.pop_back();
+            return converter;
+        }
+    }
+    return std::unique_ptr<QAVVideoConverter>(new QAVVideoConverter);
+}
+
+void QAVVideoConverters::release(std::unique_ptr<QAVVideoConverter> converter)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_converters.size() < maxIdleConverters)
+        m_converters.push_back(std::move(converter));
+}
+
+void QAVVideoConverters::trim()
+{
+    std::vector<std::unique_ptr<QAVVideoConverter>> converters;
+    {
+        QMutexLocker locker(&m_mutex);
+        converters.swap(m_converters);
+    }
+}
+
+QAVVideoConverter::QAVVideoConverter()
+    : d_ptr(new QAVVideoConverterPrivate)
+{
+}
+
+QAVVideoConverter::~QAVVideoConverter() = default;
+
+int QAVVideoConverter::threadCount() const
+{
+    Q_D(const QAVVideoConverter);
+    return d->threadCount;
+}
+
+void QAVVideoConverter::setThreadCount(int count)
+{
+    Q_D(QAVVideoConverter);
+    d->threadCount = qMax(1, count);
+}
+
+int QAVVideoConverter::flags() const
+{
+    Q_D(const QAVVideoConverter);
+    return d->flags;
+}
+
+void QAVVideoConverter::setFlags(int flags)
+{
+    Q_D(QAVVideoConverter);
+    d->flags = flags;
+}
+
+QAVVideoFrame QAVVideoConverter::convert(const QAVVideoFrame &frame, AVPixelFormat format, const QSize &size)
+{
+    Q_D(QAVVideoConverter);
+    auto src = frame.frame();
+    if (!src || src->format == AV_PIX_FMT_NONE)
+        return {};
+
+    // Keeps the stream, frame rate and time base of the frame
+    QAVVideoFrame result = frame;
+    auto dst = result.frame();
+    av_frame_unref(dst);
+    dst->format = format;
+    dst->width = size.isEmpty() ? src->width - int(src->crop_left + src->crop_right) : size.width();
+    dst->height = size.isEmpty() ? src->height - int(src->crop_top + src->crop_bottom) : size.height();
+    if (!d->allocate(dst)) {
+        qWarning() << __FUNCTION__ << ": Could not allocate:" << av_get_pix_fmt_name(format);
+        return {};
+    }
+
+    if (!convert(frame, result))
+        return {};
+
+    QAVAllocations::instance().track(QAVAllocations::Converters, result.stream().index(), dst);
+    return result;
+}
+
+bool QAVVideoConverter::convert(const QAVVideoFrame &frame, QAVVideoFrame &result)
+{
+    Q_D(QAVVideoConverter);
+    auto src = frame.frame();
+    auto dst = result.frame();
+    if (!src || !dst || dst->format == AV_PIX_FMT_NONE || dst->width <= 0 || dst->height <= 0)
+        return false;
+
+    const auto mapData = frame.map();
+    if (mapData.format == AV_PIX_FMT_NONE) {
+        qWarning() << __FUNCTION__ << "Could not map:" << frame.formatName();
+        return false;
+    }
+    if (av_frame_make_writable(dst) < 0)
+        return false;
+
+    const auto srcDesc = av_pix_fmt_desc_get(mapData.format);
+    const auto dstDesc = av_pix_fmt_desc_get(AVPixelFormat(dst->format));
+    if (!srcDesc || !dstDesc)
+        return false;
+
+    QAVSwsKey key;
+    key.srcFormat = mapData.format;
+    key.srcSize = { src->width - int(src->crop_left + src->crop_right), src->height - int(src->crop_top + src->crop_bottom) };
+    key.colorspace = swsColorspace(src->colorspace);
+    key.srcRange = src->color_range == AVCOL_RANGE_JPEG || isFullRange(key.srcFormat);
+    key.dstFormat = AVPixelFormat(dst->format);
+    key.dstSize = { dst->width, dst->height };
+    key.dstRange = isFullRange(key.dstFormat);
+    key.flags = d->flags;
+    key.slices = d->sliceCount(srcDesc, dstDesc, key.srcSize, key.dstSize);
+
+    auto ctx = d->context(key, srcDesc, dstDesc);
+    if (!ctx) {
+        qWarning() << __FUNCTION__ << ": Could not get sws context:" << frame.formatName();
+        return false;
+    }
+
+    auto scale = [&](size_t i) {
+        const int y = ctx->rows[i];
+        const int rows = (i + 1 < ctx->rows.size() ? ctx->rows[i + 1] : key.srcSize.height()) - y;
+        const uint8_t *in[4] = {};
+        uint8_t *out[4] = {};
+        for (int p = 0; p < 4; ++p) {
+            if (mapData.data[p])
+                in[p] = mapData.data[p] + qint64(y >> rowShift(srcDesc, p)) * mapData.bytesPerLine[p];
+            if (dst->data[p])
+                out[p] = dst->data[p] + qint64(y >> rowShift(dstDesc, p)) * dst->linesize[p];
+        }
+        sws_scale(ctx->contexts[i], in, mapData.bytesPerLine, 0, rows, out, dst->linesize);
+    };
+
+    // The first slice is converted on the current thread
+    QList<QFuture<void>> futures;
+    for (size_t i = 1; i < ctx->contexts.size(); ++i)
+        futures.push_back(QtConcurrent::run(&d->threadPool, [&scale, i] { scale(i); }));
+    scale(0);
+    for (auto &future : futures)
+        future.waitForFinished();
+
+    av_frame_copy_props(dst, src);
+    dst->crop_left = dst->crop_top = dst->crop_right = dst->crop_bottom = 0;
+    if (dstDesc->flags & AV_PIX_FMT_FLAG_RGB) {
+        dst->color_range = AVCOL_RANGE_JPEG;
+        dst->colorspace = AVCOL_SPC_RGB;
+    } else {
+        dst->color_range = key.dstRange ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+    }
+    return true;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,47 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVFVIDEOCONVERTER_H
+#define QAVFVIDEOCONVERTER_H
+
+#include <QtAVPlayer/qavvideoframe.h>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+// Converts and scales video frames, the contexts are reused between the calls
+class QAVVideoConverterPrivate;
+class QAVVideoConverter
+{
+public:
+    QAVVideoConverter();
+    ~QAVVideoConverter();
+
+    // Empty size keeps the size of the frame, the result is allocated from the pool
+    QAVVideoFrame convert(const QAVVideoFrame &frame, AVPixelFormat format, const QSize &size = {});
+    // Writes to the allocated frame using its format and size
+    bool convert(const QAVVideoFrame &frame, QAVVideoFrame &result);
+
+    // Horizontal slices converted in parallel, 1 by default.
+    // Rows at the borders of the slices could differ from the conversion of the whole frame
+    // if chroma is interpolated, e.g. when the size is changed
+    int threadCount() const;
+    void setThreadCount(int count);
+
+    // SWS_* flags, SWS_BICUBIC by default
+    int flags() const;
+    void setFlags(int flags);
+
+private:
+    Q_DISABLE_COPY(QAVVideoConverter)
+    Q_DECLARE_PRIVATE(QAVVideoConverter)
+    std::unique_ptr<QAVVideoConverterPrivate> d_ptr;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,53 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVVIDEOCONVERTER_P_H
+#define QAVVIDEOCONVERTER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qavvideoconverter.h"
+#include <QMutex>
+#include <vector>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+// Process-wide idle converters used by QAVVideoFrame::convertTo(),
+// a converter released by one thread is reused by another one
+class QAVVideoConverters
+{
+public:
+    static QAVVideoConverters &instance();
+
+    std::unique_ptr<QAVVideoConverter> acquire();
+    void release(std::unique_ptr<QAVVideoConverter> converter);
+
+    // Frees the idle converters with their contexts and buffer pools
+    void trim();
+
+private:
+    QAVVideoConverters() = default;
+    Q_DISABLE_COPY(QAVVideoConverters)
+
+    QMutex m_mutex;
+    // Most recently used last
+    std::vector<std::unique_ptr<QAVVideoConverter>> m_converters;
+};
+
+QT_END_NAMESPACE
+
+#endif
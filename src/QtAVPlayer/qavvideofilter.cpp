@@ -10,6 +10,7 @@
 #include "qavcodec_p.h"
 #include "qavvideoframe.h"
 #include "qavstream.h"
+#include "qavallocations_p.h"
 #include <QDebug>
 
 extern "C" {
@@ -80,7 +81,7 @@ int QAVVideoFilter::read(QAVFrame &frame)
     if (d->outputs.isEmpty() || d->isEmpty) {
         int ret = AVERROR(EAGAIN);
         if (d->sourceFrame && d->outputs.isEmpty()) {
-            frame = d->sourceFrame;
+            frame = std::move(d->sourceFrame);
             ret = 0;
         }
         d->sourceFrame = {};
@@ -118,7 +119,8 @@ int QAVVideoFilter::read(QAVFrame &frame)
                     : QString(QLatin1String("%1:%2")).arg(d->name).arg(QString::number(i)));
                 if (!out.stream())
                     out.setStream(d->stream);
-                d->outputFrames.push_back(out);
+                QAVAllocations::instance().track(QAVAllocations::Filters, out.stream().index(), out.frame());
+                d->outputFrames.push_back(std::move(out));
             }
         }
     }
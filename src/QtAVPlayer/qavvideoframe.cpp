@@ -10,6 +10,7 @@
 #include "qavframe_p.h"
 #include "qavvideocodec_p.h"
 #include "qavhwdevice_p.h"
+#include "qavvideoconverter_p.h"
 #include <QSize>
 #ifdef QT_AVPLAYER_MULTIMEDIA
     #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
@@ -26,7 +27,6 @@
 #include <QDebug>
 
 extern "C" {
-#include <libswscale/swscale.h>
 #include <libavutil/pixdesc.h>
 #include "libavutil/imgutils.h"
 #include <libavutil/mastering_display_metadata.h>
@@ -39,29 +39,35 @@ static const QAVVideoCodec *videoCodec(const QAVCodec *c)
     return reinterpret_cast<const QAVVideoCodec *>(c);
 }
 
+// Size of the mapped data, crop fields are set only for hardware frames
+static QSize visibleSize(const AVFrame *frame)
+{
+    return {
+        frame->width - static_cast<int>(frame->crop_left + frame->crop_right),
+        frame->height - static_cast<int>(frame->crop_top + frame->crop_bottom)
+    };
+}
+
 class QAVVideoFramePrivate : public QAVFramePrivate
 {
-    Q_DECLARE_PUBLIC(QAVVideoFrame)
 public:
-    QAVVideoFramePrivate(QAVVideoFrame *q) : q_ptr(q) { }
-
-    QAVVideoBuffer &videoBuffer() const
+    // The private could be moved between frames, so the owner is passed
+    QAVVideoBuffer &videoBuffer(const QAVVideoFrame &q) const
     {
         if (!buffer) {
             auto c = videoCodec(stream.codec().data());
-            auto buf = c && c->device() && frame->format == c->device()->format() ? c->device()->videoBuffer(*q_ptr) : new QAVVideoBuffer_CPU(*q_ptr);
+            auto buf = c && c->device() && frame->format == c->device()->format() ? c->device()->videoBuffer(q) : new QAVVideoBuffer_CPU(q);
             const_cast<QAVVideoFramePrivate*>(this)->buffer.reset(buf);
         }
 
         return *buffer;
     }
 
-    QAVVideoFrame *q_ptr = nullptr;
     QScopedPointer<QAVVideoBuffer> buffer;
 };
 
 QAVVideoFrame::QAVVideoFrame()
-    : QAVFrame(*new QAVVideoFramePrivate(this))
+    : QAVFrame(*new QAVVideoFramePrivate)
 {
 }
 
@@ -77,6 +83,12 @@ QAVVideoFrame::QAVVideoFrame(const QAVVideoFrame &other)
     operator=(other);
 }
 
+QAVVideoFrame::QAVVideoFrame(QAVVideoFrame &&other) noexcept
+    : QAVVideoFrame()
+{
+    *this = std::move(other);
+}
+
 QAVVideoFrame::QAVVideoFrame(const QSize &size, AVPixelFormat fmt)
     : QAVVideoFrame()
 {
@@ -88,6 +100,8 @@ QAVVideoFrame::QAVVideoFrame(const QSize &size, AVPixelFormat fmt)
 
 QAVVideoFrame &QAVVideoFrame::operator=(const QAVFrame &other)
 {
+    if (this == &other)
+        return *this;
     Q_D(QAVVideoFrame);
     QAVFrame::operator=(other);
     d->buffer.reset();
@@ -96,12 +110,25 @@ QAVVideoFrame &QAVVideoFrame::operator=(const QAVFrame &other)
 
 QAVVideoFrame &QAVVideoFrame::operator=(const QAVVideoFrame &other)
 {
+    if (this == &other)
+        return *this;
     Q_D(QAVVideoFrame);
     QAVFrame::operator=(other);
     d->buffer.reset();
     return *this;
 }
 
+QAVVideoFrame &QAVVideoFrame::operator=(QAVVideoFrame &&other) noexcept
+{
+    if (this == &other)
+        return *this;
+    Q_D(QAVVideoFrame);
+    QAVFrame::operator=(std::move(other));
+    d->buffer.reset();
+    static_cast<QAVVideoFramePrivate *>(other.d_ptr.get())->buffer.reset();
+    return *this;
+}
+
 QSize QAVVideoFrame::size() const
 {
     Q_D(const QAVFrame);
@@ -111,26 +138,26 @@ QSize QAVVideoFrame::size() const
 QAVVideoFrame::MapData QAVVideoFrame::map() const
 {
     Q_D(const QAVVideoFrame);
-    return d->videoBuffer().map();
+    return d->videoBuffer(*this).map();
 }
 
 QAVVideoFrame::HandleType QAVVideoFrame::handleType() const
 {
     Q_D(const QAVVideoFrame);
-    return d->videoBuffer().handleType();
+    return d->videoBuffer(*this).handleType();
 }
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 QVariant QAVVideoFrame::handle(QRhi *rhi) const
 {
     Q_D(const QAVVideoFrame);
-    return d->videoBuffer().handle(rhi);
+    return d->videoBuffer(*this).handle(rhi);
 }
 #else
 QVariant QAVVideoFrame::handle() const
 {
     Q_D(const QAVVideoFrame);
-    return d->videoBuffer().handle();
+    return d->videoBuffer(*this).handle();
 }
 #endif
 
@@ -144,36 +171,125 @@ QString QAVVideoFrame::formatName() const
     return QLatin1String(av_pix_fmt_desc_get(QAVVideoFrame::format())->name);
 }
 
-QAVVideoFrame QAVVideoFrame::convertTo(AVPixelFormat fmt) const
+QAVVideoFrame QAVVideoFrame::cropped(const QRect &rect) const
 {
-    if (fmt == frame()->format)
-        return *this;
+    const auto desc = av_pix_fmt_desc_get(format());
+    const QSize visible = visibleSize(frame());
+    QRect r = rect.intersected(QRect(QPoint(0, 0), visible));
+    if (!desc || r.isEmpty() || !*this)
+        return {};
 
-    auto mapData = map();
-    if (mapData.format == AV_PIX_FMT_NONE) {
-        qWarning() << __FUNCTION__ << "Could not map:" << formatName();
-        return QAVVideoFrame();
-    }
-    auto ctx = sws_getContext(size().width(), size().height(), mapData.format,
-                              size().width(), size().height(), fmt,
-                              SWS_BICUBIC, NULL, NULL, NULL);
-    if (ctx == nullptr) {
-        qWarning() << __FUNCTION__ << ": Could not get sws context:" << formatName();
-        return QAVVideoFrame();
-    }
+    // Chroma samples must not be split
+    r.setLeft(r.left() & ~((1 << desc->log2_chroma_w) - 1));
+    r.setTop(r.top() & ~((1 << desc->log2_chroma_h) - 1));
+
+    QAVVideoFrame result = *this;
+    auto f = result.frame();
+    f->crop_left += r.left();
+    f->crop_top += r.top();
+    f->crop_right += visible.width() - r.right() - 1;
+    f->crop_bottom += visible.height() - r.bottom() - 1;
+    // Surfaces could not be addressed by pointers
+    if (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM))
+        return result;
+
+    if (av_frame_apply_cropping(f, AV_FRAME_CROP_UNALIGNED) < 0)
+        return {};
+    return result;
+}
 
-    int ret = sws_setColorspaceDetails(ctx, sws_getCoefficients(SWS_CS_ITU601),
-                                       0, sws_getCoefficients(SWS_CS_ITU709), 0, 0, 1 << 16, 1 << 16);
-    if (ret == -1) {
-        qWarning() << __FUNCTION__ << "Colorspace not support";
-        return QAVVideoFrame();
+QList<QAVVideoFrame> QAVVideoFrame::tiles(int columns, int rows) const
+{
+    QList<QAVVideoFrame> result;
+    if (columns <= 0 || rows <= 0)
+        return result;
+
+    const QSize visible = visibleSize(frame());
+    for (int row = 0; row < rows; ++row) {
+        const int top = visible.height() * row / rows;
+        const int bottom = visible.height() * (row + 1) / rows;
+        for (int column = 0; column < columns; ++column) {
+            const int left = visible.width() * column / columns;
+            const int right = visible.width() * (column + 1) / columns;
+            auto tile = cropped(QRect(left, top, right - left, bottom - top));
+            if (!tile)
+                return {};
+            result.push_back(tile);
+        }
     }
+    return result;
+}
+
+int QAVVideoFrame::planeCount() const
+{
+    const auto mapData = map();
+    return mapData.format != AV_PIX_FMT_NONE ? av_pix_fmt_count_planes(mapData.format) : 0;
+}
+
+QAVVideoFrame::Plane QAVVideoFrame::plane(int index) const
+{
+    const auto mapData = map();
+    const auto desc = av_pix_fmt_desc_get(mapData.format);
+    if (!desc || index < 0 || index >= qMin(4, av_pix_fmt_count_planes(mapData.format)))
+        return {};
+
+    int steps[4] = {};
+    av_image_fill_max_pixsteps(steps, nullptr, desc);
+    const QSize visible = visibleSize(frame());
+    const bool chroma = (index == 1 || index == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+    Plane p;
+    p.data = mapData.data[index];
+    p.bytesPerLine = mapData.bytesPerLine[index];
+    p.size = chroma
+        ? QSize(AV_CEIL_RSHIFT(visible.width(), desc->log2_chroma_w), AV_CEIL_RSHIFT(visible.height(), desc->log2_chroma_h))
+        : visible;
+    p.pixelStride = steps[index];
+    return p;
+}
+
+QAVVideoFrame::MotionVectors QAVVideoFrame::motionVectors() const
+{
+    auto sd = av_frame_get_side_data(frame(), AV_FRAME_DATA_MOTION_VECTORS);
+    if (!sd)
+        return {};
+    return { reinterpret_cast<const AVMotionVector *>(sd->data), int(sd->size / sizeof(AVMotionVector)) };
+}
+
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 42, 100)
+const AVVideoEncParams *QAVVideoFrame::encodeParams() const
+{
+    auto sd = av_frame_get_side_data(frame(), AV_FRAME_DATA_VIDEO_ENC_PARAMS);
+    return sd ? reinterpret_cast<const AVVideoEncParams *>(sd->data) : nullptr;
+}
+#endif
+
+QAVVideoFrame QAVVideoFrame::sideData() const
+{
+    Q_D(const QAVVideoFrame);
+    QAVVideoFrame result;
+    result.setStream(stream());
+    auto r = static_cast<QAVVideoFramePrivate *>(result.d_ptr.get());
+    // Side data buffers are referenced, not copied
+    av_frame_copy_props(r->frame, d->frame);
+    r->frame->width = d->frame->width;
+    r->frame->height = d->frame->height;
+    r->frame->format = d->frame->format;
+    r->frameRate = d->frameRate;
+    r->timeBase = d->timeBase;
+    r->filterName = d->filterName;
+    return result;
+}
 
-    QAVVideoFrame result(size(), fmt);
-    result.d_ptr->stream = d_ptr->stream;
-    sws_scale(ctx, mapData.data, mapData.bytesPerLine, 0, result.size().height(), result.frame()->data, result.frame()->linesize);
-    sws_freeContext(ctx);
+QAVVideoFrame QAVVideoFrame::convertTo(AVPixelFormat fmt, const QSize &size) const
+{
+    if (fmt == frame()->format && (size.isEmpty() || size == visibleSize(frame())))
+        return *this;
 
+    // The contexts are reused by the next calls from any thread
+    auto &converters = QAVVideoConverters::instance();
+    auto converter = converters.acquire();
+    auto result = converter->convert(*this, fmt, size);
+    converters.release(std::move(converter));
     return result;
 }
 
@@ -10,12 +10,17 @@
 
 #include <QtAVPlayer/qavframe.h>
 #include <QVariant>
+#include <QRect>
 #ifdef QT_AVPLAYER_MULTIMEDIA
 #include <QVideoFrame>
 #endif
 
 extern "C" {
 #include <libavutil/frame.h>
+#include <libavutil/motion_vector.h>
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 42, 100)
+#include <libavutil/video_enc_params.h>
+#endif
 }
 
 QT_BEGIN_NAMESPACE
@@ -39,10 +44,12 @@ public:
     QAVVideoFrame();
     QAVVideoFrame(const QAVFrame &other);
     QAVVideoFrame(const QAVVideoFrame &other);
+    QAVVideoFrame(QAVVideoFrame &&other) noexcept;
     QAVVideoFrame(const QSize &size, AVPixelFormat fmt);
 
     QAVVideoFrame &operator=(const QAVFrame &other);
     QAVVideoFrame &operator=(const QAVVideoFrame &other);
+    QAVVideoFrame &operator=(QAVVideoFrame &&other) noexcept;
 
     QSize size() const;
 
@@ -63,7 +70,46 @@ public:
 #endif
     AVPixelFormat format() const;
     QString formatName() const;
-    QAVVideoFrame convertTo(AVPixelFormat fmt) const;
+    // Empty size keeps the size, see QAVVideoConverter to control the conversion
+    QAVVideoFrame convertTo(AVPixelFormat fmt, const QSize &size = {}) const;
+
+    // Shares the buffers, only the data pointers and dimensions are adjusted.
+    // The top left corner is aligned down to the chroma subsampling.
+    // Hardware frames keep the rect in the crop fields, applied on map() or by the viewport.
+    QAVVideoFrame cropped(const QRect &rect) const;
+    // Cropped frames of the grid, row by row
+    QList<QAVVideoFrame> tiles(int columns, int rows) const;
+
+    // Mapped plane, refers to the frame and valid while it is alive
+    struct Plane
+    {
+        uchar *data = nullptr;
+        int bytesPerLine = 0;
+        // Chroma planes are subsampled
+        QSize size;
+        // Bytes between horizontally adjacent pixels
+        int pixelStride = 0;
+    };
+    int planeCount() const;
+    Plane plane(int index) const;
+
+    // Side data exported by the decoder, refers to the frame and valid while it is alive
+    struct MotionVectors
+    {
+        const AVMotionVector *data = nullptr;
+        int size = 0;
+
+        const AVMotionVector *begin() const { return data; }
+        const AVMotionVector *end() const { return data + size; }
+        const AVMotionVector &operator[](int i) const { return data[i]; }
+    };
+    MotionVectors motionVectors() const;
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 42, 100)
+    // Quantizers of the frame and its blocks, see av_video_enc_params_block()
+    const AVVideoEncParams *encodeParams() const;
+#endif
+    // Frame with the same properties and side data, but without the image
+    QAVVideoFrame sideData() const;
 #ifdef QT_AVPLAYER_MULTIMEDIA
     operator QVideoFrame() const;
 #endif
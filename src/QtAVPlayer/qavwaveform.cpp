@@ -0,0 +1,514 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#include "qavwaveform.h"
+#include "qavdemuxer_p.h"
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/qtconcurrentrun.h>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <limits>
+#include <math.h>
+#include <QDebug>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QAV_WAVEFORM_SSE2
+#endif
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/samplefmt.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+struct QAVWaveformBucket
+{
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+    double sum = 0;
+    qint64 count = 0;
+
+    void merge(const QAVWaveformBucket &other)
+    {
+        min = qMin(min, other.min);
+        max = qMax(max, other.max);
+        sum += other.sum;
+        count += other.count;
+    }
+
+    QAVWaveform::Peak peak() const
+    {
+        if (!count)
+            return {};
+        return { min, max, float(sqrt(sum / count)) };
+    }
+};
+
+// Samples in [firstSample, lastSample) are decoded to buckets starting from firstBucket
+struct QAVWaveformRange
+{
+    double start = 0;
+    qint64 firstSample = 0;
+    qint64 lastSample = -1;
+    qint64 firstBucket = 0;
+    QVector<QVector<QAVWaveformBucket>> buckets;
+};
+
+} // namespace
+
+class QAVWaveformPrivate
+{
+public:
+    int decode(QAVWaveformRange &range) const;
+    void process(QAVWaveformRange &range, const AVFrame *frame, qint64 firstSample) const;
+    QString cacheFile() const;
+    bool readCache();
+    void writeCache() const;
+
+    QString url;
+    int samplesPerBucket = 256;
+    int threadCount = QThread::idealThreadCount();
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/waveforms");
+    bool cached = false;
+
+    int sampleRate = 0;
+    int channels = 0;
+    // Peaks by level and channel
+    QVector<QVector<QVector<QAVWaveform::Peak>>> levels;
+};
+
+QAVWaveform::QAVWaveform()
+    : d_ptr(new QAVWaveformPrivate)
+{
+}
+
+QAVWaveform::~QAVWaveform()
+{
+}
+
+int QAVWaveform::samplesPerBucket() const
+{
+    return d_func()->samplesPerBucket;
+}
+
+void QAVWaveform::setSamplesPerBucket(int samples)
+{
+    d_func()->samplesPerBucket = qMax(1, samples);
+}
+
+int QAVWaveform::threadCount() const
+{
+    return d_func()->threadCount;
+}
+
+void QAVWaveform::setThreadCount(int count)
+{
+    d_func()->threadCount = qMax(1, count);
+}
+
+QString QAVWaveform::cacheDir() const
+{
+    return d_func()->cacheDir;
+}
+
+void QAVWaveform::setCacheDir(const QString &dir)
+{
+    d_func()->cacheDir = dir;
+}
+
+bool QAVWaveform::isCached() const
+{
+    return d_func()->cached;
+}
+
+int QAVWaveform::sampleRate() const
+{
+    return d_func()->sampleRate;
+}
+
+int QAVWaveform::channels() const
+{
+    return d_func()->channels;
+}
+
+int QAVWaveform::levels() const
+{
+    return d_func()->levels.size();
+}
+
+double QAVWaveform::bucketDuration(int level) const
+{
+    Q_D(const QAVWaveform);
+    return d->sampleRate ? double(qint64(d->samplesPerBucket) << level) / d->sampleRate : 0.0;
+}
+
+QVector<QAVWaveform::Peak> QAVWaveform::peaks(int level, int channel) const
+{
+    Q_D(const QAVWaveform);
+    if (level < 0 || level >= d->levels.size() || channel < 0 || channel >= d->levels[level].size())
+        return {};
+    return d->levels[level][channel];
+}
+
+int QAVWaveform::level(double duration, int maxBuckets) const
+{
+    Q_D(const QAVWaveform);
+    for (int i = 0; i < d->levels.size(); ++i) {
+        if (duration / bucketDuration(i) <= maxBuckets)
+            return i;
+    }
+    return d->levels.size() - 1;
+}
+
+template <typename T>
+static void accumulate(const T *data, int stride, int count, float scale, float bias, QAVWaveformBucket &bucket)
+{
+    float min = bucket.min;
+    float max = bucket.max;
+    double sum = 0;
+    for (int i = 0; i < count; ++i) {
+        const float v = (float(data[i * stride]) - bias) * scale;
+        min = qMin(min, v);
+        max = qMax(max, v);
+        sum += v * v;
+    }
+    bucket.min = min;
+    bucket.max = max;
+    bucket.sum += sum;
+    bucket.count += count;
+}
+
+// Most of the decoders return planar floats
+static void accumulate(const float *data, int stride, int count, QAVWaveformBucket &bucket)
+{
+    int i = 0;
+#ifdef QAV_WAVEFORM_SSE2
+    if (stride == 1 && count >= 4) {
+        __m128 min = _mm_set1_ps(bucket.min);
+        __m128 max = _mm_set1_ps(bucket.max);
+        __m128 sum = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4) {
+            const __m128 v = _mm_loadu_ps(data + i);
+            min = _mm_min_ps(min, v);
+            max = _mm_max_ps(max, v);
+            sum = _mm_add_ps(sum, _mm_mul_ps(v, v));
+        }
+        float mins[4], maxs[4], sums[4];
+        _mm_storeu_ps(mins, min);
+        _mm_storeu_ps(maxs, max);
+        _mm_storeu_ps(sums, sum);
+        bucket.min = qMin(qMin(mins[0], mins[1]), qMin(mins[2], mins[3]));
+        bucket.max = qMax(qMax(maxs[0], maxs[1]), qMax(maxs[2], maxs[3]));
+        bucket.sum += double(sums[0]) + sums[1] + sums[2] + sums[3];
+        bucket.count += i;
+    }
+#endif
+    if (i < count)
+        accumulate(data + i * stride, stride, count - i, 1.0f, 0.0f, bucket);
+}
+
+void QAVWaveformPrivate::process(QAVWaveformRange &range, const AVFrame *frame, qint64 firstSample) const
+{
+    const auto format = AVSampleFormat(frame->format);
+    const bool planar = av_sample_fmt_is_planar(format);
+    const int bytesPerSample = av_get_bytes_per_sample(format);
+#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
+    const int frameChannels = frame->channels;
+#else
+    const int frameChannels = frame->ch_layout.nb_channels;
+#endif
+    const int count = qMin(channels, frameChannels);
+    const int stride = planar ? 1 : frameChannels;
+
+    qint64 pos = qMax<qint64>(0, range.firstSample - firstSample);
+    qint64 end = frame->nb_samples;
+    if (range.lastSample >= 0)
+        end = qMin(end, range.lastSample - firstSample);
+
+    while (pos < end) {
+        const qint64 sample = firstSample + pos;
+        const qint64 bucket = sample / samplesPerBucket;
+        const int n = int(qMin(end - pos, (bucket + 1) * samplesPerBucket - sample));
+        const int index = int(bucket - range.firstBucket);
+        for (int c = 0; c < count; ++c) {
+            auto &buckets = range.buckets[c];
+            if (buckets.size() <= index)
+                buckets.resize(index + 1);
+            auto &b = buckets[index];
+            const uint8_t *data = planar
+                ? frame->extended_data[c] + pos * bytesPerSample
+                : frame->extended_data[0] + (pos * frameChannels + c) * bytesPerSample;
+            switch (av_get_packed_sample_fmt(format)) {
+            case AV_SAMPLE_FMT_U8:
+                accumulate(data, stride, n, 1.0f / 128, 128.0f, b);
+                break;
+            case AV_SAMPLE_FMT_S16:
+                accumulate(reinterpret_cast<const int16_t *>(data), stride, n, 1.0f / 32768, 0.0f, b);
+                break;
+            case AV_SAMPLE_FMT_S32:
+                accumulate(reinterpret_cast<const int32_t *>(data), stride, n, 1.0f / 2147483648.0f, 0.0f, b);
+                break;
+            case AV_SAMPLE_FMT_FLT:
+                accumulate(reinterpret_cast<const float *>(data), stride, n, b);
+                break;
+            case AV_SAMPLE_FMT_DBL:
+                accumulate(reinterpret_cast<const double *>(data), stride, n, 1.0f, 0.0f, b);
+                break;
+            default:
+                break;
+            }
+        }
+        pos += n;
+    }
+}
+
+int QAVWaveformPrivate::decode(QAVWaveformRange &range) const
+{
+    QAVDemuxer demuxer;
+    int ret = demuxer.load(url);
+    if (ret < 0)
+        return ret;
+    const auto streams = demuxer.currentAudioStreams();
+    if (streams.isEmpty())
+        return AVERROR_STREAM_NOT_FOUND;
+    const auto stream = streams.first();
+
+    // Only audio packets are read
+    auto ctx = demuxer.avctx();
+    for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+        if (int(i) != stream.index())
+            ctx->streams[i]->discard = AVDISCARD_ALL;
+    }
+
+    // Seeking could land after the position, earlier samples are skipped
+    if (range.start > 0 && (ret = demuxer.seek(qMax(0.0, range.start - 1.0))) < 0)
+        return ret;
+
+    range.buckets.resize(channels);
+    qint64 nextSample = range.firstSample;
+    bool done = false;
+    while (!done) {
+        auto pkt = demuxer.read();
+        if (pkt && pkt.packet()->stream_index != stream.index())
+            continue;
+        if (!pkt) {
+            pkt.setStream(stream);
+            done = true;
+        }
+
+        QList<QAVFrame> frames;
+        demuxer.decode(pkt, frames);
+        for (const auto &frame : frames) {
+            const double pts = frame.pts();
+            const qint64 firstSample = !isnan(pts) ? llround(pts * sampleRate) : nextSample;
+            if (range.lastSample >= 0 && firstSample >= range.lastSample) {
+                done = true;
+                break;
+            }
+            process(range, frame.frame(), firstSample);
+            nextSample = firstSample + frame.frame()->nb_samples;
+        }
+    }
+
+    return 0;
+}
+
+QString QAVWaveformPrivate::cacheFile() const
+{
+    if (cacheDir.isEmpty())
+        return {};
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QFileInfo info(url);
+    if (info.exists()) {
+        hash.addData(info.absoluteFilePath().toUtf8());
+        hash.addData(QByteArray::number(info.size()));
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    } else {
+        hash.addData(url.toUtf8());
+    }
+    hash.addData(QByteArray::number(samplesPerBucket));
+    return QDir(cacheDir).filePath(QString::fromLatin1(hash.result().toHex()) + QLatin1String(".peaks"));
+}
+
+static const quint32 cacheMagic = 0x51415657;
+static const quint32 cacheVersion = 1;
+
+bool QAVWaveformPrivate::readCache()
+{
+    QFile file(cacheFile());
+    if (file.fileName().isEmpty() || !file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    quint32 magic = 0, version = 0;
+    qint32 rate = 0, chans = 0, spb = 0, count = 0;
+    in >> magic >> version >> rate >> chans >> spb >> count;
+    if (magic != cacheMagic || version != cacheVersion || spb != samplesPerBucket || count < 0 || chans < 0)
+        return false;
+
+    QVector<QVector<QVector<QAVWaveform::Peak>>> peaks(count);
+    for (auto &level : peaks) {
+        level.resize(chans);
+        for (auto &channel : level) {
+            qint32 size = 0;
+            in >> size;
+            if (size < 0 || in.status() != QDataStream::Ok)
+                return false;
+            channel.resize(size);
+            for (auto &peak : channel)
+                in >> peak.min >> peak.max >> peak.rms;
+        }
+    }
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    sampleRate = rate;
+    channels = chans;
+    levels = peaks;
+    return true;
+}
+
+void QAVWaveformPrivate::writeCache() const
+{
+    const QString fileName = cacheFile();
+    if (fileName.isEmpty() || !QDir().mkpath(cacheDir))
+        return;
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write peaks to:" << fileName;
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    out << cacheMagic << cacheVersion << qint32(sampleRate) << qint32(channels)
+        << qint32(samplesPerBucket) << qint32(levels.size());
+    for (const auto &level : levels) {
+        for (const auto &channel : level) {
+            out << qint32(channel.size());
+            for (const auto &peak : channel)
+                out << peak.min << peak.max << peak.rms;
+        }
+    }
+    file.commit();
+}
+
+int QAVWaveform::load(const QString &url)
+{
+    Q_D(QAVWaveform);
+    d->url = url;
+    d->cached = false;
+    d->sampleRate = 0;
+    d->channels = 0;
+    d->levels.clear();
+    if (d->readCache()) {
+        d->cached = true;
+        return 0;
+    }
+
+    double duration = 0;
+    bool seekable = false;
+    {
+        QAVDemuxer demuxer;
+        int ret = demuxer.load(url);
+        if (ret < 0)
+            return ret;
+        const auto streams = demuxer.currentAudioStreams();
+        if (streams.isEmpty())
+            return AVERROR_STREAM_NOT_FOUND;
+        auto codecpar = streams.first().stream()->codecpar;
+        d->sampleRate = codecpar->sample_rate;
+#if LIBAVUTIL_VERSION_INT <= AV_VERSION_INT(57, 23, 0)
+        d->channels = codecpar->channels;
+#else
+        d->channels = codecpar->ch_layout.nb_channels;
+#endif
+        duration = demuxer.duration();
+        seekable = demuxer.seekable();
+    }
+    if (d->sampleRate <= 0 || d->channels <= 0)
+        return AVERROR(EINVAL);
+
+    // Long files are split to ranges by seek points, at least 30 seconds each
+    const int count = seekable && duration > 0 ? qBound(1, int(duration / 30), d->threadCount) : 1;
+    QVector<QAVWaveformRange> ranges(count);
+    for (int i = 0; i < count; ++i) {
+        auto &range = ranges[i];
+        range.start = duration * i / count;
+        range.firstSample = llround(range.start * d->sampleRate);
+        range.lastSample = i + 1 < count ? llround(duration * (i + 1) / count * d->sampleRate) : -1;
+        range.firstBucket = range.firstSample / d->samplesPerBucket;
+    }
+
+    QVector<int> results(count);
+    if (count > 1) {
+        QThreadPool pool;
+        pool.setMaxThreadCount(count);
+        QList<QFuture<void>> futures;
+        for (int i = 0; i < count; ++i)
+            futures.push_back(QtConcurrent::run(&pool, [d, &ranges, &results, i] { results[i] = d->decode(ranges[i]); }));
+        for (auto &future : futures)
+            future.waitForFinished();
+    } else {
+        results[0] = d->decode(ranges[0]);
+    }
+    for (int ret : results) {
+        if (ret < 0)
+            return ret;
+    }
+
+    // Buckets at the edges of ranges are merged
+    QVector<QVector<QAVWaveformBucket>> buckets(d->channels);
+    for (const auto &range : ranges) {
+        for (int c = 0; c < d->channels; ++c) {
+            const auto &src = range.buckets[c];
+            auto &dst = buckets[c];
+            if (dst.size() < range.firstBucket + src.size())
+                dst.resize(int(range.firstBucket + src.size()));
+            for (int i = 0; i < src.size(); ++i)
+                dst[int(range.firstBucket) + i].merge(src[i]);
+        }
+    }
+
+    while (true) {
+        QVector<QVector<Peak>> level(d->channels);
+        for (int c = 0; c < d->channels; ++c) {
+            level[c].reserve(buckets[c].size());
+            for (const auto &b : buckets[c])
+                level[c].push_back(b.peak());
+        }
+        d->levels.push_back(level);
+        if (buckets.first().size() <= 1)
+            break;
+
+        for (auto &channel : buckets) {
+            QVector<QAVWaveformBucket> next((channel.size() + 1) / 2);
+            for (int i = 0; i < channel.size(); ++i)
+                next[i / 2].merge(channel[i]);
+            channel = next;
+        }
+    }
+
+    d->writeCache();
+    return 0;
+}
+
+QT_END_NAMESPACE
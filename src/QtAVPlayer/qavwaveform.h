@@ -0,0 +1,68 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVWAVEFORM_H
+#define QAVWAVEFORM_H
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+class QAVWaveformPrivate;
+/**
+ * Extracts peaks of the first audio stream per channel.
+ * Level 0 contains samplesPerBucket() samples per bucket,
+ * each next level merges two buckets of the previous one.
+ */
+class QAVWaveform
+{
+public:
+    QAVWaveform();
+    ~QAVWaveform();
+
+    struct Peak
+    {
+        float min = 0;
+        float max = 0;
+        float rms = 0;
+    };
+
+    int samplesPerBucket() const;
+    void setSamplesPerBucket(int samples);
+
+    int threadCount() const;
+    void setThreadCount(int count);
+
+    // Directory to store extracted peaks, empty to disable caching
+    QString cacheDir() const;
+    void setCacheDir(const QString &dir);
+
+    // Decodes the audio or reads the peaks from the cache
+    int load(const QString &url);
+    bool isCached() const;
+
+    int sampleRate() const;
+    int channels() const;
+    int levels() const;
+    // Duration of one bucket of the level in seconds
+    double bucketDuration(int level) const;
+    QVector<Peak> peaks(int level, int channel) const;
+    // Finds the lowest level with no more than max buckets per the duration
+    int level(double duration, int maxBuckets) const;
+
+private:
+    Q_DISABLE_COPY(QAVWaveform)
+    Q_DECLARE_PRIVATE(QAVWaveform)
+    std::unique_ptr<QAVWaveformPrivate> d_ptr;
+};
+
+QT_END_NAMESPACE
+
+#endif
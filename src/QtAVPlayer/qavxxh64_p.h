@@ -0,0 +1,120 @@
+/*********************************************************
+ * Copyright (C) 2025, Val Doroshchuk <valbok@gmail.com> *
+ *                                                       *
+ * This file is part of QtAVPlayer.                      *
+ * Free Qt Media Player based on FFmpeg.                 *
+ *********************************************************/
+
+#ifndef QAVXXH64_P_H
+#define QAVXXH64_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtAVPlayer/qtavplayerglobal.h>
+#include <QtEndian>
+#include <stdint.h>
+#include <string.h>
+
+QT_BEGIN_NAMESPACE
+
+// Streaming XXH64 with seed 0, four independent lanes per 32 bytes stripe
+class QAVXXH64
+{
+public:
+    void update(const uint8_t *data, size_t len)
+    {
+        m_total += len;
+        if (m_size) {
+            const size_t n = qMin(len, sizeof(m_buf) - m_size);
+            memcpy(m_buf + m_size, data, n);
+            m_size += n;
+            data += n;
+            len -= n;
+            if (m_size < sizeof(m_buf))
+                return;
+            stripe(m_buf);
+            m_size = 0;
+        }
+        for (; len >= 32; data += 32, len -= 32)
+            stripe(data);
+        memcpy(m_buf, data, len);
+        m_size = len;
+    }
+
+    quint64 digest() const
+    {
+        quint64 h = 0;
+        if (m_total >= 32) {
+            h = rotl(m_v[0], 1) + rotl(m_v[1], 7) + rotl(m_v[2], 12) + rotl(m_v[3], 18);
+            for (auto v : m_v) {
+                h ^= round(0, v);
+                h = h * P1 + P4;
+            }
+        } else {
+            h = P5;
+        }
+        h += m_total;
+
+        const uint8_t *p = m_buf;
+        size_t len = m_size;
+        for (; len >= 8; p += 8, len -= 8) {
+            h ^= round(0, qFromLittleEndian<quint64>(p));
+            h = rotl(h, 27) * P1 + P4;
+        }
+        if (len >= 4) {
+            h ^= quint64(qFromLittleEndian<quint32>(p)) * P1;
+            h = rotl(h, 23) * P2 + P3;
+            p += 4;
+            len -= 4;
+        }
+        for (; len > 0; ++p, --len) {
+            h ^= *p * P5;
+            h = rotl(h, 11) * P1;
+        }
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static const quint64 P1 = 11400714785074694791ULL;
+    static const quint64 P2 = 14029467366897019727ULL;
+    static const quint64 P3 = 1609587929392839161ULL;
+    static const quint64 P4 = 9650029242287828579ULL;
+    static const quint64 P5 = 2870177450012600261ULL;
+
+    static quint64 rotl(quint64 x, int r) { return (x << r) | (x >> (64 - r)); }
+    static quint64 round(quint64 acc, quint64 input)
+    {
+        acc += input * P2;
+        return rotl(acc, 31) * P1;
+    }
+
+    void stripe(const uint8_t *p)
+    {
+        for (int i = 0; i < 4; ++i)
+            m_v[i] = round(m_v[i], qFromLittleEndian<quint64>(p + i * 8));
+    }
+
+    quint64 m_v[4] = { P1 + P2, P2, 0, 0 - P1 };
+    quint64 m_total = 0;
+    uint8_t m_buf[32];
+    size_t m_size = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif
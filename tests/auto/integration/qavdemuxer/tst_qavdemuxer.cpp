@@ -7,14 +7,20 @@
 
 #include "qavdemuxer_p.h"
 #include "qavmuxer_p.h"
+#include "qavsegmentdecoder_p.h"
 #include "qavaudioframe.h"
 #include "qavvideoframe.h"
 #include "qaviodevice.h"
 #include "qavvideocodec_p.h"
 #include "qavaudiocodec_p.h"
+#include "qavpool_p.h"
+#include "qavbufferpool_p.h"
+#include "qavxxh64_p.h"
 
 #include <QDebug>
 #include <QtTest/QtTest>
+#include <cstdlib>
+#include <new>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -26,6 +32,27 @@ extern "C" {
 
 QT_USE_NAMESPACE
 
+// Counts heap allocations of the current thread
+static thread_local qint64 heapAllocations = 0;
+
+void *operator new(std::size_t size)
+{
+    ++heapAllocations;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
 class tst_QAVDemuxer : public QObject
 {
     Q_OBJECT
@@ -44,6 +71,14 @@ private slots:
     void muxerWrite();
     void muxerWriteSubtitles();
     void muxerEnqueue();
+    void segmentDecoder();
+    void autoSelectVideoCodec();
+    void variants();
+    void allocations();
+    void pool();
+    void frameBufferPool();
+    void routing();
+    void xxh64();
 };
 
 void tst_QAVDemuxer::construction()
@@ -533,5 +568,421 @@ void tst_QAVDemuxer::muxerEnqueue()
     QVERIFY(d.load("colors.mkv") >= 0);
 }
 
+void tst_QAVDemuxer::segmentDecoder()
+{
+    QFileInfo file(testData("colors.mp4"));
+    QAVDemuxer d;
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    const int videoIndex = d.currentVideoStreams().first().index();
+
+    QList<double> videoPts;
+    QList<double> audioPts;
+    QAVPacket p;
+    while ((p = d.read())) {
+        QList<QAVFrame> fs;
+        d.decode(p, fs);
+        for (const auto &f : fs)
+            (f.stream().index() == videoIndex ? videoPts : audioPts).push_back(f.pts());
+    }
+    for (const auto &stream : d.currentVideoStreams() + d.currentAudioStreams()) {
+        QAVPacket flush;
+        flush.setStream(stream);
+        QList<QAVFrame> fs;
+        d.decode(flush, fs);
+        for (const auto &f : fs)
+            (f.stream().index() == videoIndex ? videoPts : audioPts).push_back(f.pts());
+    }
+    QVERIFY(!videoPts.isEmpty());
+    QVERIFY(!audioPts.isEmpty());
+
+    QAVSegmentDecoder s;
+    s.setThreadCount(4);
+    QCOMPARE(s.threadCount(), 4);
+    QVERIFY(s.load(file.absoluteFilePath()) >= 0);
+    const auto segments = s.segments();
+    QVERIFY(!segments.isEmpty());
+    QCOMPARE(segments.first(), 0.0);
+    for (int i = 1; i < segments.size(); ++i)
+        QVERIFY(segments[i - 1] < segments[i]);
+
+    QList<double> segmentVideoPts;
+    QList<double> segmentAudioPts;
+    QVERIFY(s.run([&](const QAVFrame &f) {
+        (f.stream().index() == videoIndex ? segmentVideoPts : segmentAudioPts).push_back(f.pts());
+    }) >= 0);
+    QCOMPARE(segmentVideoPts.size(), videoPts.size());
+    for (int i = 1; i < segmentVideoPts.size(); ++i)
+        QVERIFY(segmentVideoPts[i - 1] < segmentVideoPts[i]);
+    QCOMPARE(segmentAudioPts, audioPts);
+
+    QAVMuxer m;
+    QVERIFY(s.load(file.absoluteFilePath()) >= 0);
+    s.setFilters({"negate"});
+    QVERIFY(m.load(s.availableStreams(), "colors_segments.mkv") >= 0);
+    QVERIFY(s.run(m) >= 0);
+    m.unload();
+    s.unload();
+    QVERIFY(d.load("colors_segments.mkv") >= 0);
+}
+
+void tst_QAVDemuxer::autoSelectVideoCodec()
+{
+    QFileInfo file(testData("colors.mp4"));
+    auto read = [&](bool autoSelect, QList<double> &pts, QString &codec) {
+        QAVDemuxer d;
+        d.setAutoSelectVideoCodec(autoSelect);
+        QCOMPARE(d.autoSelectVideoCodec(), autoSelect);
+        QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+        codec = QLatin1String(d.currentVideoStreams().first().codec()->codec()->name);
+        QAVPacket p;
+        while ((p = d.read()))
+            pts.push_back(p.pts());
+    };
+
+    QList<double> expected;
+    QString expectedCodec;
+    read(false, expected, expectedCodec);
+    QVERIFY(!expected.isEmpty());
+
+    // Packets read for the trial decoding are not lost
+    QList<double> pts;
+    QString codec;
+    read(true, pts, codec);
+    QCOMPARE(pts, expected);
+    QVERIFY(QAVDemuxer::supportedVideoCodecs().contains(codec));
+    QCOMPARE(avcodec_find_decoder_by_name(codec.toLatin1().constData())->id,
+             avcodec_find_decoder_by_name(expectedCodec.toLatin1().constData())->id);
+
+    // Same decoder is used from the cache
+    QList<double> cachedPts;
+    QString cachedCodec;
+    read(true, cachedPts, cachedCodec);
+    QCOMPARE(cachedCodec, codec);
+    QCOMPARE(cachedPts, expected);
+}
+
+void tst_QAVDemuxer::variants()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto write = [&](const QString &name, const QByteArray &data) {
+        QFile f(dir.filePath(name));
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write(data);
+    };
+    const QByteArray segment = QFileInfo(testData("star_trails.mpeg")).absoluteFilePath().toUtf8();
+    const QByteArray media = "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:10\n"
+                             "#EXTINF:10.0,\n" + segment + "\n#EXT-X-ENDLIST\n";
+    write("low.m3u8", media);
+    write("high.m3u8", media);
+    write("master.m3u8", "#EXTM3U\n"
+                         "#EXT-X-STREAM-INF:BANDWIDTH=3000000,RESOLUTION=1280x720\nhigh.m3u8\n"
+                         "#EXT-X-STREAM-INF:BANDWIDTH=1000000,RESOLUTION=640x360\nlow.m3u8\n");
+
+    QAVDemuxer d;
+    QVERIFY(d.variants().isEmpty());
+    QCOMPARE(d.currentVariant(), -1);
+    d.setMaxBandwidth(1500000);
+    QCOMPARE(d.maxBandwidth(), qint64(1500000));
+    QVERIFY(d.load(dir.filePath("master.m3u8")) >= 0);
+
+    const auto variants = d.variants();
+    QCOMPARE(variants.size(), 2);
+    const int current = d.currentVariant();
+    QVERIFY(current >= 0);
+    QCOMPARE(variants[current].bandwidth, qint64(1000000));
+    const int other = current == 0 ? 1 : 0;
+    QCOMPARE(variants[other].bandwidth, qint64(3000000));
+
+    auto isCurrent = [&](int variant) {
+        const auto streams = d.currentVideoStreams() + d.currentAudioStreams();
+        if (streams.isEmpty())
+            return false;
+        for (const auto &s : streams) {
+            if (!variants[variant].streams.contains(s.index()))
+                return false;
+        }
+        return true;
+    };
+    QVERIFY(isCurrent(current));
+    for (int i : variants[other].streams)
+        QCOMPARE(d.avctx()->streams[i]->discard, AVDISCARD_ALL);
+    for (int i : variants[current].streams)
+        QCOMPARE(d.avctx()->streams[i]->discard, AVDISCARD_DEFAULT);
+
+    QAVPacket p;
+    for (int i = 0; i < 10 && (p = d.read()); ++i)
+        QVERIFY(variants[current].streams.contains(p.packet()->stream_index));
+
+    // Switches without reloading
+    QVERIFY(!d.setVariant(2));
+    QVERIFY(d.setVariant(other));
+    QCOMPARE(d.currentVariant(), other);
+    QVERIFY(isCurrent(other));
+    for (int i : variants[current].streams)
+        QCOMPARE(d.avctx()->streams[i]->discard, AVDISCARD_ALL);
+
+    bool switched = false;
+    while (!switched && (p = d.read()))
+        switched = variants[other].streams.contains(p.packet()->stream_index);
+    QVERIFY(switched);
+
+    // Selecting a stream of another variant switches to it
+    QList<QAVStream> videoStreams;
+    for (const auto &s : d.availableVideoStreams()) {
+        if (variants[current].streams.contains(s.index()))
+            videoStreams.push_back(s);
+    }
+    QVERIFY(!videoStreams.isEmpty());
+    QVERIFY(d.setVideoStreams(videoStreams));
+    QCOMPARE(d.currentVariant(), current);
+    QCOMPARE(d.currentVideoStreams(), videoStreams);
+    for (int i : variants[current].streams)
+        QCOMPARE(d.avctx()->streams[i]->discard, AVDISCARD_DEFAULT);
+    for (int i : variants[other].streams)
+        QCOMPARE(d.avctx()->streams[i]->discard, AVDISCARD_ALL);
+
+    // Lowest variant is used if none fits
+    d.unload();
+    d.setMaxBandwidth(0);
+    d.setMaxResolution({1, 1});
+    QVERIFY(d.load(dir.filePath("master.m3u8")) >= 0);
+    QCOMPARE(d.variants()[d.currentVariant()].bandwidth, qint64(1000000));
+}
+
+void tst_QAVDemuxer::allocations()
+{
+    QAVDemuxer d;
+    QFileInfo file(testData("colors.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+
+    int count = 0;
+    qint64 copies = 0;
+    qint64 moves = 0;
+    qint64 packetMoves = 0;
+    qint64 streamCopies = 0;
+    QAVFrame last;
+    QAVPacket p;
+    while (count < 50 && (p = d.read())) {
+        qint64 start = heapAllocations;
+        QAVPacket movedPacket(std::move(p));
+        p = std::move(movedPacket);
+        packetMoves += heapAllocations - start;
+
+        start = heapAllocations;
+        QAVStream stream = p.stream();
+        stream = p.stream();
+        streamCopies += heapAllocations - start;
+
+        QList<QAVFrame> frames;
+        d.decode(p, frames);
+        for (const auto &frame : frames) {
+            if (!frame)
+                continue;
+            QAVFrame copied;
+            QAVFrame moved;
+
+            // Every hop of the pipeline before
+            start = heapAllocations;
+            QAVFrame copy(frame);
+            copied = copy;
+            copies += heapAllocations - start;
+
+            // And after
+            start = heapAllocations;
+            QAVFrame tmp(std::move(copy));
+            moved = std::move(tmp);
+            moves += heapAllocations - start;
+
+            QVERIFY(moved);
+            QCOMPARE(moved.pts(), frame.pts());
+            QCOMPARE(moved.stream().index(), frame.stream().index());
+            if (frame.stream().stream()->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+                last = frame;
+            ++count;
+        }
+    }
+
+    QVERIFY(count > 0);
+    qDebug() << "Allocations per decoded frame: copy" << double(copies) / count << "move" << double(moves) / count;
+    // Copies reuse the pooled privates
+    QCOMPARE(moves, 0);
+    QCOMPARE(packetMoves, 0);
+    QCOMPARE(streamCopies, 0);
+
+    // Moved-from frames are empty and could be used again
+    QAVVideoFrame video = last;
+    QVERIFY(video);
+    QAVVideoFrame taken(std::move(video));
+    QVERIFY(taken);
+    QVERIFY(!video);
+    QAVVideoFrame copy(video);
+    QVERIFY(!copy);
+    auto &self = taken;
+    taken = std::move(self);
+    QVERIFY(taken);
+    QCOMPARE(taken.size(), QSize(160, 120));
+    video = std::move(taken);
+    QVERIFY(video);
+    QVERIFY(!taken);
+    taken = video;
+    QVERIFY(taken);
+}
+
+void tst_QAVDemuxer::pool()
+{
+    QAVDemuxer d;
+    QFileInfo file(testData("colors.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+
+    auto decode = [&](int count) {
+        int frames = 0;
+        QAVPacket p;
+        while (frames < count && (p = d.read())) {
+            QList<QAVFrame> decoded;
+            d.decode(p, decoded);
+            for (const auto &frame : decoded) {
+                if (!frame)
+                    continue;
+                if (frame.stream().stream()->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+                    QAVVideoFrame video = frame;
+                    video.map();
+                }
+                ++frames;
+            }
+        }
+        return frames;
+    };
+
+    // Fills the free lists
+    QCOMPARE(decode(50), 50);
+    const auto before = QAVPool::instance().stats();
+    QVERIFY(before.pooled > 0);
+
+    // Steady state does not allocate the wrappers
+    QCOMPARE(decode(100), 100);
+    const auto after = QAVPool::instance().stats();
+    QCOMPARE(after.heapAllocations, before.heapAllocations);
+    QVERIFY(after.reused > before.reused);
+}
+
+void tst_QAVDemuxer::frameBufferPool()
+{
+    auto &pool = QAVBufferPool::instance();
+    QAVDemuxer d;
+    QFileInfo file(testData("colors.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+
+    auto decode = [&](int count) {
+        int frames = 0;
+        QAVPacket p;
+        while (frames < count && (p = d.read())) {
+            QList<QAVFrame> decoded;
+            d.decode(p, decoded);
+            for (const auto &frame : decoded) {
+                if (frame)
+                    ++frames;
+            }
+        }
+        return frames;
+    };
+
+    QCOMPARE(decode(150), 150);
+    const auto before = pool.stats();
+    QVERIFY(before.allocatedBytes > 0);
+    QVERIFY(before.usedBytes <= before.allocatedBytes);
+
+    // Buffers of released frames are reused
+    QCOMPARE(decode(150), 150);
+    const auto after = pool.stats();
+    QVERIFY(after.hits > before.hits);
+    QCOMPARE(after.misses, before.misses);
+
+    // Does not grow over the cap
+    pool.setCap(after.allocatedBytes);
+    QCOMPARE(pool.cap(), after.allocatedBytes);
+    QVERIFY(decode(50) > 0);
+    QVERIFY(pool.stats().allocatedBytes <= after.allocatedBytes);
+    QCOMPARE(pool.stats().failures, after.failures);
+
+    // Decoders wait for released frames before they are fed
+    QList<QAVFrame> held;
+    QAVPacket p;
+    while (held.isEmpty() && (p = d.read()))
+        d.decode(p, held);
+    QVERIFY(!held.isEmpty());
+    pool.setCap(pool.stats().usedBytes);
+    QVERIFY(pool.exhausted());
+    const auto waits = pool.stats().waits;
+    QVERIFY(!pool.waitForRelease(10));
+    QCOMPARE(pool.stats().waits, waits + 1);
+    held.clear();
+    d.flushCodecBuffers();
+    QVERIFY(!pool.exhausted());
+    QVERIFY(pool.waitForRelease(10));
+    pool.setCap(0);
+}
+
+void tst_QAVDemuxer::routing()
+{
+    QAVDemuxer d;
+    QVERIFY(d.routing());
+    QCOMPARE(d.routing()->firstVideo, -1);
+    QCOMPARE(d.routing()->firstAudio, -1);
+
+    QFileInfo file(testData("colors.mp4"));
+    QVERIFY(d.load(file.absoluteFilePath()) >= 0);
+    QCOMPARE(d.availableVideoStreams().size(), 1);
+    QCOMPARE(d.availableAudioStreams().size(), 1);
+    const int video = d.availableVideoStreams().first().index();
+    const int audio = d.availableAudioStreams().first().index();
+
+    const auto loaded = d.routing();
+    QCOMPARE(loaded->firstVideo, video);
+    QCOMPARE(loaded->firstAudio, audio);
+    QCOMPARE(loaded->firstSubtitle, -1);
+    QCOMPARE(loaded->type(video), AVMEDIA_TYPE_VIDEO);
+    QCOMPARE(loaded->type(audio), AVMEDIA_TYPE_AUDIO);
+    QVERIFY(loaded->isMaster(video));
+    QVERIFY(!loaded->isMaster(audio));
+    QCOMPARE(d.currentCodecType(audio), AVMEDIA_TYPE_AUDIO);
+
+    // Changing the selection replaces the snapshot
+    QVERIFY(d.setVideoStreams({}));
+    const auto audioOnly = d.routing();
+    QVERIFY(audioOnly != loaded);
+    QCOMPARE(audioOnly->firstVideo, -1);
+    QCOMPARE(audioOnly->type(video), AVMEDIA_TYPE_UNKNOWN);
+    QVERIFY(audioOnly->isMaster(audio));
+    QCOMPARE(d.currentCodecType(video), AVMEDIA_TYPE_UNKNOWN);
+    QVERIFY(d.isMasterStream(d.availableAudioStreams().first()));
+
+    // Readers keep the old snapshot unchanged
+    QCOMPARE(loaded->firstVideo, video);
+    QCOMPARE(loaded->type(video), AVMEDIA_TYPE_VIDEO);
+
+    d.unload();
+    QCOMPARE(d.routing()->firstAudio, -1);
+    QCOMPARE(audioOnly->firstAudio, audio);
+}
+
+void tst_QAVDemuxer::xxh64()
+{
+    auto digest = [](const QByteArray &data, int chunk) {
+        QAVXXH64 h;
+        for (int i = 0; i < data.size(); i += chunk)
+            h.update(reinterpret_cast<const uint8_t *>(data.constData()) + i, size_t(qMin(chunk, data.size() - i)));
+        return h.digest();
+    };
+
+    QCOMPARE(QAVXXH64().digest(), Q_UINT64_C(0xef46db3751d8e999));
+    QCOMPARE(digest("a", 1), Q_UINT64_C(0xd24ec4f1a98c6e5b));
+    QCOMPARE(digest("abc", 3), Q_UINT64_C(0x44bc2cf5ad770999));
+    // Longer than a stripe, also fed in parts
+    const QByteArray text = "Nobody inspects the spammish repetition";
+    QCOMPARE(digest(text, text.size()), Q_UINT64_C(0xfbcea83c8a378bf1));
+    QCOMPARE(digest(text, 5), Q_UINT64_C(0xfbcea83c8a378bf1));
+}
+
 QTEST_MAIN(tst_QAVDemuxer)
 #include "tst_qavdemuxer.moc"
@@ -8,12 +8,18 @@
 #include "qavplayer.h"
 #include "qavaudiooutput.h"
 #include "qaviodevice.h"
+#include "qavthumbnailer.h"
+#include "qavwaveform.h"
+#include "qavpacketanalyzer.h"
+#include "qavframeverifier.h"
+#include "qavvideoconverter.h"
 
 #include <QDebug>
 #include <QtTest/QtTest>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
 }
 
 #ifndef TEST_DATA_DIR
@@ -105,6 +111,26 @@ private slots:
     void streamMetadataRotate();
     void switchingSource();
     void outputFile();
+    void posterFrame();
+    void loadTimings();
+    void multipleVideoStreamsThreads();
+    void intraOnlyDecoders();
+    void thumbnailer();
+    void waveform();
+    void decoderThreadBudget();
+    void packetAnalyzer();
+    void frameVerifier();
+    void videoSideData();
+    void memoryBudget();
+    void bufferingPolicy();
+    void allocations();
+    void hibernate();
+    void cropped();
+    void audioSamples();
+    void videoConverter();
+    void filterResolutionChange();
+    void frameVerifierInterleaving();
+    void switchVideoStreamsThreads();
 };
 
 void tst_QAVPlayer::initTestCase()
@@ -3490,5 +3516,1083 @@ void tst_QAVPlayer::outputFile()
     QTRY_VERIFY(p.mediaStatus() == QAVPlayer::EndOfMedia);
 }
 
+void tst_QAVPlayer::posterFrame()
+{
+    QAVPlayer p;
+    QAVVideoFrame frame;
+    int framesCount = 0;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &f) { frame = f; ++framesCount; }, Qt::DirectConnection);
+    QSignalSpy spy(&p, &QAVPlayer::posterFrameEnabledChanged);
+
+    QVERIFY(!p.isPosterFrameEnabled());
+    p.setPosterFrameEnabled(true);
+    QVERIFY(p.isPosterFrameEnabled());
+    p.setPosterFrameEnabled(true);
+    QCOMPARE(spy.count(), 1);
+
+    QFileInfo file(testData("colors.mp4"));
+    p.setSource(file.absoluteFilePath());
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::LoadedMedia);
+    QCOMPARE(p.state(), QAVPlayer::StoppedState);
+    QCOMPARE(framesCount, 1);
+    QVERIFY(frame);
+    QCOMPARE(frame.size(), QSize(160, 120));
+    QCOMPARE(frame.pts(), 0.0);
+    QCOMPARE(p.position(), 0);
+
+    // Packets read for the poster are played again
+    p.setSynced(false);
+    p.play();
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+    QVERIFY(framesCount > 1);
+
+    // Attached picture
+    framesCount = 0;
+    frame = {};
+    p.setSource(QFileInfo(testData("test.mp3")).absoluteFilePath());
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::LoadedMedia);
+    QCOMPARE(framesCount, 1);
+    QVERIFY(frame);
+
+    framesCount = 0;
+    p.setPosterFrameEnabled(false);
+    p.setSource(file.absoluteFilePath());
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::LoadedMedia);
+    QTest::qWait(100);
+    QCOMPARE(framesCount, 0);
+}
+
+void tst_QAVPlayer::loadTimings()
+{
+    QAVPlayer p;
+    QSignalSpy spy(&p, &QAVPlayer::loadTimingsChanged);
+    QCOMPARE(p.loadTimings().openInput, -1);
+    QCOMPARE(p.loadTimings().firstFrame, -1);
+
+    QFileInfo file(testData("colors.mp4"));
+    p.setSource(file.absoluteFilePath());
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::LoadedMedia);
+    auto t = p.loadTimings();
+    QVERIFY(t.openInput >= 0);
+    QVERIFY(t.findStreamInfo >= 0);
+    QCOMPARE(t.codecOpen.size(), 2);
+    QCOMPARE(t.openMuxer, -1);
+    QCOMPARE(t.firstFrame, -1);
+    QCOMPARE(spy.count(), 0);
+
+    p.play();
+    QTRY_COMPARE(spy.count(), 1);
+    t = spy.at(0).at(0).value<QAVPlayer::LoadTimings>();
+    QVERIFY(t.firstPacket >= 0);
+    QVERIFY(t.firstDecodedFrame >= t.firstPacket);
+    QVERIFY(t.firstFrame >= t.firstDecodedFrame);
+    QVERIFY(t.firstFrame >= t.openInput + t.findStreamInfo);
+    QCOMPARE(p.loadTimings().firstFrame, t.firstFrame);
+
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+    QCOMPARE(spy.count(), 1);
+
+    // Output set after loading is not a part of the load
+    p.setOutput("output.mkv");
+    QCOMPARE(p.loadTimings().openMuxer, -1);
+    p.setOutput({});
+
+    p.setSource({});
+    QCOMPARE(p.loadTimings().openInput, -1);
+    QCOMPARE(p.loadTimings().firstFrame, -1);
+
+    // Poster frame reads the first packets while loading
+    p.setPosterFrameEnabled(true);
+    p.setSource(file.absoluteFilePath());
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::LoadedMedia);
+    t = p.loadTimings();
+    QVERIFY(t.firstPacket >= 0);
+    QVERIFY(t.firstDecodedFrame >= t.firstPacket);
+    // Poster frame is the first emitted frame
+    QVERIFY(t.firstFrame >= t.firstDecodedFrame);
+    QTRY_COMPARE(spy.count(), 2);
+}
+
+void tst_QAVPlayer::multipleVideoStreamsThreads()
+{
+    QAVPlayer p;
+    QFileInfo file(testData("7_BCL02006_ffv1_20s_1.mkv"));
+
+    QMutex mutex;
+    QMap<int, QSet<QThread *>> threads;
+    QMap<int, int> framesCount;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &f) {
+        QMutexLocker locker(&mutex);
+        threads[f.stream().index()].insert(QThread::currentThread());
+        framesCount[f.stream().index()]++;
+    }, Qt::DirectConnection);
+
+    p.setSource(file.absoluteFilePath());
+    p.setSynced(false);
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::LoadedMedia);
+    p.setVideoStreams(p.availableVideoStreams());
+    p.play();
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::EndOfMedia);
+
+    QMutexLocker locker(&mutex);
+    QCOMPARE(threads.size(), 4);
+    QCOMPARE(framesCount[0], 599);
+    // Each stream is decoded on own thread
+    QSet<QThread *> all;
+    for (const auto &t : threads) {
+        QCOMPARE(t.size(), 1);
+        all.unite(t);
+    }
+    QCOMPARE(all.size(), 4);
+    QVERIFY(!all.contains(QThread::currentThread()));
+}
+
+void tst_QAVPlayer::intraOnlyDecoders()
+{
+    QFileInfo file(testData("7_BCL02006_ffv1_20s_1.mkv"));
+
+    auto decode = [&](int decoders, QList<double> &pts) {
+        QAVPlayer p;
+        QSignalSpy spy(&p, &QAVPlayer::intraOnlyDecodersChanged);
+        p.setIntraOnlyDecoders(decoders);
+        p.setIntraOnlyDecoders(decoders);
+        QCOMPARE(spy.count(), decoders ? 1 : 0);
+        QCOMPARE(p.intraOnlyDecoders(), decoders);
+
+        QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &f) { pts.push_back(f.pts()); });
+        p.setSource(file.absoluteFilePath());
+        p.setSynced(false);
+        p.play();
+        QTRY_COMPARE_WITH_TIMEOUT(p.mediaStatus(), QAVPlayer::EndOfMedia, 20000);
+    };
+
+    QList<double> expected;
+    decode(0, expected);
+    QCOMPARE(expected.size(), 599);
+    QList<double> pts;
+    decode(4, pts);
+    QCOMPARE(pts, expected);
+    for (int i = 1; i < pts.size(); ++i)
+        QVERIFY(pts[i - 1] < pts[i]);
+}
+
+void tst_QAVPlayer::thumbnailer()
+{
+    QFileInfo file(testData("colors.mp4"));
+    QAVThumbnailer t;
+    QSignalSpy spySource(&t, &QAVThumbnailer::sourceChanged);
+    QSignalSpy spyReady(&t, &QAVThumbnailer::thumbnailReady);
+    t.setSource(file.absoluteFilePath());
+    t.setSource(file.absoluteFilePath());
+    QCOMPARE(spySource.count(), 1);
+    t.setThreadCount(3);
+    QCOMPARE(t.threadCount(), 3);
+
+    const QList<qint64> positions = {0, 2000, 5000, 10000, 14000};
+    auto futures = t.request(positions, QSize(80, 80));
+    QCOMPARE(futures.size(), positions.size());
+    for (auto &f : futures) {
+        f.waitForFinished();
+        auto frame = f.result();
+        QVERIFY(frame);
+        QCOMPARE(frame.size(), QSize(80, 60));
+        QCOMPARE(frame.format(), AV_PIX_FMT_RGB32);
+    }
+    QTRY_COMPARE(spyReady.count(), positions.size());
+
+    futures = t.request(positions, QSize(40, 30), QAVThumbnailer::ExactFrame, AV_PIX_FMT_YUV420P);
+    for (int i = 0; i < futures.size(); ++i) {
+        futures[i].waitForFinished();
+        auto frame = futures[i].result();
+        QVERIFY(frame);
+        QCOMPARE(frame.size(), QSize(40, 30));
+        QVERIFY(qAbs(frame.pts() - positions[i] / 1000.0) < 0.1);
+    }
+
+    // Cancelled requests return empty frames
+    spyReady.clear();
+    QList<qint64> many;
+    for (int i = 0; i < 100; ++i)
+        many.push_back(i * 150);
+    auto cancelled = t.request(many, QSize(80, 60), QAVThumbnailer::ExactFrame);
+    t.cancel();
+    int empty = 0;
+    for (auto &f : cancelled) {
+        f.waitForFinished();
+        if (!f.result())
+            ++empty;
+    }
+    QVERIFY(empty > 0);
+    QCOMPARE(spyReady.count(), many.size() - empty);
+}
+
+void tst_QAVPlayer::waveform()
+{
+    QFileInfo file(testData("colors.mp4"));
+    QTemporaryDir dir;
+    QAVWaveform w;
+    w.setCacheDir(dir.path());
+    w.setSamplesPerBucket(512);
+    QCOMPARE(w.samplesPerBucket(), 512);
+    QCOMPARE(w.load(file.absoluteFilePath()), 0);
+    QVERIFY(!w.isCached());
+    QVERIFY(w.sampleRate() > 0);
+    QVERIFY(w.channels() > 0);
+    QVERIFY(w.levels() > 1);
+    QCOMPARE(w.bucketDuration(1), w.bucketDuration(0) * 2);
+
+    const auto peaks = w.peaks(0, 0);
+    QVERIFY(qAbs(peaks.size() - 15.0 / w.bucketDuration(0)) < 50);
+    for (const auto &peak : peaks) {
+        QVERIFY(peak.min <= peak.max);
+        QVERIFY(peak.min >= -1.0f && peak.max <= 1.0f);
+        QVERIFY(peak.rms >= 0.0f && peak.rms <= 1.0f);
+    }
+    QCOMPARE(w.peaks(w.levels() - 1, 0).size(), 1);
+    QVERIFY(w.peaks(w.levels(), 0).isEmpty());
+    QCOMPARE(w.level(15, 10000), 0);
+    QVERIFY(w.peaks(w.level(15, 100), 0).size() <= 100);
+
+    QAVWaveform cached;
+    cached.setCacheDir(dir.path());
+    cached.setSamplesPerBucket(512);
+    QCOMPARE(cached.load(file.absoluteFilePath()), 0);
+    QVERIFY(cached.isCached());
+    QCOMPARE(cached.levels(), w.levels());
+    QCOMPARE(cached.sampleRate(), w.sampleRate());
+    const auto cachedPeaks = cached.peaks(0, 0);
+    QCOMPARE(cachedPeaks.size(), peaks.size());
+    for (int i = 0; i < peaks.size(); ++i) {
+        QCOMPARE(cachedPeaks[i].min, peaks[i].min);
+        QCOMPARE(cachedPeaks[i].max, peaks[i].max);
+    }
+
+    QAVWaveform single;
+    single.setCacheDir({});
+    single.setThreadCount(1);
+    single.setSamplesPerBucket(512);
+    QCOMPARE(single.load(file.absoluteFilePath()), 0);
+    QVERIFY(!single.isCached());
+    QCOMPARE(single.peaks(0, 0).size(), peaks.size());
+
+    QAVWaveform noAudio;
+    noAudio.setCacheDir({});
+    QVERIFY(noAudio.load(testData("7_BCL02006_ffv1_20s_1.mkv")) < 0);
+}
+
+void tst_QAVPlayer::decoderThreadBudget()
+{
+    QFileInfo file(testData("colors.mp4"));
+    const int budget = QAVPlayer::decoderThreadBudget();
+    QAVPlayer::setDecoderThreadBudget(4);
+    QCOMPARE(QAVPlayer::decoderThreadBudget(), 4);
+
+    auto threads = [](const QAVPlayer &p) {
+        return p.progress(p.currentVideoStreams().first()).decoderThreads();
+    };
+
+    {
+        QAVPlayer p1;
+        QSignalSpy spy(&p1, &QAVPlayer::decoderPriorityChanged);
+        p1.setDecoderPriority(1);
+        QCOMPARE(spy.count(), 0);
+        p1.setSource(file.absoluteFilePath());
+        QTRY_COMPARE(p1.mediaStatus(), QAVPlayer::LoadedMedia);
+        QCOMPARE(threads(p1), 4);
+        QVERIFY(p1.progress(p1.currentVideoStreams().first()).isFrameThreading());
+
+        // New decoder gets its share, the opened one is reopened at the next keyframe
+        QAVPlayer p2;
+        p2.setDecoderPriority(3);
+        QCOMPARE(spy.count(), 0);
+        QCOMPARE(p2.decoderPriority(), 3);
+        p2.setSource(file.absoluteFilePath());
+        QTRY_COMPARE(p2.mediaStatus(), QAVPlayer::LoadedMedia);
+        QCOMPARE(threads(p2), 3);
+        QCOMPARE(threads(p1), 4);
+        // The shares are settled before reopening
+        QTest::qWait(600);
+
+        auto play = [](QAVPlayer &p) {
+            int frames = 0;
+            QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &) { ++frames; }, Qt::DirectConnection);
+            p.setSynced(false);
+            p.play();
+            [&] { QTRY_COMPARE_WITH_TIMEOUT(p.mediaStatus(), QAVPlayer::EndOfMedia, 15000); }();
+            return frames;
+        };
+        const int frames = play(p1);
+        QCOMPARE(threads(p1), 1);
+        // Delayed frames are drained before reopening
+        QVERIFY(frames > 0);
+        QCOMPARE(play(p2), frames);
+        QCOMPARE(threads(p2), 3);
+    }
+
+    {
+        QAVPlayer p1;
+        p1.setDecoderPriority(3);
+        p1.setSource(file.absoluteFilePath());
+        QTRY_COMPARE(p1.mediaStatus(), QAVPlayer::LoadedMedia);
+        QCOMPARE(threads(p1), 4);
+
+        // Shared by priority
+        QAVPlayer p2;
+        p2.setSource(file.absoluteFilePath());
+        QTRY_COMPARE(p2.mediaStatus(), QAVPlayer::LoadedMedia);
+        QCOMPARE(threads(p2), 1);
+
+        p1.setSource({});
+        QTRY_COMPARE(p1.mediaStatus(), QAVPlayer::NoMedia);
+        QAVPlayer p3;
+        p3.setSource(file.absoluteFilePath());
+        QTRY_COMPARE(p3.mediaStatus(), QAVPlayer::LoadedMedia);
+        QCOMPARE(threads(p3), 2);
+    }
+
+    {
+        QAVPlayer::setDecoderThreadBudget(8);
+        QAVPlayer p1;
+        p1.setSource(file.absoluteFilePath());
+        p1.play();
+        QTRY_COMPARE(p1.mediaStatus(), QAVPlayer::LoadedMedia);
+        QCOMPARE(threads(p1), 8);
+
+        // Players started together change the share of the running decoder several times
+        QList<QAVPlayer *> players;
+        for (int i = 0; i < 3; ++i) {
+            auto p = new QAVPlayer(&p1);
+            p->setSource(file.absoluteFilePath());
+            players.push_back(p);
+        }
+        for (auto p : players)
+            QTRY_COMPARE(p->mediaStatus(), QAVPlayer::LoadedMedia);
+
+        // Reopened once with the settled share
+        QList<int> history = {threads(p1)};
+        QElapsedTimer timer;
+        timer.start();
+        while (timer.elapsed() < 3000) {
+            QTest::qWait(10);
+            const int t = threads(p1);
+            if (t != history.last())
+                history.push_back(t);
+        }
+        QCOMPARE(history, QList<int>({8, 2}));
+        QCOMPARE(p1.state(), QAVPlayer::PlayingState);
+    }
+
+    QAVPlayer::setDecoderThreadBudget(budget);
+}
+
+void tst_QAVPlayer::packetAnalyzer()
+{
+    QFileInfo file(testData("colors.mp4"));
+    QAVPacketAnalyzer a;
+    a.setSource(file.absoluteFilePath());
+    QCOMPARE(a.source(), file.absoluteFilePath());
+    a.setWindow(2.0);
+    QCOMPARE(a.window(), 2.0);
+
+    QList<QAVPacketAnalyzer::Report> reports;
+    QAVPacketAnalyzer::Report summary;
+    QObject::connect(&a, &QAVPacketAnalyzer::report, &a, [&](const QAVPacketAnalyzer::Report &r) { reports.push_back(r); });
+    QObject::connect(&a, &QAVPacketAnalyzer::finished, &a, [&](const QAVPacketAnalyzer::Report &r) { summary = r; });
+    QCOMPARE(a.run(), 0);
+
+    QCOMPARE(summary.streams.size(), 2);
+    QVERIFY(qAbs(summary.end - 15) < 1);
+    QVERIFY(reports.size() >= 7 && reports.size() <= 9);
+    for (int i = 1; i < reports.size(); ++i)
+        QVERIFY(reports[i - 1].end <= reports[i].start);
+
+    for (int s = 0; s < summary.streams.size(); ++s) {
+        const auto &stats = summary.streams[s];
+        QCOMPARE(stats.index, s);
+        QVERIFY(stats.packets > 0);
+        QVERIFY(stats.bitrate > 0);
+        QVERIFY(stats.minSize > 0 && stats.minSize <= stats.maxSize);
+        QCOMPARE(stats.discontinuities, 0);
+        QCOMPARE(stats.missingTimestamps, 0);
+        qint64 packets = 0;
+        qint64 bytes = 0;
+        for (const auto &r : reports) {
+            packets += r.streams[s].packets;
+            bytes += r.streams[s].bytes;
+        }
+        QCOMPARE(packets, stats.packets);
+        QCOMPARE(bytes, stats.bytes);
+        if (stats.type == AVMEDIA_TYPE_VIDEO) {
+            QCOMPARE(stats.packets, 375);
+            QVERIFY(stats.keyframes > 0);
+            QVERIFY(stats.minGop <= stats.avgGop && stats.avgGop <= stats.maxGop);
+        }
+    }
+    QVERIFY(summary.maxInterleaveSkew >= 0 && summary.maxInterleaveSkew < 5);
+}
+
+void tst_QAVPlayer::frameVerifier()
+{
+    QFileInfo file(testData("colors.mp4"));
+    QAVFrameVerifier v;
+    QCOMPARE(v.hash(), QAVFrameVerifier::MD5);
+    v.setThreadCount(4);
+    QCOMPARE(v.threadCount(), 4);
+
+    auto report = [&](QAVFrameVerifier::Hash hash) {
+        v.setHash(hash);
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        v.write(file.absoluteFilePath(), &buffer);
+        auto lines = QString::fromLatin1(buffer.data()).split(QLatin1Char('\n'));
+        lines.removeAll(QString());
+        return lines;
+    };
+
+    const auto md5 = report(QAVFrameVerifier::MD5);
+    QVERIFY(md5.contains("#hash: MD5"));
+    QVERIFY(md5.contains("#dimensions 0: 160x120"));
+    const auto video = md5.filter(QRegularExpression("^0, "));
+    QCOMPARE(video.size(), 375);
+    QVERIFY(!md5.filter(QRegularExpression("^1, ")).isEmpty());
+    // Decoded float samples are hashed as interleaved pcm
+    QVERIFY(md5.contains("#codec_id 1: pcm_f32le"));
+    QVERIFY(!md5.filter(QRegularExpression("^#channel_layout_name 1: ")).isEmpty());
+    for (const auto &line : video) {
+        const auto fields = line.split(QLatin1String(", "));
+        QCOMPARE(fields.size(), 6);
+        // 160x120 yuv420p
+        QCOMPARE(fields[4].trimmed().toInt(), 28800);
+        QCOMPARE(fields[5].size(), 32);
+    }
+    QCOMPARE(report(QAVFrameVerifier::MD5), md5);
+
+    const auto xxh = report(QAVFrameVerifier::XXH64);
+    QVERIFY(xxh.contains("#hash: XXH64"));
+    QCOMPARE(xxh.size(), md5.size());
+    QCOMPARE(xxh.filter(QRegularExpression("^0, ")).first().split(QLatin1String(", "))[5].size(), 16);
+
+    QAVFrameVerifier::Mismatch mismatch;
+    QCOMPARE(v.compare(file.absoluteFilePath(), file.absoluteFilePath(), &mismatch), 0);
+    QCOMPARE(mismatch.frame, -1);
+    QCOMPARE(v.compare(file.absoluteFilePath(), testData("small.mp4"), &mismatch), 1);
+    QVERIFY(mismatch.stream < 0 || mismatch.first != mismatch.second);
+}
+
+void tst_QAVPlayer::videoSideData()
+{
+    QFileInfo file(testData("colors.mp4"));
+    QAVPlayer p;
+    QSignalSpy spy(&p, &QAVPlayer::videoSideDataOnlyChanged);
+    p.setVideoSideDataOnly(true);
+    p.setVideoSideDataOnly(true);
+    QCOMPARE(spy.count(), 1);
+    QVERIFY(p.videoSideDataOnly());
+
+    int frames = 0;
+    int images = 0;
+    int withVectors = 0;
+    int withQp = 0;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &f) {
+        ++frames;
+        if (f)
+            ++images;
+        if (f.size() != QSize(160, 120))
+            return;
+        auto mvs = f.motionVectors();
+        if (mvs.size > 0 && mvs[0].source != 0)
+            ++withVectors;
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 42, 100)
+        if (f.encodeParams())
+            ++withQp;
+#endif
+    });
+    p.setSource(file.absoluteFilePath());
+    p.setSynced(false);
+    p.play();
+    QTRY_COMPARE_WITH_TIMEOUT(p.mediaStatus(), QAVPlayer::EndOfMedia, 15000);
+    QCOMPARE(frames, 375);
+    QCOMPARE(images, 0);
+    QVERIFY(withVectors > 0);
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 42, 100)
+    QVERIFY(withQp > 0);
+#endif
+
+    // Not exported by default
+    QAVPlayer p2;
+    withVectors = 0;
+    QObject::connect(&p2, &QAVPlayer::videoFrame, &p2, [&](const QAVVideoFrame &f) {
+        if (f.motionVectors().size > 0)
+            ++withVectors;
+    });
+    p2.setSource(file.absoluteFilePath());
+    p2.setSynced(false);
+    p2.play();
+    QTRY_COMPARE_WITH_TIMEOUT(p2.mediaStatus(), QAVPlayer::EndOfMedia, 15000);
+    QCOMPARE(withVectors, 0);
+}
+
+void tst_QAVPlayer::memoryBudget()
+{
+    QFileInfo file(testData("colors.mp4"));
+    QAVPlayer p;
+    QCOMPARE(p.memoryBudget(), 0);
+    QCOMPARE(p.memoryPolicy(), QAVPlayer::PauseDemuxer);
+    QSignalSpy budgetSpy(&p, &QAVPlayer::memoryBudgetChanged);
+    QSignalSpy policySpy(&p, &QAVPlayer::memoryPolicyChanged);
+    const qint64 budget = 64 * 1024;
+    p.setMemoryBudget(budget);
+    p.setMemoryBudget(budget);
+    QCOMPARE(budgetSpy.count(), 1);
+    p.setMemoryPolicy(QAVPlayer::BlockProducers);
+    p.setMemoryPolicy(QAVPlayer::BlockProducers);
+    QCOMPARE(policySpy.count(), 1);
+
+    qint64 maxTotal = 0;
+    qint64 maxPackets = 0;
+    int frames = 0;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &) {
+        ++frames;
+        const auto usage = p.memoryUsage();
+        maxTotal = qMax(maxTotal, usage.total);
+        maxPackets = qMax(maxPackets, usage.packets);
+    }, Qt::DirectConnection);
+
+    p.setSource(file.absoluteFilePath());
+    p.setSynced(false);
+    p.play();
+    QTRY_COMPARE_WITH_TIMEOUT(p.mediaStatus(), QAVPlayer::EndOfMedia, 15000);
+    QCOMPARE(frames, 375);
+    QVERIFY(maxPackets > 0);
+    // Reading is paused when reached, only the frames being decoded or sent could exceed it
+    QVERIFY2(maxTotal < budget * 4, QByteArray::number(maxTotal));
+
+    p.stop();
+    QTRY_COMPARE(p.memoryUsage().packets, qint64(0));
+    QTRY_COMPARE(p.memoryUsage().muxerFrames, qint64(0));
+    p.setSource({});
+    QTRY_COMPARE(p.memoryUsage().total, qint64(0));
+    QCOMPARE(QAVPlayer::processMemoryUsage().packets, qint64(0));
+
+    // Limits all players
+    QAVPlayer::setProcessMemoryBudget(budget);
+    QCOMPARE(QAVPlayer::processMemoryBudget(), budget);
+    QAVPlayer p2;
+    maxTotal = 0;
+    frames = 0;
+    QObject::connect(&p2, &QAVPlayer::videoFrame, &p2, [&](const QAVVideoFrame &) {
+        ++frames;
+        maxTotal = qMax(maxTotal, QAVPlayer::processMemoryUsage().total);
+    }, Qt::DirectConnection);
+    p2.setSource(file.absoluteFilePath());
+    p2.setSynced(false);
+    p2.play();
+    QTRY_COMPARE_WITH_TIMEOUT(p2.mediaStatus(), QAVPlayer::EndOfMedia, 15000);
+    QCOMPARE(frames, 375);
+    QVERIFY2(maxTotal < budget * 4, QByteArray::number(maxTotal));
+    QAVPlayer::setProcessMemoryBudget(0);
+}
+
+void tst_QAVPlayer::bufferingPolicy()
+{
+    QAVPlayer p;
+    QCOMPARE(p.bufferingPolicy().videoStartup, 0.0);
+    QCOMPARE(p.bufferingPolicy().audioSteady, 1.0);
+    QVERIFY(!p.isBuffering());
+
+    QSignalSpy policySpy(&p, &QAVPlayer::bufferingPolicyChanged);
+    QSignalSpy bufferingSpy(&p, &QAVPlayer::bufferingChanged);
+    QAVPlayer::BufferingPolicy policy;
+    policy.videoStartup = 0.5;
+    policy.audioStartup = 0.5;
+    p.setBufferingPolicy(policy);
+    p.setBufferingPolicy(policy);
+    QCOMPARE(policySpy.count(), 1);
+    QCOMPARE(p.bufferingPolicy().videoStartup, 0.5);
+
+    QFileInfo file(testData("colors.mp4"));
+    int framesWhileBuffering = 0;
+    int frames = 0;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &) {
+        ++frames;
+        if (p.isBuffering())
+            ++framesWhileBuffering;
+    }, Qt::DirectConnection);
+    p.setSource(file.absoluteFilePath());
+    p.play();
+    QTRY_VERIFY(frames > 10);
+    QCOMPARE(framesWhileBuffering, 0);
+    // Startup buffering
+    QVERIFY(bufferingSpy.count() >= 2);
+    QCOMPARE(bufferingSpy.at(0).at(0).toBool(), true);
+    QCOMPARE(bufferingSpy.at(1).at(0).toBool(), false);
+    p.stop();
+
+    // Reading is paused when the steady target is buffered, not the whole file
+    QFileInfo wav(testData("test.wav"));
+    QAVPlayer p2;
+    policy = {};
+    policy.audioSteady = 0.25;
+    p2.setBufferingPolicy(policy);
+    qint64 maxPackets = 0;
+    QObject::connect(&p2, &QAVPlayer::audioFrame, &p2, [&](const QAVAudioFrame &) {
+        maxPackets = qMax(maxPackets, p2.memoryUsage().packets);
+    }, Qt::DirectConnection);
+    p2.setSource(wav.absoluteFilePath());
+    p2.play();
+    QTRY_COMPARE(p2.mediaStatus(), QAVPlayer::EndOfMedia);
+    QVERIFY(maxPackets > 0);
+    QVERIFY2(maxPackets < wav.size() / 2, QByteArray::number(maxPackets));
+    QVERIFY(!p2.isBuffering());
+}
+
+void tst_QAVPlayer::allocations()
+{
+#ifndef QT_AVPLAYER_PROFILE_ALLOCS
+    QVERIFY(QAVPlayer::allocations().isEmpty());
+    QSKIP("Built without QT_AVPLAYER_PROFILE_ALLOCS");
+#else
+    auto bytes = [](const QString &subsystem, int stream = -2) {
+        qint64 ret = 0;
+        for (const auto &a : QAVPlayer::allocations()) {
+            if (a.subsystem == subsystem && (stream == -2 || a.stream == stream))
+                ret += a.bytes;
+        }
+        return ret;
+    };
+
+    QFileInfo file(testData("colors.mp4"));
+    QAVPlayer p;
+    qint64 maxDemuxer = 0;
+    qint64 maxDecoder = 0;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &) {
+        maxDemuxer = qMax(maxDemuxer, bytes(QLatin1String("demuxer")));
+        maxDecoder = qMax(maxDecoder, bytes(QLatin1String("decoder")));
+    }, Qt::DirectConnection);
+
+    p.setSource(file.absoluteFilePath());
+    p.setSynced(false);
+    p.play();
+    QTRY_COMPARE_WITH_TIMEOUT(p.mediaStatus(), QAVPlayer::EndOfMedia, 15000);
+    QVERIFY(maxDemuxer > 0);
+    QVERIFY(maxDecoder > 0);
+    // Attributed by stream
+    const int video = p.currentVideoStreams().first().index();
+    bool found = false;
+    for (const auto &a : QAVPlayer::allocations()) {
+        if (a.subsystem == QLatin1String("decoder") && a.stream == video) {
+            QVERIFY(a.allocations >= 375);
+            QVERIFY(a.peakBytes > 0);
+            found = true;
+        }
+    }
+    QVERIFY(found);
+
+    // Everything is released on unload
+    p.stop();
+    p.setSource({});
+    QTRY_COMPARE(bytes(QLatin1String("demuxer")), qint64(0));
+    QTRY_COMPARE(bytes(QLatin1String("decoder")), qint64(0));
+#endif
+}
+
+void tst_QAVPlayer::hibernate()
+{
+    QAVPlayer p;
+    QFileInfo file(testData("colors.mp4"));
+    QCOMPARE(p.hibernateTimeout(), 0);
+    QVERIFY(!p.isHibernated());
+    QSignalSpy timeoutSpy(&p, &QAVPlayer::hibernateTimeoutChanged);
+    QSignalSpy hibernatedSpy(&p, &QAVPlayer::hibernatedChanged);
+
+    QAVVideoFrame frame;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &f) { frame = f; });
+    qint64 stepPosition = -1;
+    QObject::connect(&p, &QAVPlayer::stepped, &p, [&](qint64 pos) { stepPosition = pos; });
+
+    p.setSource(file.absoluteFilePath());
+    p.pause();
+    QTRY_VERIFY(frame);
+    frame = QAVVideoFrame();
+    p.seek(5000);
+    QTRY_VERIFY(frame);
+    const double pts = frame.pts();
+    const qint64 pos = p.position();
+    QVERIFY(pos > 0);
+
+    p.setHibernateTimeout(100);
+    p.setHibernateTimeout(100);
+    QCOMPARE(timeoutSpy.count(), 1);
+    QTRY_VERIFY(p.isHibernated());
+    QCOMPARE(hibernatedSpy.count(), 1);
+    QCOMPARE(p.state(), QAVPlayer::PausedState);
+    QCOMPARE(p.mediaStatus(), QAVPlayer::LoadedMedia);
+    QCOMPARE(p.position(), pos);
+    QVERIFY(p.availableVideoStreams().isEmpty());
+    QCOMPARE(p.memoryUsage().packets, qint64(0));
+
+    // Continues from the next frame
+    frame = QAVVideoFrame();
+    p.stepForward();
+    QVERIFY(!p.isHibernated());
+    QCOMPARE(hibernatedSpy.count(), 2);
+    QTRY_COMPARE(p.availableVideoStreams().size(), 1);
+    QTRY_VERIFY(frame);
+    QTRY_VERIFY(stepPosition > pos);
+    QVERIFY(frame.pts() > pts);
+    QVERIFY(frame.pts() < pts + 0.1);
+
+    // Selected while hibernated and applied on wake up
+    QTRY_VERIFY(p.isHibernated());
+    QSignalSpy audioSpy(&p, &QAVPlayer::audioStreamsChanged);
+    p.setAudioStreams({});
+    QVERIFY(!p.isHibernated());
+    QTRY_COMPARE(audioSpy.count(), 1);
+    QCOMPARE(p.availableAudioStreams().size(), 1);
+    QVERIFY(p.currentAudioStreams().isEmpty());
+    QCOMPARE(p.currentVideoStreams().size(), 1);
+
+    // Variants are kept while hibernated
+    QTRY_VERIFY(p.isHibernated());
+    QVERIFY(p.availableVideoStreams().isEmpty());
+    QVERIFY(p.variants().isEmpty());
+    QCOMPARE(p.currentVariant(), -1);
+    QSignalSpy variantSpy(&p, &QAVPlayer::variantChanged);
+    p.setVariant(0);
+    QVERIFY(p.isHibernated());
+    QCOMPARE(variantSpy.count(), 0);
+
+    // Selected while the media is reopened, applied by the loader
+    QSignalSpy videoSpy(&p, &QAVPlayer::videoStreamsChanged);
+    audioSpy.clear();
+    p.setVideoStreams({});
+    QVERIFY(!p.isHibernated());
+    p.setAudioStreams({});
+    QTRY_COMPARE(videoSpy.count(), 1);
+    QTRY_COMPARE(audioSpy.count(), 1);
+    QVERIFY(p.currentVideoStreams().isEmpty());
+    QVERIFY(p.currentAudioStreams().isEmpty());
+    QCOMPARE(p.availableVideoStreams().size(), 1);
+    p.setVideoStreams(p.availableVideoStreams());
+    QCOMPARE(videoSpy.count(), 2);
+    QCOMPARE(p.currentVideoStreams().size(), 1);
+
+    QTRY_VERIFY(p.isHibernated());
+    p.setHibernateTimeout(0);
+    p.setSynced(false);
+    p.play();
+    QVERIFY(!p.isHibernated());
+    QTRY_COMPARE_WITH_TIMEOUT(p.mediaStatus(), QAVPlayer::EndOfMedia, 15000);
+    QVERIFY(!p.isHibernated());
+}
+
+void tst_QAVPlayer::cropped()
+{
+    QAVPlayer p;
+    QFileInfo file(testData("colors.mp4"));
+    p.setSource(file.absoluteFilePath());
+
+    QAVVideoFrame frame;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &f) { frame = f; });
+    p.pause();
+    QTRY_VERIFY(frame);
+    QCOMPARE(frame.format(), AV_PIX_FMT_YUV420P);
+    QCOMPARE(frame.size(), QSize(160, 120));
+    QCOMPARE(frame.planeCount(), 3);
+
+    QVERIFY(!frame.cropped(QRect(200, 200, 10, 10)));
+    QVERIFY(!frame.cropped(QRect()));
+
+    // Aligned to the chroma subsampling
+    const auto c = frame.cropped(QRect(11, 21, 50, 40));
+    QVERIFY(c);
+    QCOMPARE(c.size(), QSize(51, 41));
+    QCOMPARE(c.pts(), frame.pts());
+    // The buffers are shared
+    QCOMPARE(c.frame()->buf[0]->data, frame.frame()->buf[0]->data);
+    const auto y = frame.plane(0);
+    const auto u = frame.plane(1);
+    QCOMPARE(y.size, QSize(160, 120));
+    QCOMPARE(u.size, QSize(80, 60));
+    QCOMPARE(u.pixelStride, 1);
+    const auto cy = c.plane(0);
+    const auto cu = c.plane(1);
+    QCOMPARE(cy.data, y.data + 20 * y.bytesPerLine + 10);
+    QCOMPARE(cy.bytesPerLine, y.bytesPerLine);
+    QCOMPARE(cu.data, u.data + 10 * u.bytesPerLine + 5);
+    QCOMPARE(cu.size, QSize(26, 21));
+    QVERIFY(!c.plane(3).data);
+
+    const auto rgb = c.convertTo(AV_PIX_FMT_RGB24);
+    QVERIFY(rgb);
+    QCOMPARE(rgb.size(), QSize(51, 41));
+
+    // Nested crops are relative to the view
+    const auto cc = c.cropped(QRect(2, 2, 10, 10));
+    QCOMPARE(cc.plane(0).data, y.data + 22 * y.bytesPerLine + 12);
+
+    const auto tiles = frame.tiles(2, 2);
+    QCOMPARE(tiles.size(), 4);
+    for (const auto &tile : tiles)
+        QCOMPARE(tile.size(), QSize(80, 60));
+    QCOMPARE(tiles[3].plane(0).data, y.data + 60 * y.bytesPerLine + 80);
+    QVERIFY(frame.tiles(0, 2).isEmpty());
+}
+
+void tst_QAVPlayer::audioSamples()
+{
+    QAVPlayer p;
+    QFileInfo file(testData("colors.mp4"));
+    p.setSource(file.absoluteFilePath());
+    p.setVideoStreams({});
+
+    QAVAudioFrame frame;
+    QObject::connect(&p, &QAVPlayer::audioFrame, &p, [&](const QAVAudioFrame &f) { if (!frame) frame = f; }, Qt::DirectConnection);
+    p.play();
+    QTRY_VERIFY(frame);
+    p.stop();
+
+    QVERIFY(frame.sampleFormat() != AV_SAMPLE_FMT_NONE);
+    QVERIFY(frame.sampleRate() > 0);
+    QVERIFY(frame.channelCount() > 0);
+    QVERIFY(frame.sampleCount() > 0);
+    QVERIFY(!frame.channelLayout().isEmpty());
+    QCOMPARE(frame.planeCount(), frame.isPlanar() ? frame.channelCount() : 1);
+    QVERIFY(!frame.plane(frame.planeCount()).data);
+
+    // No copy
+    QCOMPARE(frame.plane(0).data, frame.frame()->extended_data[0]);
+    const int samplesPerPlane = frame.isPlanar() ? frame.sampleCount() : frame.sampleCount() * frame.channelCount();
+    QCOMPARE(frame.plane(0).size, samplesPerPlane * frame.bytesPerSample());
+    // Native format is not converted
+    QCOMPARE(frame.format().sampleFormat(), QAVAudioFormat::Int32);
+
+    auto fmt = frame.format();
+    fmt.setSampleFormat(QAVAudioFormat::Float);
+    const auto converted = frame.convertTo(fmt);
+    QCOMPARE(converted.format(), fmt);
+    QCOMPARE(converted.sampleFormat(), frame.sampleFormat());
+    const auto data = converted.data();
+    QCOMPARE(data.size(), int(frame.sampleCount() * frame.channelCount() * sizeof(float)));
+
+    if (frame.sampleFormat() == AV_SAMPLE_FMT_FLTP) {
+        QVERIFY(!frame.samples<double>(0).data);
+        // Same size, other type
+        QVERIFY(!frame.samples<int32_t>(0).data);
+        const auto interleaved = reinterpret_cast<const float *>(data.constData());
+        for (int ch = 0; ch < frame.channelCount(); ++ch) {
+            const auto samples = frame.samples<float>(ch);
+            QCOMPARE(samples.size, frame.sampleCount());
+            for (int i = 0; i < samples.size; ++i)
+                QCOMPARE(samples[i], interleaved[i * frame.channelCount() + ch]);
+        }
+    }
+
+    QAVAudioFrame empty(fmt, data);
+    QCOMPARE(empty.sampleFormat(), AV_SAMPLE_FMT_NONE);
+    QCOMPARE(empty.planeCount(), 0);
+    QVERIFY(!empty.samples<float>().data);
+}
+
+void tst_QAVPlayer::videoConverter()
+{
+    QAVPlayer p;
+    QFileInfo file(testData("colors.mp4"));
+    p.setSource(file.absoluteFilePath());
+
+    QAVVideoFrame frame;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &f) { frame = f; });
+    p.pause();
+    QTRY_VERIFY(frame);
+
+    QAVVideoConverter converter;
+    QCOMPARE(converter.threadCount(), 1);
+    auto scaled = converter.convert(frame, AV_PIX_FMT_RGB24, QSize(80, 60));
+    QVERIFY(scaled);
+    QCOMPARE(scaled.format(), AV_PIX_FMT_RGB24);
+    QCOMPARE(scaled.size(), QSize(80, 60));
+    QCOMPARE(scaled.pts(), frame.pts());
+    QCOMPARE(scaled.stream().index(), frame.stream().index());
+    QCOMPARE(frame.convertTo(AV_PIX_FMT_RGB24, QSize(80, 60)).size(), QSize(80, 60));
+
+    // Slices give the same result without chroma interpolation
+    const auto single = converter.convert(frame, AV_PIX_FMT_NV12);
+    converter.setThreadCount(4);
+    const auto sliced = converter.convert(frame, AV_PIX_FMT_NV12);
+    QVERIFY(single);
+    QVERIFY(sliced);
+    QCOMPARE(sliced.size(), frame.size());
+    const auto a = single.map();
+    const auto b = sliced.map();
+    for (int y = 0; y < frame.size().height(); ++y)
+        QVERIFY(memcmp(a.data[0] + y * a.bytesPerLine[0], b.data[0] + y * b.bytesPerLine[0], frame.size().width()) == 0);
+    for (int y = 0; y < frame.size().height() / 2; ++y)
+        QVERIFY(memcmp(a.data[1] + y * a.bytesPerLine[1], b.data[1] + y * b.bytesPerLine[1], frame.size().width()) == 0);
+
+    // Caller provided frame
+    QAVVideoFrame out(QSize(40, 30), AV_PIX_FMT_YUV420P);
+    QVERIFY(converter.convert(frame, out));
+    QCOMPARE(out.size(), QSize(40, 30));
+    QCOMPARE(out.frame()->pts, frame.frame()->pts);
+    QAVVideoFrame empty;
+    QVERIFY(!converter.convert(frame, empty));
+}
+
+void tst_QAVPlayer::filterResolutionChange()
+{
+    qputenv("QT_AVPLAYER_NO_HWDEVICE", "1");
+    // The resolution changes when the second file starts
+    QTemporaryDir dir;
+    QFile list(dir.filePath("list.ffconcat"));
+    QVERIFY(list.open(QIODevice::WriteOnly));
+    list.write("ffconcat version 1.0\n");
+    list.write(QString("file '%1'\n").arg(QFileInfo(testData("colors.mp4")).absoluteFilePath()).toUtf8());
+    list.write(QString("file '%1'\n").arg(QFileInfo(testData("small.mp4")).absoluteFilePath()).toUtf8());
+    list.close();
+
+    auto count = [&](const QString &filter, QSet<int> &widths) {
+        QAVPlayer p;
+        p.setInputFormat("concat");
+        p.setInputOptions({{"safe", "0"}});
+        p.setSource(list.fileName());
+        if (!filter.isEmpty())
+            p.setFilter(filter);
+        int frames = 0;
+        QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &f) {
+            widths.insert(f.size().width());
+            ++frames;
+        }, Qt::DirectConnection);
+        p.setSynced(false);
+        p.play();
+        [&] { QTRY_COMPARE_WITH_TIMEOUT(p.mediaStatus(), QAVPlayer::EndOfMedia, 30000); }();
+        return frames;
+    };
+
+    QSet<int> widths;
+    const int frames = count({}, widths);
+    QVERIFY(frames > 0);
+    QCOMPARE(widths.size(), 2);
+
+    // Every frame is filtered again after the graph is recreated
+    QSet<int> filteredWidths;
+    QCOMPARE(count("negate", filteredWidths), frames);
+    QCOMPARE(filteredWidths, widths);
+}
+
+// Copies the packets to matroska, all packets of a stream are written before the next stream
+static bool remuxStreamsInTurn(const QString &in, const QString &out)
+{
+    AVFormatContext *ictx = nullptr;
+    if (avformat_open_input(&ictx, in.toUtf8().constData(), nullptr, nullptr) < 0)
+        return false;
+    AVFormatContext *octx = nullptr;
+    bool ok = avformat_find_stream_info(ictx, nullptr) >= 0
+        && avformat_alloc_output_context2(&octx, nullptr, "matroska", out.toUtf8().constData()) >= 0;
+    for (unsigned i = 0; ok && i < ictx->nb_streams; ++i) {
+        auto st = avformat_new_stream(octx, nullptr);
+        ok = st && avcodec_parameters_copy(st->codecpar, ictx->streams[i]->codecpar) >= 0;
+        if (ok) {
+            st->codecpar->codec_tag = 0;
+            st->time_base = ictx->streams[i]->time_base;
+        }
+    }
+    ok = ok && avio_open(&octx->pb, out.toUtf8().constData(), AVIO_FLAG_WRITE) >= 0
+        && avformat_write_header(octx, nullptr) >= 0;
+
+    QList<AVPacket *> packets;
+    while (ok) {
+        AVPacket *pkt = av_packet_alloc();
+        if (av_read_frame(ictx, pkt) < 0) {
+            av_packet_free(&pkt);
+            break;
+        }
+        packets.append(pkt);
+    }
+    for (unsigned i = 0; ok && i < ictx->nb_streams; ++i) {
+        for (auto pkt : packets) {
+            if (pkt->stream_index != int(i))
+                continue;
+            av_packet_rescale_ts(pkt, ictx->streams[i]->time_base, octx->streams[i]->time_base);
+            ok = av_write_frame(octx, pkt) >= 0;
+            if (!ok)
+                break;
+        }
+    }
+    for (auto pkt : packets)
+        av_packet_free(&pkt);
+    if (ok)
+        ok = av_write_trailer(octx) >= 0;
+    if (octx)
+        avio_closep(&octx->pb);
+    avformat_free_context(octx);
+    avformat_close_input(&ictx);
+    return ok;
+}
+
+void tst_QAVPlayer::frameVerifierInterleaving()
+{
+    QFileInfo file(testData("colors.mp4"));
+    QTemporaryDir dir;
+    const QString remuxed = dir.filePath("colors.mkv");
+    QVERIFY(remuxStreamsInTurn(file.absoluteFilePath(), remuxed));
+
+    // One source returns all video frames first, another one interleaves them with audio
+    QAVFrameVerifier v;
+    v.setThreadCount(1);
+    QAVFrameVerifier::Mismatch mismatch;
+    QCOMPARE(v.compare(file.absoluteFilePath(), remuxed, &mismatch), 0);
+    QCOMPARE(v.compare(remuxed, file.absoluteFilePath(), &mismatch), 0);
+    QCOMPARE(mismatch.frame, -1);
+}
+
+void tst_QAVPlayer::switchVideoStreamsThreads()
+{
+    QAVPlayer p;
+    QFileInfo file(testData("7_BCL02006_ffv1_20s_1.mkv"));
+
+    QMutex mutex;
+    QMap<int, QList<double>> pts;
+    QObject::connect(&p, &QAVPlayer::videoFrame, &p, [&](const QAVVideoFrame &f) {
+        QMutexLocker locker(&mutex);
+        pts[f.stream().index()].push_back(f.pts());
+    }, Qt::DirectConnection);
+    auto count = [&](int index) {
+        QMutexLocker locker(&mutex);
+        return pts[index].size();
+    };
+
+    p.setSource(file.absoluteFilePath());
+    QTRY_COMPARE(p.mediaStatus(), QAVPlayer::LoadedMedia);
+    const auto streams = p.availableVideoStreams();
+    QVERIFY(streams.size() > 1);
+    p.setVideoStreams({streams[0], streams[1]});
+    p.play();
+    QTRY_VERIFY(count(streams[1].index()) > 15);
+
+    // Decoded by the first video stream's thread now
+    p.setVideoStreams({streams[1]});
+    int frames = count(streams[1].index());
+    QTRY_VERIFY(count(streams[1].index()) > frames + 15);
+    const int deselected = count(streams[0].index());
+    frames = count(streams[1].index());
+    QTRY_VERIFY(count(streams[1].index()) > frames + 15);
+    QCOMPARE(count(streams[0].index()), deselected);
+
+    // And by own thread again
+    p.setVideoStreams({streams[0], streams[1]});
+    frames = count(streams[1].index());
+    QTRY_VERIFY(count(streams[1].index()) > frames + 15);
+    QTRY_VERIFY(count(streams[0].index()) > deselected);
+    p.pause();
+    QTRY_COMPARE(p.state(), QAVPlayer::PausedState);
+
+    // Every stream is decoded in order
+    QMutexLocker locker(&mutex);
+    for (const auto &list : pts) {
+        for (int i = 1; i < list.size(); ++i)
+            QVERIFY(list[i] > list[i - 1]);
+    }
+}
+
 QTEST_MAIN(tst_QAVPlayer)
 #include "tst_qavplayer.moc"